@@ -0,0 +1,571 @@
+// benchmark.cpp
+//
+// Micro and end-to-end benchmarks for the library. Prints one JSON object per line: a "meta"
+// record describing the build, then one record per benchmark with
+//   name, iterations, ns_per_op, items_per_op, items_per_sec, allocs_per_op, bytes_per_op, peak_rss_kb
+// Inputs come from fixed seeds, so runs of different versions measure the same work.
+//
+// Built on its own, next to (not into) the DLL sources; from the repository root:
+//   g++ -std=c++17 -O2 -mavx2 -mfma -pthread -I. benchmarks/benchmark.cpp $(ls *.cpp | grep -v '^main.cpp$') -o nn_benchmark
+//   cl /std:c++17 /O2 /arch:AVX2 /EHsc /I. benchmarks\benchmark.cpp <every .cpp except main.cpp> psapi.lib
+// or as the nn_benchmark target of CMakeLists.txt.
+//
+// Usage: nn_benchmark [--filter <substring>] [--min-time <seconds>] [--stats]
+// peak_rss_kb is the process peak so far; run a single benchmark with --filter to attribute it.
+// --stats ends with an "instrumentation" record: the library's own counters over the whole run
+// (build with -DNN_DISABLE_INSTRUMENTATION to measure without them).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "layer.h"
+#include "neural_network.h"
+#include "data_normalization.h"
+#include "data_storage.h"
+#include "interface_function.h"
+#include "math_kernels.h"
+#include "model_file.h"
+#include "inference_plan.h"
+#include "static_network.h"
+#include "instrumentation.h"
+#include "thread_pool.h"
+#include "counted_allocation.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Allocation counting: every global operator new in the process goes through these.
+
+namespace {
+    std::atomic<std::size_t> g_allocations{0};
+    std::atomic<std::size_t> g_allocatedBytes{0};
+
+    void countAllocation(std::size_t size) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        instrumentation::countAllocation(size); // as the DLL's hook does, for the stage figures
+    }
+}
+
+NN_DEFINE_COUNTED_NEW(countAllocation)
+
+namespace {
+
+    constexpr unsigned kSeed = 20240601;
+
+    volatile double g_sink = 0.0; // keeps results observable so the work is not optimized away
+
+    size_t peakRssKb() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.PeakWorkingSetSize / 1024;
+        }
+        return 0;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss) / 1024; // bytes on macOS
+#else
+        return static_cast<size_t>(usage.ru_maxrss); // kilobytes on Linux
+#endif
+#endif
+    }
+
+    struct Options {
+        std::string filter;
+        double minTime = 0.5;
+        bool printStats = false;
+    };
+
+    bool selected(const Options& options, const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    // Lets a group skip building its inputs when none of its benchmarks is selected, so a filtered
+    // run's peak_rss_kb reflects the selected benchmark only.
+    bool anySelected(const Options& options, std::initializer_list<const char*> names) {
+        for (const char* name : names) {
+            if (selected(options, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs op (one operation processing itemsPerOp items) until minTime has passed, after one
+    // untimed warm-up call, and prints the result line.
+    void run(const Options& options, const std::string& name, size_t itemsPerOp, const std::function<void()>& op) {
+        if (!selected(options, name)) {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        op();
+
+        size_t iterations = 0;
+        const size_t allocationsBefore = g_allocations.load();
+        const size_t bytesBefore = g_allocatedBytes.load();
+        const Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        size_t batch = 1;
+        while (elapsed < options.minTime) {
+            for (size_t i = 0; i < batch; ++i) {
+                op();
+            }
+            iterations += batch;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            if (elapsed < options.minTime / 10) {
+                batch *= 2;
+            }
+        }
+        const double allocations = static_cast<double>(g_allocations.load() - allocationsBefore) / static_cast<double>(iterations);
+        const double bytes = static_cast<double>(g_allocatedBytes.load() - bytesBefore) / static_cast<double>(iterations);
+        const double nsPerOp = elapsed * 1e9 / static_cast<double>(iterations);
+
+        std::printf("{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.1f, \"items_per_op\": %zu, "
+                    "\"items_per_sec\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f, \"peak_rss_kb\": %zu}\n",
+                    name.c_str(), iterations, nsPerOp, itemsPerOp, static_cast<double>(itemsPerOp) * 1e9 / nsPerOp,
+                    allocations, bytes, peakRssKb());
+        std::fflush(stdout);
+    }
+
+    std::vector<BarData> makeBars(size_t numBars, std::mt19937& rng) {
+        std::normal_distribution<double> step(0.0, 1.0);
+        std::vector<BarData> bars;
+        bars.reserve(numBars);
+        double price = 1000.0;
+        for (size_t i = 0; i < numBars; ++i) {
+            const double open = price;
+            price += step(rng);
+            const double close = price;
+            bars.emplace_back(open, close, std::max(open, close) + std::fabs(step(rng)), std::min(open, close) - std::fabs(step(rng)));
+        }
+        return bars;
+    }
+
+    // Layers initialize from std::random_device; overwrite the weights so every run sees the same ones.
+    void seedWeights(Layer& layer, std::mt19937& rng) {
+        std::normal_distribution<double> weight(0.0, 1.0 / std::sqrt(static_cast<double>(layer.getInputSize())));
+        for (size_t r = 0; r < layer.getOutputSize(); ++r) {
+            for (size_t j = 0; j < layer.getInputSize(); ++j) {
+                layer.getWeightData()[r * layer.getWeightStride() + j] = weight(rng);
+            }
+        }
+    }
+
+    NeuralNetwork makeNetwork(size_t numInputs, const std::vector<size_t>& widths) {
+        std::mt19937 rng(kSeed);
+        NeuralNetwork network(numInputs, widths.back());
+        for (size_t i = 0; i < widths.size(); ++i) {
+            network.addLayer(widths[i], i + 1 == widths.size() ? ActivationType::Linear : ActivationType::ReLU);
+        }
+        for (auto& layer : network.getLayers()) {
+            seedWeights(layer, rng);
+        }
+        return network;
+    }
+
+    std::vector<double> randomVector(size_t n, std::mt19937& rng) {
+        std::uniform_real_distribution<double> value(-1.0, 1.0);
+        std::vector<double> x(n);
+        for (auto& v : x) {
+            v = value(rng);
+        }
+        return x;
+    }
+
+    void benchLayers(const Options& options) {
+        for (size_t size : {16, 64, 256, 1024}) {
+            const std::string shape = std::to_string(size) + "x" + std::to_string(size);
+            if (!selected(options, "layer_forward/" + shape) && !selected(options, "layer_forward_vector/" + shape)) {
+                continue;
+            }
+            std::mt19937 rng(kSeed);
+            Layer layer(size, size, ActivationType::ReLU);
+            seedWeights(layer, rng);
+            const std::vector<double> input = randomVector(size, rng);
+            std::vector<double> output(size);
+            run(options, "layer_forward/" + shape, 1, [&] {
+                layer.forward(input.data(), output.data());
+                g_sink = output[0];
+            });
+            run(options, "layer_forward_vector/" + shape, 1, [&] {
+                g_sink = layer.forward(input)[0];
+            });
+        }
+    }
+
+    void benchPrediction(const Options& options) {
+        std::mt19937 rng(kSeed);
+        const NeuralNetwork network = makeNetwork(64, {256, 256, 1});
+        const std::vector<double> input = randomVector(64, rng);
+        std::vector<double> output(1);
+        run(options, "network_predict/64-256-256-1", 1, [&] {
+            g_sink = network.predict(input)[0];
+        });
+        run(options, "network_predict_into/64-256-256-1", 1, [&] {
+            network.predictInto(input.data(), output.data());
+            g_sink = output[0];
+        });
+
+        const size_t numSamples = 1024;
+        const std::vector<double> inputs = randomVector(numSamples * 64, rng);
+        run(options, "network_predict_batch/64-256-256-1/1024", numSamples, [&] {
+            g_sink = network.predictBatch(inputs, numSamples)[0];
+        });
+    }
+
+    // Thread counts for the scaling sweeps: powers of two up to the hardware threads, and those.
+    std::vector<size_t> threadCounts() {
+        const size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+        std::vector<size_t> counts;
+        for (size_t n = 1; n < hardware; n *= 2) {
+            counts.push_back(n);
+        }
+        counts.push_back(hardware);
+        return counts;
+    }
+
+    // One shared network, predictInto from every thread; items_per_sec is the total throughput.
+    void benchPredictionThreads(const Options& options) {
+        const std::vector<size_t> counts = threadCounts();
+        bool any = false;
+        for (size_t numThreads : counts) {
+            any = any || selected(options, "predict_threads_" + std::to_string(numThreads) + "/64-256-256-1");
+        }
+        if (!any) {
+            return;
+        }
+        std::mt19937 rng(kSeed);
+        const NeuralNetwork network = makeNetwork(64, {256, 256, 1});
+        const std::vector<double> input = randomVector(64, rng);
+        const size_t callsPerThread = 64;
+        for (size_t numThreads : counts) {
+            ThreadPool pool(numThreads);
+            run(options, "predict_threads_" + std::to_string(numThreads) + "/64-256-256-1", numThreads * callsPerThread, [&] {
+                pool.run([&](size_t t) {
+                    double output = 0.0;
+                    for (size_t i = 0; i < callsPerThread; ++i) {
+                        network.predictInto(input.data(), &output);
+                    }
+                    if (t == 0) {
+                        g_sink = output;
+                    }
+                });
+            });
+        }
+    }
+
+    // The production-sized 4-16-8-1 topology, runtime-sized and compile-time specialized.
+    void benchStaticNetwork(const Options& options) {
+        std::mt19937 rng(kSeed);
+        const NeuralNetwork network = makeNetwork(4, {16, 8, 1});
+        const StaticNetwork<4, 16, 8, 1> staticNetwork(network);
+        const StaticNetworkF<4, 16, 8, 1> staticNetworkF(network);
+        const std::vector<double> input = randomVector(4, rng);
+        const float inputF[4] = {static_cast<float>(input[0]), static_cast<float>(input[1]),
+                                 static_cast<float>(input[2]), static_cast<float>(input[3])};
+        double output[1];
+        float outputF[1];
+        run(options, "network_predict_into/4-16-8-1", 1, [&] {
+            network.predictInto(input.data(), output);
+            g_sink = output[0];
+        });
+        run(options, "static_predict_into/4-16-8-1", 1, [&] {
+            staticNetwork.predictInto(input.data(), output);
+            g_sink = output[0];
+        });
+        run(options, "static_predict_into_float/4-16-8-1", 1, [&] {
+            staticNetworkF.predictInto(inputF, outputF);
+            g_sink = outputF[0];
+        });
+    }
+
+    // Sigmoid/tanh in both accuracy modes, alone over 1024 values and inside a tanh network.
+    void benchActivations(const Options& options) {
+        std::mt19937 rng(kSeed);
+        const size_t n = 1024;
+        std::vector<double> source = randomVector(n, rng);
+        for (auto& v : source) {
+            v *= 4.0;
+        }
+        std::vector<double> values(n);
+        const std::pair<const char*, kernels::ActivationMode> modes[] = {{"exact", kernels::ActivationMode::Exact},
+                                                                         {"fast", kernels::ActivationMode::Fast}};
+        for (const auto& mode : modes) {
+            const std::pair<const char*, kernels::Activation> activations[] = {{"tanh", kernels::Activation::Tanh},
+                                                                               {"sigmoid", kernels::Activation::Sigmoid}};
+            for (const auto& activation : activations) {
+                run(options, std::string("activation/") + activation.first + "/" + mode.first + "/1024", n, [&] {
+                    std::copy(source.begin(), source.end(), values.begin());
+                    kernels::applyActivation(values.data(), n, activation.second, mode.second);
+                    g_sink = values[0];
+                });
+            }
+        }
+
+        const std::string tanhBatch = "network_predict_batch/64-256t-256t-1/1024/";
+        if (!selected(options, tanhBatch + "exact") && !selected(options, tanhBatch + "fast")) {
+            return;
+        }
+        NeuralNetwork network(64, 1);
+        network.addLayer(256, ActivationType::Tanh);
+        network.addLayer(256, ActivationType::Tanh);
+        network.addLayer(1, ActivationType::Linear);
+        for (auto& layer : network.getLayers()) {
+            seedWeights(layer, rng);
+        }
+        const size_t numSamples = 1024;
+        const std::vector<double> inputs = randomVector(numSamples * 64, rng);
+        for (const auto& mode : modes) {
+            network.setActivationMode(mode.second);
+            run(options, tanhBatch + mode.first, numSamples, [&] {
+                g_sink = network.predictBatch(inputs, numSamples)[0];
+            });
+        }
+    }
+
+    std::string trainThreadsName(size_t numThreads, bool hogwild) {
+        return std::string(hogwild ? "train_hogwild_threads_" : "train_threads_") + std::to_string(numThreads) +
+               "/4-64-64-1/20000/batch32";
+    }
+
+    void benchTraining(const Options& options) {
+        const std::vector<size_t> counts = threadCounts();
+        bool any = anySelected(options, {"train_epoch/4-64-64-1/20000/batch1", "train_epoch/4-64-64-1/20000/batch32"});
+        for (size_t numThreads : counts) {
+            any = any || selected(options, trainThreadsName(numThreads, false)) || selected(options, trainThreadsName(numThreads, true));
+        }
+        if (!any) {
+            return;
+        }
+        std::mt19937 rng(kSeed);
+        const std::vector<BarData> bars = makeBars(20000, rng);
+        DataStorage storage;
+        for (const auto& bar : bars) {
+            storage.addBarData(bar);
+        }
+        DataNormalization(DataNormalization::NormalizationType::MinMax).normalizeBarData(storage);
+
+        for (size_t batchSize : {1, 32}) {
+            NeuralNetwork network = makeNetwork(4, {64, 64, 1});
+            network.setBatchSize(batchSize);
+            run(options, "train_epoch/4-64-64-1/20000/batch" + std::to_string(batchSize), bars.size(), [&] {
+                network.train(storage, 1, 0.001);
+            });
+        }
+
+        // Scaling curve: samples/sec against training threads, synchronous and Hogwild.
+        for (bool hogwild : {false, true}) {
+            for (size_t numThreads : counts) {
+                NeuralNetwork network = makeNetwork(4, {64, 64, 1});
+                network.setBatchSize(32);
+                network.setTrainingThreads(numThreads);
+                network.setHogwild(hogwild);
+                run(options, trainThreadsName(numThreads, hogwild), bars.size(), [&] {
+                    network.train(storage, 1, 0.001);
+                });
+            }
+        }
+    }
+
+    void benchNormalization(const Options& options) {
+        if (!anySelected(options, {"normalize_in_place/minmax/1M", "normalize_in_place/zscore/1M", "normalize_copy/minmax/1M"})) {
+            return;
+        }
+        std::mt19937 rng(kSeed);
+        const size_t numBars = 1000000;
+        const std::vector<BarData> bars = makeBars(numBars, rng);
+        DataStorage storage;
+        storage.reserve(numBars);
+        for (const auto& bar : bars) {
+            storage.addBarData(bar);
+        }
+
+        // The in-place passes do the same work whatever the values, so the storage is reused.
+        DataNormalization minMax(DataNormalization::NormalizationType::MinMax);
+        run(options, "normalize_in_place/minmax/1M", numBars, [&] {
+            minMax.normalizeBarData(storage);
+        });
+        DataNormalization zScore(DataNormalization::NormalizationType::ZScore);
+        zScore.setMeanStd(1000.0, 50.0);
+        run(options, "normalize_in_place/zscore/1M", numBars, [&] {
+            zScore.normalizeBarData(storage);
+        });
+        run(options, "normalize_copy/minmax/1M", numBars, [&] {
+            g_sink = minMax.normalizeBarData(bars)[0].close;
+        });
+    }
+
+    void benchModelFiles(const Options& options) {
+        const NeuralNetwork network = makeNetwork(64, {256, 256, 1});
+        const DataNormalization normalization(DataNormalization::NormalizationType::MinMax);
+
+        std::string text;
+        {
+            std::ostringstream out;
+            network.saveModel(out);
+            text = out.str();
+        }
+        run(options, "model_save_text/64-256-256-1", 1, [&] {
+            std::ostringstream out;
+            network.saveModel(out);
+            g_sink = static_cast<double>(out.tellp());
+        });
+        run(options, "model_load_text/64-256-256-1", 1, [&] {
+            std::istringstream in(text);
+            NeuralNetwork loaded;
+            loaded.loadModel(in);
+            g_sink = static_cast<double>(loaded.getNumInputs());
+        });
+
+        const std::string path = "nn_benchmark_model.bin";
+        run(options, "model_save_binary/64-256-256-1", 1, [&] {
+            std::ofstream out(path, std::ios::binary);
+            model_file::saveBinary(out, network, normalization, "benchmark");
+        });
+        run(options, "model_load_binary/64-256-256-1", 1, [&] {
+            DataNormalization loadedNormalization;
+            std::string version;
+            NeuralNetwork loaded = model_file::loadBinary<double>(path, loadedNormalization, version);
+            g_sink = static_cast<double>(loaded.getNumInputs());
+        });
+        std::remove(path.c_str());
+    }
+
+    void benchProcessData(const Options& options) {
+        if (!anySelected(options, {"process_data_inference/8-64-64-1/10000", "on_bar/8-64-64-1",
+                                   "process_data_training/4-64-64-1/10000"})) {
+            return;
+        }
+        std::mt19937 rng(kSeed);
+        const size_t numBars = 10000;
+        const std::vector<BarData> bars = makeBars(numBars, rng);
+        std::map<std::string, std::vector<double>> indicators;
+        for (const char* name : {"a", "b", "c", "d"}) {
+            indicators[name] = randomVector(numBars, rng);
+        }
+
+        NeuralNetwork inferenceNetwork = makeNetwork(8, {64, 64, 1});
+        InterfaceFunction inference(inferenceNetwork);
+        run(options, "process_data_inference/8-64-64-1/10000", numBars, [&] {
+            g_sink = inference.processData(bars, indicators, true)[0];
+        });
+        std::vector<const std::vector<double>*> columns;
+        for (const auto& pair : indicators) {
+            columns.push_back(&pair.second);
+        }
+        std::vector<double> row(columns.size());
+        size_t bar = 0;
+        run(options, "on_bar/8-64-64-1", 1, [&] {
+            for (size_t k = 0; k < columns.size(); ++k) {
+                row[k] = (*columns[k])[bar];
+            }
+            g_sink = inference.onBar(bars[bar], row.data());
+            bar = bar + 1 == numBars ? 0 : bar + 1;
+        });
+
+        NeuralNetwork trainingNetwork = makeNetwork(4, {64, 64, 1});
+        InterfaceFunction training(trainingNetwork);
+        training.setTrainingMode(true);
+        run(options, "process_data_training/4-64-64-1/10000", numBars, [&] {
+            training.processData(bars, {}, false);
+        });
+    }
+
+    // ZScore inference with the normalization as a separate pass and folded into a compiled plan.
+    void benchInferencePlan(const Options& options) {
+        if (!anySelected(options, {"process_data_inference/zscore/8-64-64-1/10000", "on_bar/zscore/8-64-64-1",
+                                   "process_data_inference_plan/zscore/8-64-64-1/10000", "on_bar_plan/zscore/8-64-64-1"})) {
+            return;
+        }
+        std::mt19937 rng(kSeed);
+        const size_t numBars = 10000;
+        const std::vector<BarData> bars = makeBars(numBars, rng);
+        std::map<std::string, std::vector<double>> indicators;
+        for (const char* name : {"a", "b", "c", "d"}) {
+            indicators[name] = randomVector(numBars, rng);
+        }
+        std::vector<double> rows(numBars * indicators.size());
+        size_t column = 0;
+        for (const auto& pair : indicators) {
+            for (size_t i = 0; i < numBars; ++i) {
+                rows[i * indicators.size() + column] = pair.second[i];
+            }
+            ++column;
+        }
+
+        NeuralNetwork network = makeNetwork(8, {64, 64, 1});
+        InterfaceFunction inference(network, DataNormalization::NormalizationType::ZScore);
+        inference.getDataNormalization().setMeanStd(1000.0, 25.0);
+        const InferencePlan plan(network, inference.getDataNormalization());
+        for (const InferencePlan* selectedPlan : {static_cast<const InferencePlan*>(nullptr), &plan}) {
+            const std::string suffix = selectedPlan ? "_plan" : "";
+            inference.setInferencePlan(selectedPlan);
+            run(options, "process_data_inference" + suffix + "/zscore/8-64-64-1/10000", numBars, [&] {
+                g_sink = inference.processData(bars, indicators, true)[0];
+            });
+            size_t bar = 0;
+            run(options, "on_bar" + suffix + "/zscore/8-64-64-1", 1, [&] {
+                g_sink = inference.onBar(bars[bar], rows.data() + bar * indicators.size());
+                bar = bar + 1 == numBars ? 0 : bar + 1;
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.minTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            options.printStats = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time <seconds>] [--stats]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("{\"meta\": {\"simd\": \"%s\", \"seed\": %u, \"min_time_s\": %.3f, \"pointer_bits\": %zu}}\n",
+                kernels::simdLevel(), kSeed, options.minTime, sizeof(void*) * 8);
+
+    benchLayers(options);
+    benchPrediction(options);
+    benchPredictionThreads(options);
+    benchStaticNetwork(options);
+    benchActivations(options);
+    benchTraining(options);
+    benchNormalization(options);
+    benchModelFiles(options);
+    benchProcessData(options);
+    benchInferencePlan(options);
+    if (options.printStats) {
+        std::printf("{\"instrumentation\": %s}\n", instrumentation::toJson().c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// counted_allocation.h
+#ifndef COUNTED_ALLOCATION_H
+#define COUNTED_ALLOCATION_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc
+#endif
+
+// Replacement global operator new/delete that report every allocation, for the DLL's getNetworkStats,
+// the benchmarks and the allocation test. A program defines them once, in one source file, with
+// NN_DEFINE_COUNTED_NEW(onAllocate); onAllocate(size) runs before each allocation.
+namespace counted_allocation {
+
+    // size bytes (at least one), aligned to alignment when that is more than malloc guarantees.
+    inline void* allocate(std::size_t size, std::size_t alignment) {
+        if (size == 0) {
+            size = 1;
+        }
+        void* p;
+#ifdef _WIN32
+        p = alignment > alignof(std::max_align_t) ? _aligned_malloc(size, alignment) : std::malloc(size);
+#else
+        p = alignment > alignof(std::max_align_t) ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                                                  : std::malloc(size);
+#endif
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    inline void release(void* p, std::size_t alignment) noexcept {
+#ifdef _WIN32
+        if (alignment > alignof(std::max_align_t)) {
+            _aligned_free(p);
+            return;
+        }
+#else
+        (void)alignment;
+#endif
+        std::free(p);
+    }
+}
+
+#define NN_DEFINE_COUNTED_NEW(onAllocate)                                                                      \
+    void* operator new(std::size_t size) {                                                                     \
+        onAllocate(size);                                                                                      \
+        return counted_allocation::allocate(size, 0);                                                          \
+    }                                                                                                          \
+    void* operator new[](std::size_t size) {                                                                   \
+        onAllocate(size);                                                                                      \
+        return counted_allocation::allocate(size, 0);                                                          \
+    }                                                                                                          \
+    void* operator new(std::size_t size, std::align_val_t alignment) {                                         \
+        onAllocate(size);                                                                                      \
+        return counted_allocation::allocate(size, static_cast<std::size_t>(alignment));                        \
+    }                                                                                                          \
+    void* operator new[](std::size_t size, std::align_val_t alignment) {                                       \
+        onAllocate(size);                                                                                      \
+        return counted_allocation::allocate(size, static_cast<std::size_t>(alignment));                        \
+    }                                                                                                          \
+    void operator delete(void* p) noexcept { counted_allocation::release(p, 0); }                              \
+    void operator delete[](void* p) noexcept { counted_allocation::release(p, 0); }                            \
+    void operator delete(void* p, std::size_t) noexcept { counted_allocation::release(p, 0); }                 \
+    void operator delete[](void* p, std::size_t) noexcept { counted_allocation::release(p, 0); }               \
+    void operator delete(void* p, std::align_val_t alignment) noexcept {                                       \
+        counted_allocation::release(p, static_cast<std::size_t>(alignment));                                   \
+    }                                                                                                          \
+    void operator delete[](void* p, std::align_val_t alignment) noexcept {                                     \
+        counted_allocation::release(p, static_cast<std::size_t>(alignment));                                   \
+    }                                                                                                          \
+    void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept {                          \
+        counted_allocation::release(p, static_cast<std::size_t>(alignment));                                   \
+    }                                                                                                          \
+    void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept {                        \
+        counted_allocation::release(p, static_cast<std::size_t>(alignment));                                   \
+    }
+
+#endif // COUNTED_ALLOCATION_H
@@ -1,9 +1,51 @@
 // data_normalization.cpp
 
 #include "data_normalization.h"
+#include "math_kernels.h"
+#include "thread_pool.h"
 #include <cmath>
+#include <memory>
 #include <numeric>
 
+namespace {
+
+    // Below this many values per thread, starting threads costs more than it saves.
+    constexpr size_t kMinValuesPerThread = size_t(1) << 16;
+
+    size_t threadsFor(size_t n, size_t numThreads) {
+        return std::min(numThreads, std::max<size_t>(1, n / kMinValuesPerThread));
+    }
+
+    // Pool for the loops of one normalize call over at most n values each, started once and shared
+    // by all of them; null when they would all run on the calling thread.
+    std::unique_ptr<ThreadPool> makePool(size_t n, size_t numThreads) {
+        const size_t threads = threadsFor(n, numThreads);
+        return threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+    }
+
+    // Calls f(begin, end) on contiguous slices of [0, n), one per thread of pool (which may be null)
+    // at most; shorter ranges use fewer threads.
+    template <typename F>
+    void forEachRange(ThreadPool* pool, size_t n, F f) {
+        const size_t threads = pool ? threadsFor(n, pool->getThreadCount()) : 1;
+        if (threads <= 1) {
+            f(size_t(0), n);
+            return;
+        }
+        pool->run([&](size_t t) {
+            if (t < threads) {
+                f(n * t / threads, n * (t + 1) / threads);
+            }
+        });
+    }
+
+    // Z-score against online statistics; 0 until the feature has a spread.
+    double zScore(const RunningStats& stats, double value) {
+        const double stdDev = stats.getStd();
+        return stdDev > 0.0 ? (value - stats.getMean()) / stdDev : 0.0;
+    }
+}
+
 
 
 DataNormalization::DataNormalization(NormalizationType type) : type_(type) {}
@@ -12,19 +54,114 @@ DataNormalization::DataNormalization(NormalizationType type) : type_(type) {}
 
 void DataNormalization::normalizeBarData(DataStorage& dataStorage)
 {
+    if (type_ == NormalizationType::ZScore && onlineStats_) {
+        normalizeOnline(dataStorage);
+        return;
+    }
+
     if(type_ == NormalizationType::ZScore && std_ == 0.0)
     {
-        calculateMeanStd(dataStorage.getBarData());
+        calculateMeanStd(dataStorage.getClose());
     }
 
-    std::vector<BarData> normalizedBarData = normalizeBarData(dataStorage.getBarData());
-    dataStorage.clear(); //Clear existing data
-    for(const auto& bar : normalizedBarData)
-    {
-        dataStorage.addBarData(bar);
+    // Rewrite the bar columns in place with the SIMD kernels; indicator columns are left as they are.
+    Span<double> open = dataStorage.getOpen();
+    Span<double> close = dataStorage.getClose();
+    Span<double> high = dataStorage.getHigh();
+    Span<double> low = dataStorage.getLow();
+    if (type_ == NormalizationType::ZScore && std_ == 0.0) {
+        return; // as normalizeZScore: bars are left unchanged
+    }
+    const std::unique_ptr<ThreadPool> pool = makePool(open.size(), numThreads_);
+    switch (type_) {
+        case NormalizationType::MinMax:
+            forEachRange(pool.get(), open.size(), [&](size_t begin, size_t end) {
+                kernels::minMaxScaleBars(open.data() + begin, close.data() + begin, high.data() + begin, low.data() + begin,
+                                         end - begin, minRange_, maxRange_);
+            });
+            break;
+        case NormalizationType::ZScore: {
+            const double scale = 1.0 / std_;
+            const double offset = -mean_ * scale;
+            forEachRange(pool.get(), open.size(), [&](size_t begin, size_t end) {
+                kernels::scaleShift(open.data() + begin, end - begin, scale, offset);
+                kernels::scaleShift(close.data() + begin, end - begin, scale, offset);
+                kernels::scaleShift(high.data() + begin, end - begin, scale, offset);
+                kernels::scaleShift(low.data() + begin, end - begin, scale, offset);
+            });
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown normalization type.");
+    }
+}
+
+void DataNormalization::normalizeOnline(DataStorage& dataStorage)
+{
+    Span<double> open = dataStorage.getOpen();
+    Span<double> close = dataStorage.getClose();
+    Span<double> high = dataStorage.getHigh();
+    Span<double> low = dataStorage.getLow();
+    std::vector<Span<double>> indicators(dataStorage.getIndicatorCount());
+    for (size_t id = 0; id < indicators.size(); ++id) {
+        indicators[id] = dataStorage.getIndicatorView(id);
+    }
+    if (featureStats_.size() < 4 + indicators.size()) {
+        featureStats_.resize(4 + indicators.size(), statsPrototype_);
+    }
+
+    // Each bar is normalized with the statistics of the bars up to and including itself.
+    for (size_t i = 0; i < open.size(); ++i) {
+        double* values[4] = {&open[i], &close[i], &high[i], &low[i]};
+        for (size_t f = 0; f < 4; ++f) {
+            featureStats_[f].update(*values[f]);
+            *values[f] = zScore(featureStats_[f], *values[f]);
+        }
+        for (size_t k = 0; k < indicators.size(); ++k) {
+            if (i < indicators[k].size()) {
+                RunningStats& stats = featureStats_[4 + k];
+                stats.update(indicators[k][i]);
+                indicators[k][i] = zScore(stats, indicators[k][i]);
+            }
+        }
+    }
+}
+
+void DataNormalization::normalizeIndicators(DataStorage& dataStorage) const
+{
+    size_t longestColumn = 0;
+    for (size_t id = 0; id < dataStorage.getIndicatorCount(); ++id) {
+        longestColumn = std::max(longestColumn, dataStorage.getIndicatorView(id).size());
     }
+    const std::unique_ptr<ThreadPool> pool = makePool(longestColumn, numThreads_);
+
+    for (size_t id = 0; id < dataStorage.getIndicatorCount(); ++id) {
+        Span<double> column = dataStorage.getIndicatorView(id);
+        if (column.empty()) {
+            continue;
+        }
 
+        double scale;
+        double offset;
+        if (type_ == NormalizationType::MinMax) {
+            double minValue, maxValue;
+            kernels::columnMinMax(column.data(), column.size(), minValue, maxValue);
+            scale = maxValue > minValue ? (maxRange_ - minRange_) / (maxValue - minValue) : 0.0;
+            offset = minRange_ - minValue * scale;
+        } else {
+            double mean, stdDev;
+            kernels::columnMeanStd(column.data(), column.size(), mean, stdDev);
+            if (stdDev == 0.0) {
+                continue;
+            }
+            scale = 1.0 / stdDev;
+            offset = -mean * scale;
+        }
 
+        forEachRange(pool.get(), column.size(), [&](size_t begin, size_t end) {
+            kernels::scaleShift(column.data() + begin, end - begin, scale, offset);
+        });
+    }
 }
 
 
@@ -35,6 +172,15 @@ std::vector<BarData> DataNormalization::normalizeBarData(const std::vector<BarDa
         case NormalizationType::MinMax:
             return normalizeMinMax(barData);
         case NormalizationType::ZScore:
+            if (onlineStats_) {
+                std::vector<BarData> normalizedData;
+                normalizedData.reserve(barData.size());
+                for (const auto& bar : barData) {
+                    updateStats(bar);
+                    normalizedData.push_back(normalizeZScore(bar));
+                }
+                return normalizedData;
+            }
             if (std_ == 0.0) {
                  calculateMeanStd(barData);
             }
@@ -46,34 +192,75 @@ std::vector<BarData> DataNormalization::normalizeBarData(const std::vector<BarDa
 }
 
 
+BarData DataNormalization::normalizeBar(const BarData& bar) const {
+    switch (type_) {
+        case NormalizationType::MinMax:
+            return normalizeMinMax(bar);
+        case NormalizationType::ZScore:
+            // With std_ unset, normalizeBarData would derive a zero std from this bar alone and
+            // leave it unchanged; normalizeZScore does the same without touching mean_/std_.
+            return normalizeZScore(bar);
+        default:
+            throw std::runtime_error("Unknown normalization type.");
+    }
+}
+
+void DataNormalization::setThreadCount(size_t numThreads) {
+    if (numThreads == 0) {
+        throw std::invalid_argument("Thread count must be greater than zero.");
+    }
+    numThreads_ = numThreads;
+}
+
+size_t DataNormalization::getThreadCount() const {
+    return numThreads_;
+}
+
 void DataNormalization::setNormalizationType(NormalizationType type) {
     type_ = type;
 }
 
+DataNormalization::NormalizationType DataNormalization::getNormalizationType() const {
+    return type_;
+}
+
 void DataNormalization::setMinMaxRange(double min, double max) {
     minRange_ = min;
     maxRange_ = max;
 }
 
+double DataNormalization::getMinRange() const {
+    return minRange_;
+}
+
+double DataNormalization::getMaxRange() const {
+    return maxRange_;
+}
+
 void DataNormalization::calculateMeanStd(const std::vector<BarData>& barData) {
 
     if(barData.empty())
     {
         return; // or throw an exception
     }
-    double sum = 0.0;
+    // One Welford pass over the close prices.
+    RunningStats stats;
     for (const auto& bar : barData) {
-        sum += bar.close; // Or calculate based on another field or combination of fields
+        stats.update(bar.close);
     }
+    mean_ = stats.getMean();
+    std_ = stats.getStd();
+
+}
 
-    mean_ = sum / barData.size();
-    double sq_sum = 0.0;
-    for (const auto& bar : barData) {
-        sq_sum += std::pow(bar.close - mean_, 2);
-    }
 
-    std_ = std::sqrt(sq_sum / barData.size());
+void DataNormalization::calculateMeanStd(Span<const double> close) {
 
+    if(close.empty())
+    {
+        return;
+    }
+    kernels::columnMeanStd(close.data(), close.size(), mean_, std_);
 }
 
 
@@ -83,6 +270,84 @@ void DataNormalization::setMeanStd(double mean, double std)
     std_ = std;
 }
 
+double DataNormalization::getMean() const {
+    return mean_;
+}
+
+double DataNormalization::getStd() const {
+    return std_;
+}
+
+void DataNormalization::enableOnlineStats(const RunningStats& prototype) {
+    statsPrototype_ = prototype;
+    statsPrototype_.reset();
+    featureStats_.assign(4, statsPrototype_);
+    onlineStats_ = true;
+}
+
+void DataNormalization::disableOnlineStats() {
+    onlineStats_ = false;
+    featureStats_.clear();
+}
+
+bool DataNormalization::hasOnlineStats() const {
+    return onlineStats_;
+}
+
+void DataNormalization::updateStats(const BarData& bar, const double* indicators, size_t numIndicators) {
+    if (!onlineStats_) {
+        return;
+    }
+    if (featureStats_.size() < 4 + numIndicators) {
+        featureStats_.resize(4 + numIndicators, statsPrototype_);
+    }
+    featureStats_[0].update(bar.open);
+    featureStats_[1].update(bar.close);
+    featureStats_[2].update(bar.high);
+    featureStats_[3].update(bar.low);
+    for (size_t k = 0; k < numIndicators; ++k) {
+        featureStats_[4 + k].update(indicators[k]);
+    }
+}
+
+double DataNormalization::normalizeIndicator(size_t index, double value) const {
+    if (!onlineStats_ || type_ != NormalizationType::ZScore || 4 + index >= featureStats_.size()) {
+        return value;
+    }
+    return zScore(featureStats_[4 + index], value);
+}
+
+const std::vector<RunningStats>& DataNormalization::getFeatureStats() const {
+    return featureStats_;
+}
+
+void DataNormalization::saveStats(std::ostream& out) const {
+    if (!onlineStats_) {
+        throw std::runtime_error("Online statistics are not enabled.");
+    }
+    statsPrototype_.save(out);
+    out << featureStats_.size() << "\n";
+    for (const auto& stats : featureStats_) {
+        stats.save(out);
+    }
+}
+
+void DataNormalization::loadStats(std::istream& in) {
+    RunningStats prototype;
+    prototype.load(in);
+    size_t numFeatures;
+    if (!(in >> numFeatures) || numFeatures < 4) {
+        throw std::runtime_error("Could not read normalization statistics.");
+    }
+    std::vector<RunningStats> featureStats(numFeatures);
+    for (auto& stats : featureStats) {
+        stats.load(in);
+    }
+    statsPrototype_ = prototype;
+    featureStats_ = std::move(featureStats);
+    onlineStats_ = true;
+}
+
 std::vector<BarData> DataNormalization::normalizeMinMax(const std::vector<BarData>& barData) const {
 
     std::vector<BarData> normalizedData;
@@ -138,6 +403,11 @@ std::vector<BarData> DataNormalization::normalizeZScore(const std::vector<BarDat
 
 BarData DataNormalization::normalizeZScore(const BarData& bar) const
 {
+        if (onlineStats_) {
+            return BarData(zScore(featureStats_[0], bar.open), zScore(featureStats_[1], bar.close),
+                           zScore(featureStats_[2], bar.high), zScore(featureStats_[3], bar.low));
+        }
+
         if (std_ == 0.0) {
             // Handle the case where standard deviation is zero to avoid division by zero
             return bar; // Or throw an exception, or return a specific value
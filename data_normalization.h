@@ -6,7 +6,10 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm> // Make sure to include this for min/max operations
+#include <istream>
+#include <ostream>
 #include "data_storage.h" // Include your data storage header
+#include "running_stats.h"
 
 
 class DataNormalization {
@@ -19,17 +22,50 @@ public:
     DataNormalization(NormalizationType type = NormalizationType::MinMax);
     
     void normalizeBarData(DataStorage& dataStorage); // Modifies the DataStorage object directly
+    // Normalizes every indicator column of dataStorage in place, each with statistics of its own column:
+    // MinMax maps the column's [min, max] onto [minRange, maxRange], ZScore subtracts its mean and divides by its std.
+    void normalizeIndicators(DataStorage& dataStorage) const;
     std::vector<BarData> normalizeBarData(const std::vector<BarData>& barData);
+    // Normalizes one bar on its own, as normalizeBarData does for a single-bar DataStorage, without allocating.
+    BarData normalizeBar(const BarData& bar) const;
 
 
+    // Threads used by the in-place DataStorage paths on long histories (default 1).
+    void setThreadCount(size_t numThreads);
+    size_t getThreadCount() const;
+
     void setNormalizationType(NormalizationType type);
+    NormalizationType getNormalizationType() const;
 
     // MinMax specific
     void setMinMaxRange(double min, double max);
+    double getMinRange() const;
+    double getMaxRange() const;
 
     // ZScore specific
     void calculateMeanStd(const std::vector<BarData>& barData);
     void setMeanStd(double mean, double std);
+    double getMean() const;
+    double getStd() const;
+
+    // Online statistics: once enabled, updateStats feeds each bar's open, close, high and low and its
+    // indicator values into one RunningStats per feature (copies of prototype), in O(1) per bar.
+    // ZScore then scales every feature with its own current mean/std instead of the fixed mean/std
+    // above; a feature whose std is still zero (e.g. on the first bar) maps to 0. The in-place
+    // DataStorage path updates and normalizes bar by bar, bars and indicators alike, so training sees
+    // the same causal inputs streaming inference does.
+    void enableOnlineStats(const RunningStats& prototype = RunningStats());
+    void disableOnlineStats();
+    bool hasOnlineStats() const;
+    void updateStats(const BarData& bar, const double* indicators = nullptr, size_t numIndicators = 0);
+    // Normalized value of indicator column index; the value itself unless online ZScore is active.
+    double normalizeIndicator(size_t index, double value) const;
+    // Per feature: open, close, high, low, then the indicators in column order.
+    const std::vector<RunningStats>& getFeatureStats() const;
+
+    // Text form of the online statistics, stored with the model.
+    void saveStats(std::ostream& out) const;
+    void loadStats(std::istream& in); // enables online statistics
 
 
 private:
@@ -43,11 +79,20 @@ private:
     double mean_ = 0.0;
     double std_ = 1.0;
 
+    size_t numThreads_ = 1;
+
+    // Online statistics
+    bool onlineStats_ = false;
+    RunningStats statsPrototype_;
+    std::vector<RunningStats> featureStats_;
+
 
+    void calculateMeanStd(Span<const double> close);
     std::vector<BarData> normalizeMinMax(const std::vector<BarData>& barData) const;
     std::vector<BarData> normalizeZScore(const std::vector<BarData>& barData) const;
     BarData normalizeMinMax(const BarData& bar) const;
     BarData normalizeZScore(const BarData& bar) const;
+    void normalizeOnline(DataStorage& dataStorage);
 
 
 
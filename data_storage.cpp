@@ -0,0 +1,178 @@
+// data_storage.cpp
+
+#include "data_storage.h"
+
+
+void DataStorage::addBarData(const BarData& bar) {
+    addBarData(bar.open, bar.close, bar.high, bar.low);
+}
+
+void DataStorage::addBarData(double open, double close, double high, double low) {
+    open_.push_back(open);
+    close_.push_back(close);
+    high_.push_back(high);
+    low_.push_back(low);
+}
+
+void DataStorage::reserve(size_t numBars) {
+    open_.reserve(numBars);
+    close_.reserve(numBars);
+    high_.reserve(numBars);
+    low_.reserve(numBars);
+}
+
+void DataStorage::setBarColumns(Column&& open, Column&& close, Column&& high, Column&& low) {
+    if (close.size() != open.size() || high.size() != open.size() || low.size() != open.size()) {
+        throw std::invalid_argument("Bar columns must have the same length.");
+    }
+    open_ = std::move(open);
+    close_ = std::move(close);
+    high_ = std::move(high);
+    low_ = std::move(low);
+}
+
+std::vector<BarData> DataStorage::getBarData() const {
+    std::vector<BarData> bars;
+    bars.reserve(open_.size());
+    for (size_t i = 0; i < open_.size(); ++i) {
+        bars.emplace_back(open_[i], close_[i], high_[i], low_[i]);
+    }
+    return bars;
+}
+
+BarData DataStorage::getBarData(size_t index) const {
+    if (index >= open_.size()) {
+        throw std::out_of_range("Index out of range in getBarData");
+    }
+    return BarData(open_[index], close_[index], high_[index], low_[index]);
+}
+
+size_t DataStorage::getBarDataSize() const {
+    return open_.size();
+}
+
+Span<const double> DataStorage::getOpen() const {
+    return Span<const double>(open_.data(), open_.size());
+}
+
+Span<const double> DataStorage::getClose() const {
+    return Span<const double>(close_.data(), close_.size());
+}
+
+Span<const double> DataStorage::getHigh() const {
+    return Span<const double>(high_.data(), high_.size());
+}
+
+Span<const double> DataStorage::getLow() const {
+    return Span<const double>(low_.data(), low_.size());
+}
+
+Span<double> DataStorage::getOpen() {
+    return Span<double>(open_.data(), open_.size());
+}
+
+Span<double> DataStorage::getClose() {
+    return Span<double>(close_.data(), close_.size());
+}
+
+Span<double> DataStorage::getHigh() {
+    return Span<double>(high_.data(), high_.size());
+}
+
+Span<double> DataStorage::getLow() {
+    return Span<double>(low_.data(), low_.size());
+}
+
+
+void DataStorage::clear() {
+    open_.clear();
+    close_.clear();
+    high_.clear();
+    low_.clear();
+    indicatorSchema_ = IndicatorSchema();
+    indicatorData_.clear();
+}
+
+size_t DataStorage::addIndicatorData(const std::string& indicatorName, const std::vector<double>& indicatorData) {
+    return addIndicatorData(indicatorName, Column(indicatorData.begin(), indicatorData.end()));
+}
+
+size_t DataStorage::addIndicatorData(const std::string& indicatorName, Column&& indicatorData) {
+    const size_t id = indicatorSchema_.intern(indicatorName);
+    if (id == indicatorData_.size()) {
+        indicatorData_.push_back(std::move(indicatorData));
+    } else {
+        indicatorData_[id] = std::move(indicatorData);
+    }
+    return id;
+}
+
+size_t DataStorage::addIndicatorData(const std::string& indicatorName, std::initializer_list<double> indicatorData) {
+    return addIndicatorData(indicatorName, Column(indicatorData));
+}
+
+void DataStorage::appendIndicatorValue(size_t indicatorId, double value) {
+    if (indicatorId >= indicatorData_.size()) {
+        throw std::out_of_range("Indicator ID out of range in appendIndicatorValue");
+    }
+    indicatorData_[indicatorId].push_back(value);
+}
+
+std::vector<double> DataStorage::getIndicatorData(const std::string& indicatorName) const {
+    Span<const double> view = getIndicatorView(indicatorName);
+    return std::vector<double>(view.begin(), view.end());
+}
+
+
+std::map<std::string, std::vector<double>> DataStorage::getAllIndicatorData() const {
+    std::map<std::string, std::vector<double>> result;
+    for (size_t id = 0; id < indicatorData_.size(); ++id) {
+        result.emplace(indicatorSchema_.getName(id), std::vector<double>(indicatorData_[id].begin(), indicatorData_[id].end()));
+    }
+    return result;
+}
+
+Span<const double> DataStorage::getIndicatorView(const std::string& indicatorName) const {
+    return getIndicatorView(indicatorSchema_.getId(indicatorName));
+}
+
+Span<double> DataStorage::getIndicatorView(const std::string& indicatorName) {
+    return getIndicatorView(indicatorSchema_.getId(indicatorName));
+}
+
+Span<const double> DataStorage::getIndicatorView(size_t indicatorId) const {
+    if (indicatorId >= indicatorData_.size()) {
+        throw std::out_of_range("Indicator ID out of range.");
+    }
+    return Span<const double>(indicatorData_[indicatorId].data(), indicatorData_[indicatorId].size());
+}
+
+Span<double> DataStorage::getIndicatorView(size_t indicatorId) {
+    if (indicatorId >= indicatorData_.size()) {
+        throw std::out_of_range("Indicator ID out of range.");
+    }
+    return Span<double>(indicatorData_[indicatorId].data(), indicatorData_[indicatorId].size());
+}
+
+const IndicatorSchema& DataStorage::getIndicatorSchema() const {
+    return indicatorSchema_;
+}
+
+bool DataStorage::hasIndicator(const std::string& indicatorName) const {
+    return indicatorSchema_.contains(indicatorName);
+}
+
+void DataStorage::removeIndicator(const std::string& indicatorName) {
+    if (!indicatorSchema_.contains(indicatorName)) {
+        return;
+    }
+    const size_t removedId = indicatorSchema_.getId(indicatorName);
+    std::vector<std::string> names = indicatorSchema_.getNames();
+    names.erase(names.begin() + removedId);
+    indicatorData_.erase(indicatorData_.begin() + removedId);
+    indicatorSchema_ = IndicatorSchema(names);
+}
+
+size_t DataStorage::getIndicatorCount() const {
+    return indicatorData_.size();
+}
@@ -7,6 +7,10 @@
 #include <stdexcept>
 #include <string>
 #include <map>
+#include <initializer_list>
+#include "aligned_allocator.h"
+#include "span.h"
+#include "indicator_schema.h"
 
 class BarData {
 public:
@@ -19,24 +23,54 @@ public:
         open(open), close(close), high(high), low(low) {}
 };
 
+// Bars are stored column by column: open, close, high and low are separate 64-byte aligned arrays,
+// and so is every indicator series. Indicator names are interned once into an IndicatorSchema and
+// the series are addressed by ID. The column views (getOpen(), getIndicatorView(), ...) give
+// direct access without copying; they stay valid until bars are added, removed or replaced.
 class DataStorage {
 public:
+    using Column = AlignedVector<double>;
+
     DataStorage() = default;
 
     void addBarData(const BarData& bar);
     void addBarData(double open, double close, double high, double low);
+    void reserve(size_t numBars);
+
+    // Replaces all bars with the given columns, taking their buffers without copying. All four must have the same length.
+    void setBarColumns(Column&& open, Column&& close, Column&& high, Column&& low);
     
     std::vector<BarData> getBarData() const;
     BarData getBarData(size_t index) const;
     size_t getBarDataSize() const;
+
+    Span<const double> getOpen() const;
+    Span<const double> getClose() const;
+    Span<const double> getHigh() const;
+    Span<const double> getLow() const;
+    Span<double> getOpen();
+    Span<double> getClose();
+    Span<double> getHigh();
+    Span<double> getLow();
     
     void clear();
 
     // Методы для работы с данными индикаторов
-    void addIndicatorData(const std::string& indicatorName, const std::vector<double>& indicatorData);
+    // Adding a series under an existing name replaces it; both overloads return the indicator ID.
+    size_t addIndicatorData(const std::string& indicatorName, const std::vector<double>& indicatorData);
+    size_t addIndicatorData(const std::string& indicatorName, Column&& indicatorData); // takes the buffer without copying
+    size_t addIndicatorData(const std::string& indicatorName, std::initializer_list<double> indicatorData);
+    // Appends one value to an existing indicator series (amortized O(1)), e.g. for the bar just added.
+    void appendIndicatorValue(size_t indicatorId, double value);
     std::vector<double> getIndicatorData(const std::string& indicatorName) const;
     std::map<std::string, std::vector<double>> getAllIndicatorData() const;
+    Span<const double> getIndicatorView(const std::string& indicatorName) const;
+    Span<double> getIndicatorView(const std::string& indicatorName);
+    Span<const double> getIndicatorView(size_t indicatorId) const;
+    Span<double> getIndicatorView(size_t indicatorId);
+    const IndicatorSchema& getIndicatorSchema() const;
     bool hasIndicator(const std::string& indicatorName) const;
+    // IDs of the indicators registered after the removed one shift down by one.
     void removeIndicator(const std::string& indicatorName);
     size_t getIndicatorCount() const;
 
@@ -44,72 +78,12 @@ public:
 
 
 private:
-    std::vector<BarData> barData_;
-    std::map<std::string, std::vector<double>> indicatorData_; //  Хранение данных индикаторов,  ключ - имя индикатора
+    Column open_;
+    Column close_;
+    Column high_;
+    Column low_;
+    IndicatorSchema indicatorSchema_;
+    std::vector<Column> indicatorData_; //  Хранение данных индикаторов, индекс - ID индикатора
 };
 
 #endif // DATA_STORAGE_H
-
-
-// data_storage.cpp
-
-#include "data_storage.h"
-
-
-void DataStorage::addBarData(const BarData& bar) {
-    barData_.push_back(bar);
-}
-
-void DataStorage::addBarData(double open, double close, double high, double low) {
-    barData_.emplace_back(open, close, high, low);
-}
-
-std::vector<BarData> DataStorage::getBarData() const {
-    return barData_;
-}
-
-BarData DataStorage::getBarData(size_t index) const {
-    if (index >= barData_.size()) {
-        throw std::out_of_range("Index out of range in getBarData");
-    }
-    return barData_[index];
-}
-
-size_t DataStorage::getBarDataSize() const {
-    return barData_.size();
-}
-
-
-void DataStorage::clear() {
-    barData_.clear();
-    indicatorData_.clear();
-}
-
-void DataStorage::addIndicatorData(const std::string& indicatorName, const std::vector<double>& indicatorData) {
-    indicatorData_[indicatorName] = indicatorData;
-}
-
-std::vector<double> DataStorage::getIndicatorData(const std::string& indicatorName) const {
-    auto it = indicatorData_.find(indicatorName);
-    if (it == indicatorData_.end()) {
-        throw std::invalid_argument("Indicator not found: " + indicatorName);
-    }
-    return it->second;
-}
-
-
-std::map<std::string, std::vector<double>> DataStorage::getAllIndicatorData() const {
-    return indicatorData_;
-}
-
-bool DataStorage::hasIndicator(const std::string& indicatorName) const {
-    return indicatorData_.count(indicatorName) > 0;
-}
-
-void DataStorage::removeIndicator(const std::string& indicatorName) {
-    indicatorData_.erase(indicatorName);
-}
-
-size_t DataStorage::getIndicatorCount() const {
-    return indicatorData_.size();
-}
\ No newline at end of file
@@ -0,0 +1,367 @@
+// indicator_engine.cpp
+#include "indicator_engine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    double rsiFromAverages(double averageGain, double averageLoss) {
+        if (averageLoss == 0.0) {
+            return averageGain == 0.0 ? 50.0 : 100.0;
+        }
+        return 100.0 - 100.0 / (1.0 + averageGain / averageLoss);
+    }
+
+    double trueRange(double high, double low, double previousClose) {
+        return std::max({high - low, std::fabs(high - previousClose), std::fabs(low - previousClose)});
+    }
+
+    Span<const double> fieldColumn(const DataStorage& dataStorage, IndicatorEngine::PriceField field) {
+        switch (field) {
+            case IndicatorEngine::PriceField::Open: return dataStorage.getOpen();
+            case IndicatorEngine::PriceField::Close: return dataStorage.getClose();
+            case IndicatorEngine::PriceField::High: return dataStorage.getHigh();
+            case IndicatorEngine::PriceField::Low: return dataStorage.getLow();
+            default: throw std::runtime_error("Unknown price field.");
+        }
+    }
+
+    double fieldValue(const BarData& bar, IndicatorEngine::PriceField field) {
+        switch (field) {
+            case IndicatorEngine::PriceField::Open: return bar.open;
+            case IndicatorEngine::PriceField::Close: return bar.close;
+            case IndicatorEngine::PriceField::High: return bar.high;
+            case IndicatorEngine::PriceField::Low: return bar.low;
+            default: throw std::runtime_error("Unknown price field.");
+        }
+    }
+
+    // Rolling extreme of every window of `period` values in O(1) per value without a deque
+    // (van Herk / Gil-Werman): within blocks of `period` values, the running extreme from the block
+    // start (out) and to the block end (suffix) combine into the extreme of any window.
+    // Windows that start before x[0] cover x[0..i], which is the first block's running extreme.
+    template <typename Better>
+    void rollingExtremes(const double* x, size_t n, size_t period, double* out, Better better) {
+        std::vector<double> suffix(n);
+        for (size_t begin = 0; begin < n; begin += period) {
+            const size_t end = std::min(begin + period, n);
+            out[begin] = x[begin];
+            for (size_t i = begin + 1; i < end; ++i) {
+                out[i] = better(out[i - 1], x[i]);
+            }
+            suffix[end - 1] = x[end - 1];
+            for (size_t i = end - 1; i > begin; --i) {
+                suffix[i - 1] = better(suffix[i], x[i - 1]);
+            }
+        }
+        for (size_t i = period - 1; i < n; ++i) {
+            out[i] = better(suffix[i + 1 - period], out[i]);
+        }
+    }
+}
+
+double IndicatorEngine::Smoother::update(double x) {
+    ++count;
+    const double weight = std::max(alpha, 1.0 / static_cast<double>(count));
+    value += weight * (x - value);
+    return value;
+}
+
+void IndicatorEngine::MonotonicWindow::reset() {
+    values.assign(period, 0.0);
+    positions.assign(period, 0);
+    head = 0;
+    size = 0;
+    position = 0;
+}
+
+double IndicatorEngine::MonotonicWindow::push(double x) {
+    // Values the new one dominates can no longer be the extreme of any later window.
+    while (size > 0) {
+        size_t back = head + size - 1;
+        if (back >= period) {
+            back -= period;
+        }
+        if (keepMax ? values[back] > x : values[back] < x) {
+            break;
+        }
+        --size;
+    }
+    // The front leaves the window after `period` pushes.
+    if (size > 0 && positions[head] + period <= position) {
+        head = head + 1 == period ? 0 : head + 1;
+        --size;
+    }
+    size_t tail = head + size;
+    if (tail >= period) {
+        tail -= period;
+    }
+    values[tail] = x;
+    positions[tail] = position;
+    ++size;
+    ++position;
+    return values[head];
+}
+
+size_t IndicatorEngine::addIndicator(const std::string& name, const IndicatorSpec& spec) {
+    if (spec.period == 0 || spec.slowPeriod == 0 || spec.signalPeriod == 0) {
+        throw std::invalid_argument("Indicator periods must be greater than zero.");
+    }
+    if (schema_.contains(name)) {
+        throw std::invalid_argument("Indicator already registered: " + name);
+    }
+
+    Indicator indicator;
+    indicator.spec = spec;
+    indicators_.push_back(std::move(indicator));
+    const size_t id = schema_.intern(name);
+    reset();
+    return id;
+}
+
+const IndicatorSchema& IndicatorEngine::getSchema() const {
+    return schema_;
+}
+
+size_t IndicatorEngine::getIndicatorCount() const {
+    return indicators_.size();
+}
+
+void IndicatorEngine::reset() {
+    for (auto& indicator : indicators_) {
+        resetState(indicator);
+    }
+}
+
+void IndicatorEngine::resetState(Indicator& indicator) {
+    const IndicatorSpec& spec = indicator.spec;
+    const double period = static_cast<double>(spec.period);
+    indicator.fast = Smoother();
+    indicator.slow = Smoother();
+    indicator.signal = Smoother();
+    indicator.hasPrevious = false;
+    indicator.previousClose = 0.0;
+
+    switch (spec.type) {
+        case IndicatorType::SMA:
+        case IndicatorType::BollingerUpper:
+        case IndicatorType::BollingerLower:
+            indicator.window = RunningStats(RunningStats::Mode::Window, 1.0, spec.period);
+            break;
+        case IndicatorType::EMA:
+            indicator.fast.alpha = 2.0 / (period + 1.0);
+            break;
+        case IndicatorType::RSI:
+            indicator.fast.alpha = 1.0 / period; // gains
+            indicator.slow.alpha = 1.0 / period; // losses
+            break;
+        case IndicatorType::ATR:
+            indicator.fast.alpha = 1.0 / period;
+            break;
+        case IndicatorType::MACD:
+        case IndicatorType::MACDSignal:
+        case IndicatorType::MACDHistogram:
+            indicator.fast.alpha = 2.0 / (period + 1.0);
+            indicator.slow.alpha = 2.0 / (static_cast<double>(spec.slowPeriod) + 1.0);
+            indicator.signal.alpha = 2.0 / (static_cast<double>(spec.signalPeriod) + 1.0);
+            break;
+        case IndicatorType::RollingMin:
+        case IndicatorType::RollingMax:
+            indicator.extremes.period = spec.period;
+            indicator.extremes.keepMax = spec.type == IndicatorType::RollingMax;
+            indicator.extremes.reset();
+            break;
+        default:
+            throw std::runtime_error("Unknown indicator type.");
+    }
+}
+
+double IndicatorEngine::stepValue(Indicator& indicator, double x) {
+    switch (indicator.spec.type) {
+        case IndicatorType::SMA:
+            indicator.window.update(x);
+            return indicator.window.getMean();
+        case IndicatorType::EMA:
+            return indicator.fast.update(x);
+        case IndicatorType::BollingerUpper:
+            indicator.window.update(x);
+            return indicator.window.getMean() + indicator.spec.numStd * indicator.window.getStd();
+        case IndicatorType::BollingerLower:
+            indicator.window.update(x);
+            return indicator.window.getMean() - indicator.spec.numStd * indicator.window.getStd();
+        case IndicatorType::MACD:
+            return indicator.fast.update(x) - indicator.slow.update(x);
+        case IndicatorType::MACDSignal:
+            return indicator.signal.update(indicator.fast.update(x) - indicator.slow.update(x));
+        case IndicatorType::MACDHistogram: {
+            const double line = indicator.fast.update(x) - indicator.slow.update(x);
+            return line - indicator.signal.update(line);
+        }
+        default:
+            throw std::runtime_error("Indicator does not take a single price series.");
+    }
+}
+
+double IndicatorEngine::stepRSI(Indicator& indicator, double close) {
+    if (indicator.hasPrevious) {
+        const double change = close - indicator.previousClose;
+        indicator.fast.update(std::max(change, 0.0));
+        indicator.slow.update(std::max(-change, 0.0));
+    }
+    indicator.previousClose = close;
+    indicator.hasPrevious = true;
+    return rsiFromAverages(indicator.fast.value, indicator.slow.value);
+}
+
+double IndicatorEngine::stepATR(Indicator& indicator, double high, double low, double close) {
+    const double range = indicator.hasPrevious ? trueRange(high, low, indicator.previousClose) : high - low;
+    indicator.previousClose = close;
+    indicator.hasPrevious = true;
+    return indicator.fast.update(range);
+}
+
+double IndicatorEngine::step(Indicator& indicator, const BarData& bar) {
+    switch (indicator.spec.type) {
+        case IndicatorType::RSI:
+            return stepRSI(indicator, bar.close);
+        case IndicatorType::ATR:
+            return stepATR(indicator, bar.high, bar.low, bar.close);
+        case IndicatorType::RollingMin:
+        case IndicatorType::RollingMax:
+            return indicator.extremes.push(fieldValue(bar, indicator.spec.field));
+        default:
+            return stepValue(indicator, fieldValue(bar, indicator.spec.field));
+    }
+}
+
+void IndicatorEngine::update(const BarData& bar, double* values) {
+    for (size_t id = 0; id < indicators_.size(); ++id) {
+        values[id] = step(indicators_[id], bar);
+    }
+}
+
+void IndicatorEngine::onBar(DataStorage& dataStorage, const BarData& bar) {
+    // Resolve the target series before changing any state.
+    const IndicatorSchema& storageSchema = dataStorage.getIndicatorSchema();
+    storageIds_.resize(indicators_.size());
+    for (size_t id = 0; id < indicators_.size(); ++id) {
+        storageIds_[id] = storageSchema.getId(schema_.getName(id));
+        if (dataStorage.getIndicatorView(storageIds_[id]).size() != dataStorage.getBarDataSize()) {
+            throw std::runtime_error("Indicator series does not match the stored bars: " + schema_.getName(id));
+        }
+    }
+
+    values_.resize(indicators_.size());
+    update(bar, values_.data());
+    dataStorage.addBarData(bar);
+    for (size_t id = 0; id < indicators_.size(); ++id) {
+        dataStorage.appendIndicatorValue(storageIds_[id], values_[id]);
+    }
+}
+
+void IndicatorEngine::backfill(DataStorage& dataStorage) {
+    reset();
+    const size_t numBars = dataStorage.getBarDataSize();
+    const DataStorage& bars = dataStorage;
+    Span<const double> close = bars.getClose();
+    Span<const double> high = bars.getHigh();
+    Span<const double> low = bars.getLow();
+
+    for (size_t id = 0; id < indicators_.size(); ++id) {
+        Indicator& indicator = indicators_[id];
+        DataStorage::Column column(numBars);
+        double* out = column.data();
+
+        // One indicator at a time over contiguous columns: the element-wise stages (true range,
+        // price changes, window sums and extremes) vectorize, and only the smoothing recursions of
+        // the EMA, MACD, RSI and ATR types stay serial.
+        switch (indicator.spec.type) {
+            case IndicatorType::RollingMin:
+            case IndicatorType::RollingMax:
+                backfillExtremes(indicator, fieldColumn(bars, indicator.spec.field), out);
+                break;
+            case IndicatorType::SMA:
+            case IndicatorType::BollingerUpper:
+            case IndicatorType::BollingerLower:
+                backfillWindow(indicator, fieldColumn(bars, indicator.spec.field), out);
+                break;
+            case IndicatorType::ATR:
+                if (numBars > 0) {
+                    out[0] = high[0] - low[0];
+                }
+                for (size_t i = 1; i < numBars; ++i) {
+                    out[i] = trueRange(high[i], low[i], close[i - 1]);
+                }
+                for (size_t i = 0; i < numBars; ++i) {
+                    out[i] = indicator.fast.update(out[i]);
+                }
+                if (numBars > 0) {
+                    indicator.previousClose = close[numBars - 1];
+                    indicator.hasPrevious = true;
+                }
+                break;
+            case IndicatorType::RSI:
+                if (numBars > 0) {
+                    out[0] = 0.0;
+                }
+                for (size_t i = 1; i < numBars; ++i) {
+                    out[i] = close[i] - close[i - 1];
+                }
+                for (size_t i = 0; i < numBars; ++i) {
+                    if (i > 0) {
+                        indicator.fast.update(std::max(out[i], 0.0));
+                        indicator.slow.update(std::max(-out[i], 0.0));
+                    }
+                    out[i] = rsiFromAverages(indicator.fast.value, indicator.slow.value);
+                }
+                if (numBars > 0) {
+                    indicator.previousClose = close[numBars - 1];
+                    indicator.hasPrevious = true;
+                }
+                break;
+            default: {
+                Span<const double> x = fieldColumn(bars, indicator.spec.field);
+                for (size_t i = 0; i < numBars; ++i) {
+                    out[i] = stepValue(indicator, x[i]);
+                }
+                break;
+            }
+        }
+        dataStorage.addIndicatorData(schema_.getName(id), std::move(column));
+    }
+}
+
+void IndicatorEngine::backfillWindow(Indicator& indicator, Span<const double> x, double* out) {
+    const size_t n = x.size();
+    const IndicatorSpec& spec = indicator.spec;
+    const double numStd = spec.type == IndicatorType::BollingerUpper ? spec.numStd
+                        : spec.type == IndicatorType::BollingerLower ? -spec.numStd : 0.0;
+    RunningStats::windowBands(x.data(), n, spec.period, numStd, out);
+
+    // The window after n updates: the last `period` values, with its blocks where they fall from
+    // the first bar, so replay from the start of the block before the current one.
+    const size_t first = n < spec.period ? 0 : (n / spec.period - 1) * spec.period;
+    for (size_t i = first; i < n; ++i) {
+        indicator.window.update(x[i]);
+    }
+}
+
+void IndicatorEngine::backfillExtremes(Indicator& indicator, Span<const double> x, double* out) {
+    const size_t n = x.size();
+    MonotonicWindow& window = indicator.extremes;
+    if (n == 0) {
+        return;
+    }
+    if (window.keepMax) {
+        rollingExtremes(x.data(), n, window.period, out, [](double a, double b) { return std::max(a, b); });
+    } else {
+        rollingExtremes(x.data(), n, window.period, out, [](double a, double b) { return std::min(a, b); });
+    }
+
+    // The deque after n pushes depends only on the last `period` values.
+    const size_t tail = std::min(window.period, n);
+    window.position = n - tail;
+    for (size_t i = n - tail; i < n; ++i) {
+        window.push(x[i]);
+    }
+}
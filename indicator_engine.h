@@ -0,0 +1,120 @@
+// indicator_engine.h
+#ifndef INDICATOR_ENGINE_H
+#define INDICATOR_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "data_storage.h"
+#include "indicator_schema.h"
+#include "running_stats.h"
+
+// Built-in technical indicators computed from bar data. Every indicator fills one column; its ID in
+// getSchema() is the order it was added, so the schema can be passed to InterfaceFunction as is.
+//
+// Both modes share the same state and give the same values:
+//  - backfill() computes every column over the bars already in a DataStorage, one indicator at a
+//    time over the contiguous columns, and leaves the state positioned after the last bar. SMA and
+//    Bollinger take the same block sums as the running window (RunningStats::windowBands);
+//  - update() / onBar() then advance every indicator by one bar in O(1).
+// Before an indicator has seen `period` bars it reports its value over the bars so far: SMA, EMA,
+// RSI and ATR average the first bars, RollingMin/Max the extreme so far. RSI is 50 until prices move.
+class IndicatorEngine {
+public:
+    enum class IndicatorType {
+        SMA,
+        EMA,
+        RSI,            // Wilder smoothing
+        ATR,            // Wilder smoothing
+        BollingerUpper, // SMA + numStd * std over period
+        BollingerLower, // SMA - numStd * std over period
+        MACD,           // EMA(period) - EMA(slowPeriod)
+        MACDSignal,     // EMA(signalPeriod) of MACD
+        MACDHistogram,  // MACD - MACDSignal
+        RollingMin,
+        RollingMax
+    };
+
+    enum class PriceField {
+        Open,
+        Close,
+        High,
+        Low
+    };
+
+    struct IndicatorSpec {
+        IndicatorType type;
+        size_t period;                        // fast period for the MACD types
+        PriceField field = PriceField::Close; // input of every type except RSI (close) and ATR (bars)
+        size_t slowPeriod = 26;               // MACD types
+        size_t signalPeriod = 9;              // MACDSignal, MACDHistogram
+        double numStd = 2.0;                  // Bollinger types
+    };
+
+    // Registers an indicator under name and returns its ID. Resets the streaming state.
+    size_t addIndicator(const std::string& name, const IndicatorSpec& spec);
+    const IndicatorSchema& getSchema() const;
+    size_t getIndicatorCount() const;
+
+    // Computes every indicator over all bars in dataStorage and stores it as the indicator series of
+    // the same name, replacing any series already there. Subsequent updates continue from the last bar.
+    void backfill(DataStorage& dataStorage);
+
+    // Advances every indicator by bar and writes getIndicatorCount() values to values, in ID order.
+    void update(const BarData& bar, double* values);
+
+    // Appends bar to dataStorage and one value to each of the engine's series there. The series
+    // must already exist with one value per stored bar, as backfill() leaves them.
+    void onBar(DataStorage& dataStorage, const BarData& bar);
+
+    // Forgets all bars seen; the registered indicators stay.
+    void reset();
+
+private:
+    // Exponential smoothing that averages the first values: the weight is max(alpha, 1 / count).
+    struct Smoother {
+        double alpha = 1.0;
+        size_t count = 0;
+        double value = 0.0;
+
+        double update(double x);
+    };
+
+    // Minimum or maximum over the last `period` values, as a monotonic deque kept in a ring buffer.
+    struct MonotonicWindow {
+        size_t period = 1;
+        bool keepMax = false;
+        std::vector<double> values;
+        std::vector<size_t> positions;
+        size_t head = 0;
+        size_t size = 0;
+        size_t position = 0; // of the next value pushed
+
+        void reset();
+        double push(double x);
+    };
+
+    struct Indicator {
+        IndicatorSpec spec;
+        RunningStats window;         // SMA, Bollinger
+        Smoother fast, slow, signal; // EMA, MACD; RSI gains and losses; ATR
+        MonotonicWindow extremes;    // RollingMin, RollingMax
+        double previousClose = 0.0;  // RSI, ATR
+        bool hasPrevious = false;
+    };
+
+    IndicatorSchema schema_;
+    std::vector<Indicator> indicators_;
+    std::vector<double> values_;     // onBar scratch
+    std::vector<size_t> storageIds_; // onBar scratch
+
+    static void resetState(Indicator& indicator);
+    static double step(Indicator& indicator, const BarData& bar);
+    static double stepValue(Indicator& indicator, double x); // SMA, EMA, Bollinger and MACD types
+    static double stepRSI(Indicator& indicator, double close);
+    static double stepATR(Indicator& indicator, double high, double low, double close);
+    static void backfillWindow(Indicator& indicator, Span<const double> x, double* out); // SMA, Bollinger
+    static void backfillExtremes(Indicator& indicator, Span<const double> x, double* out);
+};
+
+#endif // INDICATOR_ENGINE_H
@@ -0,0 +1,53 @@
+// indicator_schema.cpp
+#include "indicator_schema.h"
+
+IndicatorSchema::IndicatorSchema(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        if (contains(name)) {
+            throw std::invalid_argument("Duplicate indicator name: " + name);
+        }
+        intern(name);
+    }
+}
+
+size_t IndicatorSchema::intern(const std::string& name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    const size_t id = names_.size();
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
+}
+
+size_t IndicatorSchema::getId(const std::string& name) const {
+    auto it = ids_.find(name);
+    if (it == ids_.end()) {
+        throw std::invalid_argument("Indicator not found: " + name);
+    }
+    return it->second;
+}
+
+bool IndicatorSchema::contains(const std::string& name) const {
+    return ids_.count(name) > 0;
+}
+
+const std::string& IndicatorSchema::getName(size_t id) const {
+    if (id >= names_.size()) {
+        throw std::out_of_range("Indicator ID out of range.");
+    }
+    return names_[id];
+}
+
+const std::vector<std::string>& IndicatorSchema::getNames() const {
+    return names_;
+}
+
+size_t IndicatorSchema::size() const {
+    return names_.size();
+}
+
+bool IndicatorSchema::empty() const {
+    return names_.empty();
+}
@@ -0,0 +1,34 @@
+// indicator_schema.h
+#ifndef INDICATOR_SCHEMA_H
+#define INDICATOR_SCHEMA_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+
+// Interns indicator names to dense column IDs 0..size()-1, assigned once in registration order.
+// Names are resolved when data enters the library; per-bar code works with IDs only, and the ID
+// order is the feature column order (it does not depend on the alphabetical order of the names).
+class IndicatorSchema {
+public:
+    IndicatorSchema() = default;
+    explicit IndicatorSchema(const std::vector<std::string>& names); // IDs follow the order of names
+
+    // Returns the ID of name, registering it as the next column if it is new.
+    size_t intern(const std::string& name);
+    // Returns the ID of name; throws std::invalid_argument if it is not registered.
+    size_t getId(const std::string& name) const;
+    bool contains(const std::string& name) const;
+
+    const std::string& getName(size_t id) const;
+    const std::vector<std::string>& getNames() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, size_t> ids_;
+};
+
+#endif // INDICATOR_SCHEMA_H
@@ -0,0 +1,237 @@
+// inference_plan.cpp
+#include "inference_plan.h"
+#include "instrumentation.h"
+#include <algorithm>
+
+namespace {
+
+    // A layer in double while the plan is compiled, with unpadded rows.
+    struct DenseStep {
+        size_t numInputs = 0;
+        size_t numOutputs = 0;
+        std::vector<double> weights; // [numOutputs x numInputs]
+        std::vector<double> biases;
+        kernels::Activation activation = kernels::Activation::Identity;
+    };
+
+    template <typename T>
+    DenseStep toDense(const LayerT<T>& layer) {
+        DenseStep step;
+        step.numInputs = layer.getInputSize();
+        step.numOutputs = layer.getOutputSize();
+        step.weights.resize(step.numOutputs * step.numInputs);
+        step.biases.resize(step.numOutputs);
+        for (size_t r = 0; r < step.numOutputs; ++r) {
+            const T* row = layer.getWeightData() + r * layer.getWeightStride();
+            for (size_t j = 0; j < step.numInputs; ++j) {
+                step.weights[r * step.numInputs + j] = static_cast<double>(row[j]);
+            }
+            step.biases[r] = static_cast<double>(layer.getBiasData()[r]);
+        }
+        step.activation = layer.getKernelActivation();
+        return step;
+    }
+
+    // second(first(x)) for a first step without activation: W = W2 * W1, b = W2 * b1 + b2.
+    DenseStep merge(const DenseStep& first, const DenseStep& second) {
+        DenseStep merged;
+        merged.numInputs = first.numInputs;
+        merged.numOutputs = second.numOutputs;
+        merged.weights.assign(merged.numOutputs * merged.numInputs, 0.0);
+        merged.biases = second.biases;
+        merged.activation = second.activation;
+        for (size_t r = 0; r < second.numOutputs; ++r) {
+            double* row = merged.weights.data() + r * merged.numInputs;
+            for (size_t k = 0; k < second.numInputs; ++k) {
+                const double w = second.weights[r * second.numInputs + k];
+                const double* firstRow = first.weights.data() + k * first.numInputs;
+                for (size_t j = 0; j < first.numInputs; ++j) {
+                    row[j] += w * firstRow[j];
+                }
+                merged.biases[r] += w * first.biases[k];
+            }
+        }
+        return merged;
+    }
+
+    bool mergeSaves(const DenseStep& first, const DenseStep& second) {
+        return first.numInputs * second.numOutputs <= first.numInputs * first.numOutputs + second.numInputs * second.numOutputs;
+    }
+}
+
+template <typename T>
+InferencePlanT<T>::InferencePlanT(const NeuralNetworkT<T>& network, const DataNormalization& normalization, size_t lookback) :
+    numInputs_(network.getNumInputs()), numOutputs_(network.getNumOutputs()), lookback_(lookback),
+    mode_(network.getActivationMode())
+{
+    const auto& layers = network.getLayers();
+    if (layers.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before compiling an inference plan.");
+    }
+    if (lookback == 0 || numInputs_ % lookback != 0 || numInputs_ / lookback < 4) {
+        throw std::invalid_argument("Network inputs must hold at least the four prices of each bar in the window.");
+    }
+    const bool zScore = normalization.getNormalizationType() == DataNormalization::NormalizationType::ZScore;
+    if (zScore && normalization.hasOnlineStats()) {
+        throw std::invalid_argument("Online normalization statistics cannot be folded into an inference plan.");
+    }
+    numFeatures_ = numInputs_ / lookback;
+
+    std::vector<DenseStep> dense;
+    dense.reserve(layers.size());
+    for (const auto& layer : layers) {
+        dense.push_back(toDense(layer));
+    }
+    for (size_t i = 0; i + 1 < dense.size();) {
+        if (dense[i].activation == kernels::Activation::Identity && mergeSaves(dense[i], dense[i + 1])) {
+            dense[i] = merge(dense[i], dense[i + 1]);
+            dense.erase(dense.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    if (zScore && normalization.getStd() != 0.0) {
+        // w * (x - mean) / std = (w / std) * x - w * mean / std, for the price columns of every bar.
+        const double scale = 1.0 / normalization.getStd();
+        const double offset = -normalization.getMean() * scale;
+        DenseStep& first = dense.front();
+        for (size_t r = 0; r < first.numOutputs; ++r) {
+            double* row = first.weights.data() + r * first.numInputs;
+            for (size_t j = 0; j < first.numInputs; ++j) {
+                if (j % numFeatures_ < 4) {
+                    first.biases[r] += row[j] * offset;
+                    row[j] *= scale;
+                }
+            }
+        }
+    } else if (!zScore) {
+        minMaxPass_ = true;
+        minRange_ = normalization.getMinRange();
+        maxRange_ = normalization.getMaxRange();
+        maxWidth_ = numInputs_;
+    }
+
+    steps_.reserve(dense.size());
+    for (const auto& source : dense) {
+        Step step;
+        step.numInputs = source.numInputs;
+        step.numOutputs = source.numOutputs;
+        step.stride = kernels::paddedStride<T>(step.numInputs);
+        step.weights.assign(step.numOutputs * step.stride, T(0));
+        step.biases.resize(step.numOutputs);
+        for (size_t r = 0; r < step.numOutputs; ++r) {
+            for (size_t j = 0; j < step.numInputs; ++j) {
+                step.weights[r * step.stride + j] = static_cast<T>(source.weights[r * step.numInputs + j]);
+            }
+            step.biases[r] = static_cast<T>(source.biases[r]);
+        }
+        step.activation = source.activation;
+        maxWidth_ = std::max(maxWidth_, step.numOutputs);
+        steps_.push_back(std::move(step));
+    }
+}
+
+template <typename T>
+void InferencePlanT<T>::normalizeMinMax(const T* input, T* output) const {
+    std::copy(input, input + numInputs_, output);
+    for (size_t bar = 0; bar < lookback_; ++bar) {
+        T* prices = output + bar * numFeatures_;
+        const double open = prices[0], close = prices[1], high = prices[2], low = prices[3];
+        const double minVal = std::min({open, close, high, low});
+        const double maxVal = std::max({open, close, high, low});
+        if (minVal == maxVal) {
+            std::fill(prices, prices + 4, static_cast<T>(minRange_));
+            continue;
+        }
+        prices[0] = static_cast<T>(minRange_ + (open - minVal) * (maxRange_ - minRange_) / (maxVal - minVal));
+        prices[1] = static_cast<T>(minRange_ + (close - minVal) * (maxRange_ - minRange_) / (maxVal - minVal));
+        prices[2] = static_cast<T>(minRange_ + (high - minVal) * (maxRange_ - minRange_) / (maxVal - minVal));
+        prices[3] = static_cast<T>(minRange_ + (low - minVal) * (maxRange_ - minRange_) / (maxVal - minVal));
+    }
+}
+
+template <typename T>
+void InferencePlanT<T>::predictInto(const T* input, T* output) const {
+    thread_local InferenceWorkspaceT<T> workspace;
+    predictInto(input, output, workspace);
+}
+
+template <typename T>
+void InferencePlanT<T>::predictInto(const T* input, T* output, InferenceWorkspaceT<T>& workspace) const {
+    workspace.reserve(maxWidth_);
+
+    size_t buffer = 0;
+    const T* stepInput = input;
+    if (minMaxPass_) {
+        normalizeMinMax(input, workspace.getBuffer(buffer));
+        stepInput = workspace.getBuffer(buffer++);
+    }
+    NN_PROFILE_LAYERS();
+    for (size_t i = 0; i < steps_.size(); ++i) {
+        const Step& step = steps_[i];
+        T* stepOutput = i + 1 == steps_.size() ? output : workspace.getBuffer(buffer++);
+        kernels::gemv(step.weights.data(), step.stride, step.biases.data(), stepInput,
+                      step.numOutputs, step.numInputs, stepOutput, step.activation, mode_);
+        NN_PROFILE_LAYER_DONE(i);
+        stepInput = stepOutput;
+    }
+}
+
+template <typename T>
+std::vector<T> InferencePlanT<T>::predictBatch(const T* inputs, size_t numSamples, size_t inputStride) const {
+    // Chunks of samples go through all steps while their activations are in cache, as in NeuralNetworkT.
+    const size_t chunkSize = 256;
+    std::vector<T> normalized(minMaxPass_ ? chunkSize * numInputs_ : 0);
+    std::vector<T> bufferA(chunkSize * maxWidth_);
+    std::vector<T> bufferB(chunkSize * maxWidth_);
+    std::vector<T> outputs(numSamples * numOutputs_);
+
+    for (size_t start = 0; start < numSamples; start += chunkSize) {
+        const size_t count = std::min(chunkSize, numSamples - start);
+        const T* stepInput = inputs + start * inputStride;
+        size_t stepInputStride = inputStride;
+        if (minMaxPass_) {
+            for (size_t i = 0; i < count; ++i) {
+                normalizeMinMax(stepInput + i * inputStride, normalized.data() + i * numInputs_);
+            }
+            stepInput = normalized.data();
+            stepInputStride = numInputs_;
+        }
+        NN_PROFILE_LAYERS();
+        for (size_t i = 0; i < steps_.size(); ++i) {
+            const Step& step = steps_[i];
+            T* stepOutput = i + 1 == steps_.size() ? outputs.data() + start * numOutputs_
+                                                   : (i % 2 == 0 ? bufferA.data() : bufferB.data());
+            kernels::gemm(stepInput, count, stepInputStride, step.weights.data(), step.stride, step.biases.data(),
+                          step.numOutputs, step.numInputs, stepOutput, step.numOutputs, step.activation, mode_);
+            NN_PROFILE_LAYER_DONE(i);
+            stepInput = stepOutput;
+            stepInputStride = step.numOutputs;
+        }
+    }
+    return outputs;
+}
+
+template <typename T>
+size_t InferencePlanT<T>::getNumInputs() const {
+    return numInputs_;
+}
+
+template <typename T>
+size_t InferencePlanT<T>::getNumOutputs() const {
+    return numOutputs_;
+}
+
+template <typename T>
+size_t InferencePlanT<T>::getNumSteps() const {
+    return steps_.size();
+}
+
+template <typename T>
+bool InferencePlanT<T>::isNormalizationFolded() const {
+    return !minMaxPass_;
+}
+
+template class InferencePlanT<float>;
+template class InferencePlanT<double>;
@@ -0,0 +1,78 @@
+// inference_plan.h
+#ifndef INFERENCE_PLAN_H
+#define INFERENCE_PLAN_H
+
+#include <vector>
+#include <stdexcept>
+#include "aligned_allocator.h"
+#include "math_kernels.h"
+#include "neural_network.h"
+#include "data_normalization.h"
+#include "inference_workspace.h"
+
+// Immutable inference form of a network together with the normalization of its inputs, compiled once
+// after training or loading. The plan reads raw inputs: per bar the open, close, high and low prices
+// followed by the indicator values, repeated lookback times for a windowed network.
+//
+// Compiling:
+// - folds ZScore with a fixed mean/std into the first step: the scale goes into the weights of the
+//   price columns and the shift into the biases, so no separate normalization pass runs. ZScore with
+//   a zero std leaves the bars unchanged and folds to nothing.
+// - keeps MinMax as a pass over each bar's four prices, since it depends on the bar's own range and
+//   is not affine. It is done in double, as DataNormalization::normalizeBar does it.
+// - merges a layer with Identity activation (Linear or None) into the following layer when the
+//   product has no more weights than the two layers, so the linear pass disappears.
+// Biases and activations are applied in the same kernel call as the matrix product, as in LayerT.
+//
+// Online ZScore statistics change with every bar and cannot be folded; compiling with them throws.
+// Results agree with normalizing and then predicting up to rounding. A float plan receives the raw
+// prices rounded to float, before rather than after normalization, which costs about 1e-5 in its
+// outputs at price levels in the thousands.
+// Prediction is const and may run on several threads at once.
+template <typename T>
+class InferencePlanT {
+public:
+    // lookback: bars per network input; network.getNumInputs() must be a multiple of it with at
+    // least the four prices per bar. Throws std::invalid_argument otherwise or for online statistics.
+    InferencePlanT(const NeuralNetworkT<T>& network, const DataNormalization& normalization, size_t lookback = 1);
+
+    // Reads getNumInputs() raw values from input and writes getNumOutputs() values to output.
+    // The first overload uses a per-thread workspace that is sized on the first call.
+    void predictInto(const T* input, T* output) const;
+    void predictInto(const T* input, T* output, InferenceWorkspaceT<T>& workspace) const;
+    // Row-major batch; consecutive samples are inputStride values apart and may overlap (lagged windows).
+    std::vector<T> predictBatch(const T* inputs, size_t numSamples, size_t inputStride) const;
+
+    size_t getNumInputs() const;
+    size_t getNumOutputs() const;
+    size_t getNumSteps() const; // matrix products per prediction after merging
+    bool isNormalizationFolded() const; // false when a MinMax pass remains
+
+private:
+    struct Step {
+        size_t numInputs = 0;
+        size_t numOutputs = 0;
+        size_t stride = 0; // paddedStride<T>(numInputs)
+        AlignedVector<T> weights; // [numOutputs x stride], padding is zero
+        std::vector<T> biases;
+        kernels::Activation activation = kernels::Activation::Identity;
+    };
+
+    std::vector<Step> steps_;
+    size_t numInputs_ = 0;
+    size_t numOutputs_ = 0;
+    size_t maxWidth_ = 0; // widest step output or the input, for the workspace
+    size_t lookback_ = 1;
+    size_t numFeatures_ = 0; // per bar
+    bool minMaxPass_ = false;
+    double minRange_ = 0.0;
+    double maxRange_ = 1.0;
+    kernels::ActivationMode mode_ = kernels::ActivationMode::Exact;
+
+    void normalizeMinMax(const T* input, T* output) const;
+};
+
+using InferencePlan = InferencePlanT<double>;
+using InferencePlanF = InferencePlanT<float>;
+
+#endif // INFERENCE_PLAN_H
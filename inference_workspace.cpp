@@ -0,0 +1,31 @@
+// inference_workspace.cpp
+#include "inference_workspace.h"
+#include "math_kernels.h"
+
+template <typename T>
+InferenceWorkspaceT<T>::InferenceWorkspaceT(size_t maxLayerWidth) {
+    reserve(maxLayerWidth);
+}
+
+template <typename T>
+void InferenceWorkspaceT<T>::reserve(size_t maxLayerWidth) {
+    if (maxLayerWidth <= capacity_) {
+        return;
+    }
+    // Keep buffer 1 on a 64-byte boundary as well.
+    capacity_ = kernels::paddedStride<T>(maxLayerWidth);
+    storage_.assign(2 * capacity_, T(0));
+}
+
+template <typename T>
+size_t InferenceWorkspaceT<T>::getCapacity() const {
+    return capacity_;
+}
+
+template <typename T>
+T* InferenceWorkspaceT<T>::getBuffer(size_t index) {
+    return storage_.data() + (index & 1) * capacity_;
+}
+
+template class InferenceWorkspaceT<float>;
+template class InferenceWorkspaceT<double>;
@@ -0,0 +1,30 @@
+// inference_workspace.h
+#ifndef INFERENCE_WORKSPACE_H
+#define INFERENCE_WORKSPACE_H
+
+#include "aligned_allocator.h"
+
+// Scratch memory for one inference call: two ping-pong activation buffers, each wide
+// enough for the widest layer. Sized once from the network topology and reused, so
+// NeuralNetwork::predictInto does not touch the heap after the first call.
+// A workspace must not be shared between threads that predict at the same time.
+template <typename T>
+class InferenceWorkspaceT {
+public:
+    explicit InferenceWorkspaceT(size_t maxLayerWidth = 0);
+
+    // Grows the buffers if maxLayerWidth exceeds the current capacity; never shrinks.
+    void reserve(size_t maxLayerWidth);
+    size_t getCapacity() const;
+
+    T* getBuffer(size_t index); // index 0 or 1
+
+private:
+    size_t capacity_ = 0;
+    AlignedVector<T> storage_; // [capacity_] buffer 0, then [capacity_] buffer 1
+};
+
+using InferenceWorkspace = InferenceWorkspaceT<double>;
+using InferenceWorkspaceF = InferenceWorkspaceT<float>;
+
+#endif // INFERENCE_WORKSPACE_H
@@ -0,0 +1,222 @@
+// instrumentation.cpp
+#include "instrumentation.h"
+#include <sstream>
+
+namespace instrumentation {
+
+    namespace {
+        struct StageCounters {
+            std::atomic<std::uint64_t> totalNs{0}; // calls = latency.getCount()
+            std::atomic<std::uint64_t> maxNs{0};
+            std::atomic<std::uint64_t> allocations{0};
+            std::atomic<std::uint64_t> allocatedBytes{0};
+            LatencyHistogram latency;
+        };
+
+        struct LayerCounters {
+            std::atomic<std::uint64_t> calls{0};
+            std::atomic<std::uint64_t> totalNs{0};
+        };
+
+        std::atomic<bool> g_enabled{true};
+        StageCounters g_stages[static_cast<std::size_t>(Stage::Count)];
+        LayerCounters g_layers[kMaxLayers];
+        std::atomic<std::uint64_t> g_allocations{0};
+        std::atomic<std::uint64_t> g_allocatedBytes{0};
+
+        thread_local ThreadCounters t_counters = {0, 0};
+        thread_local std::size_t t_forwardPasses = 0;
+
+        void updateMax(std::atomic<std::uint64_t>& target, std::uint64_t value) {
+            std::uint64_t current = target.load(std::memory_order_relaxed);
+            while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        std::size_t floorLog2(std::uint64_t v) {
+            std::size_t e = 0;
+            for (std::size_t shift = 32; shift > 0; shift /= 2) {
+                if (v >> shift) {
+                    v >>= shift;
+                    e += shift;
+                }
+            }
+            return e;
+        }
+    }
+
+    const char* stageName(Stage stage) {
+        switch (stage) {
+            case Stage::ProcessData: return "process_data";
+            case Stage::Normalization: return "normalization";
+            case Stage::InputBuild: return "input_build";
+            case Stage::Forward: return "forward";
+            case Stage::Training: return "training";
+            case Stage::OnBar: return "on_bar";
+            default: return "unknown";
+        }
+    }
+
+    std::size_t LatencyHistogram::bucketIndex(std::uint64_t ns) {
+        if (ns < kSubBuckets) {
+            return static_cast<std::size_t>(ns);
+        }
+        const std::size_t e = floorLog2(ns); // >= 3
+        const std::size_t sub = static_cast<std::size_t>(ns >> (e - 3)) & (kSubBuckets - 1);
+        return (e - 2) * kSubBuckets + sub;
+    }
+
+    std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        const std::size_t e = index / kSubBuckets + 2;
+        const std::uint64_t sub = index % kSubBuckets;
+        return ((kSubBuckets + sub + 1) << (e - 3)) - 1;
+    }
+
+    void LatencyHistogram::record(std::uint64_t ns) {
+        buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t LatencyHistogram::getCount() const {
+        std::uint64_t count = 0;
+        for (const auto& bucket : buckets_) {
+            count += bucket.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    std::uint64_t LatencyHistogram::percentile(double q) const {
+        std::uint64_t counts[kBuckets];
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) {
+            return 0;
+        }
+        // Smallest bucket holding at least ceil(q * total) samples.
+        const double clamped = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+        std::uint64_t rank = static_cast<std::uint64_t>(clamped * static_cast<double>(total));
+        if (static_cast<double>(rank) < clamped * static_cast<double>(total) || rank == 0) {
+            ++rank;
+        }
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return bucketUpperBound(i);
+            }
+        }
+        return bucketUpperBound(kBuckets - 1);
+    }
+
+    void LatencyHistogram::reset() {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void setEnabled(bool enabled) {
+        g_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    ThreadCounters& threadCounters() {
+        return t_counters;
+    }
+
+    void countAllocation(std::size_t bytes) {
+        ++t_counters.allocations;
+        t_counters.allocatedBytes += bytes;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void recordStage(Stage stage, std::uint64_t ns, std::uint64_t allocations, std::uint64_t allocatedBytes) {
+        StageCounters& counters = g_stages[static_cast<std::size_t>(stage)];
+        counters.latency.record(ns);
+        counters.totalNs.fetch_add(ns, std::memory_order_relaxed);
+        updateMax(counters.maxNs, ns);
+        if (allocations != 0) {
+            counters.allocations.fetch_add(allocations, std::memory_order_relaxed);
+            counters.allocatedBytes.fetch_add(allocatedBytes, std::memory_order_relaxed);
+        }
+    }
+
+    void recordLayer(std::size_t layer, std::uint64_t ns) {
+        LayerCounters& counters = g_layers[layer < kMaxLayers ? layer : kMaxLayers - 1];
+        counters.calls.fetch_add(1, std::memory_order_relaxed);
+        counters.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    bool sampleLayers() {
+        return (t_forwardPasses++ & (kLayerSampleInterval - 1)) == 0;
+    }
+
+    void reset() {
+        for (auto& counters : g_stages) {
+            counters.totalNs.store(0, std::memory_order_relaxed);
+            counters.maxNs.store(0, std::memory_order_relaxed);
+            counters.allocations.store(0, std::memory_order_relaxed);
+            counters.allocatedBytes.store(0, std::memory_order_relaxed);
+            counters.latency.reset();
+        }
+        for (auto& counters : g_layers) {
+            counters.calls.store(0, std::memory_order_relaxed);
+            counters.totalNs.store(0, std::memory_order_relaxed);
+        }
+        g_allocations.store(0, std::memory_order_relaxed);
+        g_allocatedBytes.store(0, std::memory_order_relaxed);
+    }
+
+    std::string toJson() {
+        // Counters keep moving while they are read; each value is consistent on its own.
+        std::ostringstream json;
+#ifdef NN_DISABLE_INSTRUMENTATION
+        json << "{\"compiled\": false";
+#else
+        json << "{\"compiled\": true";
+#endif
+        json << ", \"enabled\": " << (isEnabled() ? "true" : "false") << ", \"stages\": {";
+        for (std::size_t s = 0; s < static_cast<std::size_t>(Stage::Count); ++s) {
+            const StageCounters& counters = g_stages[s];
+            const std::uint64_t calls = counters.latency.getCount();
+            const std::uint64_t totalNs = counters.totalNs.load(std::memory_order_relaxed);
+            json << (s == 0 ? "" : ", ") << "\"" << stageName(static_cast<Stage>(s)) << "\": {"
+                 << "\"calls\": " << calls
+                 << ", \"total_ns\": " << totalNs
+                 << ", \"mean_ns\": " << (calls ? totalNs / calls : 0)
+                 << ", \"max_ns\": " << counters.maxNs.load(std::memory_order_relaxed)
+                 << ", \"p50_ns\": " << counters.latency.percentile(0.5)
+                 << ", \"p99_ns\": " << counters.latency.percentile(0.99)
+                 << ", \"p999_ns\": " << counters.latency.percentile(0.999)
+                 << ", \"allocations\": " << counters.allocations.load(std::memory_order_relaxed)
+                 << ", \"allocated_bytes\": " << counters.allocatedBytes.load(std::memory_order_relaxed) << "}";
+        }
+        json << "}, \"layers\": [";
+        std::size_t numLayers = 0;
+        for (std::size_t i = 0; i < kMaxLayers; ++i) {
+            if (g_layers[i].calls.load(std::memory_order_relaxed) != 0) {
+                numLayers = i + 1;
+            }
+        }
+        for (std::size_t i = 0; i < numLayers; ++i) {
+            const std::uint64_t calls = g_layers[i].calls.load(std::memory_order_relaxed);
+            const std::uint64_t totalNs = g_layers[i].totalNs.load(std::memory_order_relaxed);
+            json << (i == 0 ? "" : ", ") << "{\"layer\": " << i
+                 << ", \"calls\": " << calls
+                 << ", \"total_ns\": " << totalNs
+                 << ", \"mean_ns\": " << (calls ? totalNs / calls : 0) << "}";
+        }
+        json << "], \"allocations\": " << g_allocations.load(std::memory_order_relaxed)
+             << ", \"allocated_bytes\": " << g_allocatedBytes.load(std::memory_order_relaxed) << "}";
+        return json.str();
+    }
+
+}
@@ -0,0 +1,144 @@
+// instrumentation.h
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Process-wide timings, call counts and allocation counts for the hot paths, cheap enough to leave
+// on in production: a stage probe reads the clock and two thread-local counters on entry and exit
+// and adds to relaxed atomics. Stages nest (ProcessData contains the others), so their figures are
+// inclusive. Per-layer figures cover inference forward passes (float, double and int8); they take
+// one clock read per layer, so only one pass in kLayerSampleInterval per thread is timed.
+//
+// Define NN_DISABLE_INSTRUMENTATION to compile every probe and the allocation hook out; the query
+// functions remain and report zeros. setEnabled(false) skips the probes at run time instead.
+namespace instrumentation {
+
+    enum class Stage {
+        ProcessData,   // InterfaceFunction::processData, whole call
+        Normalization, // normalizing the training history
+        InputBuild,    // normalized input rows for inference
+        Forward,       // network forward passes for inference
+        Training,      // one training call on the normalized history
+        OnBar,         // InterfaceFunction::onBar, whole call
+        Count
+    };
+
+    // Layers past the last slot are added to it.
+    constexpr std::size_t kMaxLayers = 32;
+    constexpr std::size_t kLayerSampleInterval = 16; // power of two
+
+    const char* stageName(Stage stage);
+
+    // Latency distribution in nanoseconds over log-linear buckets: exact below 8 ns, then 8 buckets per
+    // power of two, so a percentile is reported within 12.5% (as its bucket's upper bound).
+    class LatencyHistogram {
+    public:
+        void record(std::uint64_t ns);
+        std::uint64_t getCount() const;
+        std::uint64_t percentile(double q) const; // q in [0, 1]; 0 when empty
+        void reset();
+
+    private:
+        static constexpr std::size_t kSubBuckets = 8;
+        static constexpr std::size_t kBuckets = 62 * kSubBuckets;
+
+        std::atomic<std::uint64_t> buckets_[kBuckets] = {};
+
+        static std::size_t bucketIndex(std::uint64_t ns);
+        static std::uint64_t bucketUpperBound(std::size_t index);
+    };
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Called for every allocation made by the module (see the operator new hook in main.cpp).
+    void countAllocation(std::size_t bytes);
+
+    void recordStage(Stage stage, std::uint64_t ns, std::uint64_t allocations, std::uint64_t allocatedBytes);
+    void recordLayer(std::size_t layer, std::uint64_t ns);
+    bool sampleLayers(); // true for every kLayerSampleInterval-th forward pass of the calling thread
+
+    void reset();
+
+    // Every counter as one JSON object: per stage calls, total/mean/max and p50/p99/p999 latency and
+    // allocations; per layer timed (sampled) calls and total/mean latency; allocations overall.
+    std::string toJson();
+
+    struct ThreadCounters {
+        std::uint64_t allocations;
+        std::uint64_t allocatedBytes;
+    };
+    ThreadCounters& threadCounters();
+
+    inline std::uint64_t nowNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    class ScopedStage {
+    public:
+        explicit ScopedStage(Stage stage) : stage_(stage), active_(isEnabled()) {
+            if (active_) {
+                const ThreadCounters& counters = threadCounters();
+                allocations_ = counters.allocations;
+                allocatedBytes_ = counters.allocatedBytes;
+                start_ = nowNs();
+            }
+        }
+
+        ~ScopedStage() {
+            if (active_) {
+                const std::uint64_t elapsed = nowNs() - start_;
+                const ThreadCounters& counters = threadCounters();
+                recordStage(stage_, elapsed, counters.allocations - allocations_, counters.allocatedBytes - allocatedBytes_);
+            }
+        }
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+    private:
+        Stage stage_;
+        bool active_;
+        std::uint64_t start_ = 0;
+        std::uint64_t allocations_ = 0;
+        std::uint64_t allocatedBytes_ = 0;
+    };
+
+    // Times consecutive layers of one forward pass: lap(i) closes layer i and opens the next.
+    class LayerTimer {
+    public:
+        LayerTimer() : last_(isEnabled() && sampleLayers() ? nowNs() : 0) {}
+
+        void lap(std::size_t layer) {
+            if (last_ != 0) {
+                const std::uint64_t now = nowNs();
+                recordLayer(layer, now - last_);
+                last_ = now;
+            }
+        }
+
+    private:
+        std::uint64_t last_;
+    };
+
+}
+
+// NN_PROFILE_STAGE times the rest of the scope it is placed in. NN_PROFILE_LAYERS starts a forward
+// pass in the current scope and NN_PROFILE_LAYER_DONE(i) marks the end of its layer i.
+#ifdef NN_DISABLE_INSTRUMENTATION
+    #define NN_PROFILE_STAGE(stage)
+    #define NN_PROFILE_LAYERS()
+    #define NN_PROFILE_LAYER_DONE(layer)
+#else
+    #define NN_PROFILE_STAGE(stage) instrumentation::ScopedStage nnStageProbe(stage)
+    #define NN_PROFILE_LAYERS() instrumentation::LayerTimer nnLayerTimer
+    #define NN_PROFILE_LAYER_DONE(layer) nnLayerTimer.lap(layer)
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -1,22 +1,43 @@
 // interface_function.cpp
 #include "interface_function.h"
+#include "instrumentation.h"
 #include <iostream>
+#include <limits>
 
 
 
-InterfaceFunction::InterfaceFunction(NeuralNetwork& neuralNetwork, DataNormalization::NormalizationType normalizationType) :
-    neuralNetwork_(neuralNetwork), dataNormalization_(normalizationType) {}
+template <typename T>
+InterfaceFunctionT<T>::InterfaceFunctionT(NeuralNetworkT<T>& neuralNetwork, DataNormalization::NormalizationType normalizationType) :
+    neuralNetwork_(&neuralNetwork), trainableNetwork_(&neuralNetwork), dataNormalization_(normalizationType) {}
 
-std::vector<double> InterfaceFunction::processData(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators) {
+template <typename T>
+InterfaceFunctionT<T>::InterfaceFunctionT(const NeuralNetworkT<T>& neuralNetwork, DataNormalization::NormalizationType normalizationType) :
+    neuralNetwork_(&neuralNetwork), trainableNetwork_(nullptr), dataNormalization_(normalizationType) {}
+
+template <typename T>
+std::vector<double> InterfaceFunctionT<T>::processData(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators) {
+    NN_PROFILE_STAGE(instrumentation::Stage::ProcessData);
 
     DataStorage dataStorage;
+    dataStorage.reserve(barData.size());
     for (const auto& bar : barData) {
         dataStorage.addBarData(bar);
     }
     
     if(useIndicators) {
-       for(const auto& pair : indicatorData) {
-         dataStorage.addIndicatorData(pair.first, pair.second);
+       if (indicatorSchema_.empty()) {
+           for(const auto& pair : indicatorData) {
+             dataStorage.addIndicatorData(pair.first, pair.second);
+           }
+       } else {
+           // Storage IDs follow the schema, so training windows see the columns inference uses.
+           for (size_t id = 0; id < indicatorSchema_.size(); ++id) {
+               auto it = indicatorData.find(indicatorSchema_.getName(id));
+               if (it == indicatorData.end()) {
+                   throw std::runtime_error("Indicator data is missing: " + indicatorSchema_.getName(id));
+               }
+               dataStorage.addIndicatorData(it->first, it->second);
+           }
        }
     }
 
@@ -24,87 +45,274 @@ std::vector<double> InterfaceFunction::processData(const std::vector<BarData>& b
 
     if (isTraining_) {
 
-        dataNormalization_.normalizeBarData(dataStorage);
-        trainNetwork(dataStorage);
+        {
+            NN_PROFILE_STAGE(instrumentation::Stage::Normalization);
+            dataNormalization_.normalizeBarData(dataStorage);
+        }
+        {
+            NN_PROFILE_STAGE(instrumentation::Stage::Training);
+            trainNetwork(dataStorage);
+        }
 
         return {};
 
     } else {
 
-        std::vector<double> result;
-        for(size_t i = 0; i < dataStorage.getBarDataSize(); ++i) {
-            DataStorage singleBarStorage;
-             singleBarStorage.addBarData(dataStorage.getBarData(i));
+        const size_t numBars = barData.size();
+        std::vector<T> inputs;
+        {
+            NN_PROFILE_STAGE(instrumentation::Stage::InputBuild);
+            // A plan without a quantized network takes the raw values and normalizes them itself.
+            inputs = buildInputMatrix(barData, indicatorData, useIndicators, quantizedNetwork_ || !inferencePlan_);
+        }
+        const size_t numOutputs = neuralNetwork_->getNumOutputs();
+
+        if (useWindows_ && windowConfig_.lookback > 1) {
+            // Windows are scored in place over the feature rows; the first bars have no full window.
+            const size_t lookback = windowConfig_.lookback;
+            const size_t numFeatures = neuralNetwork_->getNumInputs() / lookback;
+            const size_t numWindows = numBars >= lookback ? numBars - lookback + 1 : 0;
+            std::vector<T> outputs(numWindows * numOutputs);
+            {
+                NN_PROFILE_STAGE(instrumentation::Stage::Forward);
+                if (quantizedNetwork_) {
+                    for (size_t i = 0; i < numWindows; ++i) {
+                        quantizedNetwork_->predictInto(inputs.data() + i * numFeatures, outputs.data() + i * numOutputs);
+                    }
+                } else if (numWindows > 0 && inferencePlan_) {
+                    outputs = inferencePlan_->predictBatch(inputs.data(), numWindows, numFeatures);
+                } else if (numWindows > 0) {
+                    outputs = neuralNetwork_->predictBatch(inputs.data(), numWindows, numFeatures);
+                }
+            }
+            std::vector<double> result(numBars, std::numeric_limits<double>::quiet_NaN());
+            for (size_t i = 0; i < numWindows; ++i) {
+                result[i + lookback - 1] = outputs[i * numOutputs];
+            }
+            return result;
+        }
 
-             if(useIndicators) {
-               for(const auto& pair : indicatorData) {
-                   std::vector<double> indicatorValuesForBar;
+        // Score all bars in one batched pass; only the first output is reported per bar.
+        std::vector<T> outputs;
+        {
+            NN_PROFILE_STAGE(instrumentation::Stage::Forward);
+            if (quantizedNetwork_) {
+                outputs = quantizedNetwork_->predictBatch(inputs, numBars);
+            } else if (inferencePlan_) {
+                outputs = inferencePlan_->predictBatch(inputs.data(), numBars, inferencePlan_->getNumInputs());
+            } else {
+                outputs = neuralNetwork_->predictBatch(inputs, numBars);
+            }
+        }
+        std::vector<double> result(numBars);
+        for(size_t i = 0; i < numBars; ++i) {
+            result[i] = outputs[i * numOutputs];
+        }
+        return result;
 
-                    if (i < pair.second.size()) {
-                        indicatorValuesForBar.push_back(pair.second[i]);
-                    } else {
 
-                         indicatorValuesForBar.push_back(0.0); 
-                    }
 
-                     singleBarStorage.addIndicatorData(pair.first, indicatorValuesForBar);
+    }
+}
 
-                 }
+template <typename T>
+void InterfaceFunctionT<T>::setTrainingMode(bool isTraining) {
+    if (isTraining && !trainableNetwork_) {
+        throw std::runtime_error("This interface is inference only; training needs a mutable network.");
+    }
+    isTraining_ = isTraining;
+    if (trainableNetwork_) {
+        trainableNetwork_->setTrainingMode(isTraining);
+    }
+}
 
-             }
+template <typename T>
+void InterfaceFunctionT<T>::setNeuralNetwork(const NeuralNetworkT<T>& neuralNetwork) {
+    neuralNetwork_ = &neuralNetwork;
+    trainableNetwork_ = nullptr;
+    isTraining_ = false;
+}
 
+template <typename T>
+DataNormalization& InterfaceFunctionT<T>::getDataNormalization() {
+    return dataNormalization_;
+}
 
-        dataNormalization_.normalizeBarData(singleBarStorage);
-        std::vector<double> inputVector = createInputVector(singleBarStorage.getBarData(0), singleBarStorage.getAllIndicatorData(), useIndicators);
+template <typename T>
+std::vector<T> InterfaceFunctionT<T>::createInputMatrix(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators) {
+    return buildInputMatrix(barData, indicatorData, useIndicators, true);
+}
 
-        if (inputVector.size() != neuralNetwork_.getNumInputs()) {
-                throw std::runtime_error("Input vector size mismatch.");
+template <typename T>
+std::vector<T> InterfaceFunctionT<T>::buildInputMatrix(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData,
+                                                       bool useIndicators, bool normalize) {
+    // Resolve the indicator columns once per call; the per-bar loop only follows pointers.
+    std::vector<const std::vector<double>*> columns;
+    if (useIndicators) {
+        if (indicatorSchema_.empty()) {
+            for (const auto& pair : indicatorData) {
+                columns.push_back(&pair.second);
+            }
+        } else {
+            columns.resize(indicatorSchema_.size());
+            for (size_t id = 0; id < indicatorSchema_.size(); ++id) {
+                auto it = indicatorData.find(indicatorSchema_.getName(id));
+                if (it == indicatorData.end()) {
+                    throw std::runtime_error("Indicator data is missing: " + indicatorSchema_.getName(id));
+                }
+                columns[id] = &it->second;
             }
-             result.push_back(neuralNetwork_.predict(inputVector)[0]);
-
         }
-        return result;
-
+    }
 
+    const size_t numBars = barData.size();
+    const size_t lookback = useWindows_ ? windowConfig_.lookback : 1;
+    const size_t numInputs = 4 + columns.size(); // per bar
+    if (numInputs * lookback != neuralNetwork_->getNumInputs()) {
+        throw std::runtime_error("Input vector size mismatch.");
+    }
 
+    // Row-major numBars x numInputs: each bar normalized on its own (unless !normalize), then its
+    // indicator values; a bar past the end of an indicator series gets 0. With online statistics
+    // each bar first updates them, as onBar does.
+    const bool online = dataNormalization_.hasOnlineStats();
+    std::vector<double> indicatorValues(online ? columns.size() : 0);
+    std::vector<T> inputs(numBars * numInputs);
+    for(size_t i = 0; i < numBars; ++i) {
+        T* row = inputs.data() + i * numInputs;
+        if (online) {
+            for (size_t k = 0; k < columns.size(); ++k) {
+                indicatorValues[k] = i < columns[k]->size() ? (*columns[k])[i] : 0.0;
+            }
+            dataNormalization_.updateStats(barData[i], indicatorValues.data(), indicatorValues.size());
+        }
+        const BarData normalizedBar = normalize ? dataNormalization_.normalizeBar(barData[i]) : barData[i];
+        row[0] = static_cast<T>(normalizedBar.open);
+        row[1] = static_cast<T>(normalizedBar.close);
+        row[2] = static_cast<T>(normalizedBar.high);
+        row[3] = static_cast<T>(normalizedBar.low);
+        for (size_t k = 0; k < columns.size(); ++k) {
+            const std::vector<double>& column = *columns[k];
+            const double value = i < column.size() ? column[i] : 0.0;
+            row[4 + k] = static_cast<T>(normalize && i < column.size() ? dataNormalization_.normalizeIndicator(k, value) : value);
+        }
     }
+    return inputs;
 }
 
-void InterfaceFunction::setTrainingMode(bool isTraining) {
-    isTraining_ = isTraining;
-    neuralNetwork_.setTrainingMode(isTraining);
+template <typename T>
+void InterfaceFunctionT<T>::setIndicatorSchema(const IndicatorSchema& schema) {
+    indicatorSchema_ = schema;
 }
 
-DataNormalization& InterfaceFunction::getDataNormalization() {
-    return dataNormalization_;
+template <typename T>
+const IndicatorSchema& InterfaceFunctionT<T>::getIndicatorSchema() const {
+    return indicatorSchema_;
 }
 
+template <typename T>
+void InterfaceFunctionT<T>::setWindowConfig(const WindowConfig& config) {
+    config.validate();
+    windowConfig_ = config;
+    useWindows_ = true;
+    streamWindow_.clear();
+}
 
+template <typename T>
+void InterfaceFunctionT<T>::clearWindowConfig() {
+    windowConfig_ = WindowConfig();
+    useWindows_ = false;
+    streamWindow_.clear();
+}
 
-std::vector<double> InterfaceFunction::createInputVector(const BarData& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators) const{
-    std::vector<double> inputVector = {barData.open, barData.close, barData.high, barData.low};
+template <typename T>
+double InterfaceFunctionT<T>::onBar(const BarData& bar, const double* indicators) {
+    NN_PROFILE_STAGE(instrumentation::Stage::OnBar);
+    const size_t lookback = useWindows_ ? windowConfig_.lookback : 1;
+    const size_t numInputs = neuralNetwork_->getNumInputs() / lookback; // per bar
+    if (numInputs < 4 || numInputs * lookback != neuralNetwork_->getNumInputs()) {
+        throw std::runtime_error("Input size of neural network must be at least 4 (OHLC) per bar.");
+    }
+    const size_t numIndicators = numInputs - 4;
+    if (numIndicators > 0 && indicators == nullptr) {
+        throw std::invalid_argument("Indicator values are missing.");
+    }
 
-    if(useIndicators){
-        for(const auto& pair: indicatorData){
+    // Sized on the first call and again only if the topology changes.
+    if (streamInput_.size() != numInputs) {
+        streamInput_.resize(numInputs);
+    }
+    if (streamOutput_.size() != neuralNetwork_->getNumOutputs()) {
+        streamOutput_.resize(neuralNetwork_->getNumOutputs());
+    }
 
-           if (pair.second.size() > 0) {
-            inputVector.push_back(pair.second[0]);
-            } else {
+    dataNormalization_.updateStats(bar, indicators, numIndicators); // no-op without online statistics
+    const bool normalize = quantizedNetwork_ || !inferencePlan_; // a plan normalizes the raw values itself
+    const BarData normalizedBar = normalize ? dataNormalization_.normalizeBar(bar) : bar;
+    streamInput_[0] = static_cast<T>(normalizedBar.open);
+    streamInput_[1] = static_cast<T>(normalizedBar.close);
+    streamInput_[2] = static_cast<T>(normalizedBar.high);
+    streamInput_[3] = static_cast<T>(normalizedBar.low);
+    for (size_t i = 0; i < numIndicators; ++i) {
+        streamInput_[4 + i] = static_cast<T>(normalize ? dataNormalization_.normalizeIndicator(i, indicators[i]) : indicators[i]);
+    }
 
-                throw std::runtime_error("Indicator data is missing");
-                }
+    const T* input = streamInput_.data();
+    if (lookback > 1) {
+        if (streamWindow_.getLookback() != lookback || streamWindow_.getNumFeatures() != numInputs) {
+            streamWindow_ = LaggedWindowBufferT<T>(lookback, numInputs);
+        }
+        streamWindow_.push(streamInput_.data());
+        if (!streamWindow_.isReady()) {
+            return std::numeric_limits<double>::quiet_NaN();
         }
+        input = streamWindow_.window();
     }
 
-    return inputVector;
+    if (quantizedNetwork_) {
+        quantizedNetwork_->predictInto(input, streamOutput_.data());
+    } else if (inferencePlan_) {
+        inferencePlan_->predictInto(input, streamOutput_.data(), streamWorkspace_);
+    } else {
+        neuralNetwork_->predictInto(input, streamOutput_.data(), streamWorkspace_);
+    }
+    return static_cast<double>(streamOutput_[0]);
+}
+
+template <typename T>
+void InterfaceFunctionT<T>::setQuantizedNetwork(const QuantizedNetwork* quantizedNetwork) {
+    if (inferencePlan_ && (quantizedNetwork == nullptr) != (quantizedNetwork_ == nullptr)) {
+        streamWindow_.clear(); // switches between raw and normalized rows
+    }
+    quantizedNetwork_ = quantizedNetwork;
+}
+
+template <typename T>
+void InterfaceFunctionT<T>::setInferencePlan(const InferencePlanT<T>* inferencePlan) {
+    if (inferencePlan != inferencePlan_ && !quantizedNetwork_) {
+        streamWindow_.clear(); // the window holds raw rows for a plan and normalized rows otherwise
+    }
+    inferencePlan_ = inferencePlan;
 }
 
-void InterfaceFunction::trainNetwork(const DataStorage& dataStorage) {
+template <typename T>
+void InterfaceFunctionT<T>::setLearningRate(double learningRate) {
+    learningRate_ = learningRate;
+}
+
+
+
+template <typename T>
+void InterfaceFunctionT<T>::trainNetwork(const DataStorage& dataStorage) {
     try{
-         if (neuralNetwork_.getNumInputs() != 4 && !dataStorage.getAllIndicatorData().empty()) {
+         if (useWindows_) {
+             trainableNetwork_->train(LaggedDatasetT<T>(dataStorage, windowConfig_), 1, learningRate_);
+             return;
+         }
+         if (neuralNetwork_->getNumInputs() != 4 && dataStorage.getIndicatorCount() != 0) {
             throw std::runtime_error("Input size of neural network and input vector must match.");
          }
-    neuralNetwork_.train(dataStorage, 1, 0.1);
+    trainableNetwork_->train(dataStorage, 1, learningRate_);
 
 
     }
@@ -112,4 +320,7 @@ void InterfaceFunction::trainNetwork(const DataStorage& dataStorage) {
         std::cerr << "Error training network: " << e.what() << std::endl;
        
     }
-}
\ No newline at end of file
+}
+
+template class InterfaceFunctionT<float>;
+template class InterfaceFunctionT<double>;
@@ -6,25 +6,88 @@
 #include "data_storage.h"
 #include "neural_network.h"
 #include "data_normalization.h"
+#include "quantized_network.h"
+#include "inference_plan.h"
+#include "indicator_schema.h"
+#include "lagged_window.h"
 #include <stdexcept>
 
-class InterfaceFunction {
+// Bridges host bar data (double) and a network of precision T.
+template <typename T>
+class InterfaceFunctionT {
 public:
-    InterfaceFunction(NeuralNetwork& neuralNetwork, DataNormalization::NormalizationType normalizationType = DataNormalization::NormalizationType::MinMax);
+    InterfaceFunctionT(NeuralNetworkT<T>& neuralNetwork, DataNormalization::NormalizationType normalizationType = DataNormalization::NormalizationType::MinMax);
+    // Inference only: training mode throws std::runtime_error.
+    explicit InterfaceFunctionT(const NeuralNetworkT<T>& neuralNetwork, DataNormalization::NormalizationType normalizationType = DataNormalization::NormalizationType::MinMax);
 
     std::vector<double> processData(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData = {}, bool useIndicators = true);
 
     void setTrainingMode(bool isTraining);
+    // Continues inference on another network, e.g. a newer version of the same model, keeping the
+    // normalization statistics and the onBar window. The interface becomes inference only.
+    void setNeuralNetwork(const NeuralNetworkT<T>& neuralNetwork);
     DataNormalization& getDataNormalization();
 
+    // Normalized network inputs for barData, one row per bar, exactly as processData feeds them to the network.
+    // With a window config the rows hold one bar's features (getNumInputs() / lookback values) and
+    // window i spans rows i .. i + lookback - 1.
+    std::vector<T> createInputMatrix(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators);
+
+    // Fixes the indicator columns fed to the network: column 4 + id holds the indicator with that ID.
+    // Without a schema the columns follow the ascending order of the indicator names passed in.
+    void setIndicatorSchema(const IndicatorSchema& schema);
+    const IndicatorSchema& getIndicatorSchema() const;
+
+    // Feeds the network lagged windows instead of single bars: training builds a LaggedDatasetT from
+    // the normalized history and fits the configured horizon targets; inference scores the window
+    // ending at each bar (NaN for the first lookback - 1 bars, and from onBar until it has seen them).
+    // Without a window config each bar is scored on its own and training uses the legacy OHLC -> close samples.
+    void setWindowConfig(const WindowConfig& config);
+    void clearWindowConfig();
+
+    // Streaming inference for the bar that just closed: updates the online normalization statistics if
+    // enabled, normalizes the bar, appends the indicator values and
+    // returns the network's first output. indicators holds getNumInputs() - 4 values in the column order
+    // processData uses (see setIndicatorSchema) and may be nullptr for an OHLC-only network.
+    // Scratch buffers persist between calls, so after the first call no memory is allocated.
+    double onBar(const BarData& bar, const double* indicators = nullptr);
+
+    // When set, inference runs on this int8 copy of the network instead (nullptr switches back).
+    // The quantized network must outlive its use here and be rebuilt after the network changes.
+    void setQuantizedNetwork(const QuantizedNetwork* quantizedNetwork);
+
+    // When set (and no quantized network is), inference feeds the raw inputs to this compiled plan,
+    // which normalizes them itself (nullptr switches back). Same lifetime rules as above; the plan must
+    // be compiled from this network, its normalization and the window config in use.
+    void setInferencePlan(const InferencePlanT<T>* inferencePlan);
+
+    // Learning rate of the training pass in processData (default 0.1).
+    void setLearningRate(double learningRate);
+
 private:
-    NeuralNetwork& neuralNetwork_;
+    const NeuralNetworkT<T>* neuralNetwork_;
+    NeuralNetworkT<T>* trainableNetwork_; // neuralNetwork_ if it may be trained, else nullptr
     DataNormalization dataNormalization_;
     bool isTraining_ = false; 
+    const QuantizedNetwork* quantizedNetwork_ = nullptr;
+    const InferencePlanT<T>* inferencePlan_ = nullptr;
+    IndicatorSchema indicatorSchema_;
+    WindowConfig windowConfig_;
+    bool useWindows_ = false;
+    double learningRate_ = 0.1;
 
-    std::vector<double> createInputVector(const BarData& barData, const std::map<std::string, std::vector<double>>& indicatorData, bool useIndicators) const;
+    // onBar state
+    std::vector<T> streamInput_;
+    std::vector<T> streamOutput_;
+    InferenceWorkspaceT<T> streamWorkspace_;
+    LaggedWindowBufferT<T> streamWindow_;
 
     void trainNetwork(const DataStorage& dataStorage);
+    std::vector<T> buildInputMatrix(const std::vector<BarData>& barData, const std::map<std::string, std::vector<double>>& indicatorData,
+                                    bool useIndicators, bool normalize);
 };
 
+using InterfaceFunction = InterfaceFunctionT<double>;
+using InterfaceFunctionF = InterfaceFunctionT<float>;
+
 #endif // INTERFACE_FUNCTION_H
\ No newline at end of file
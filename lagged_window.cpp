@@ -0,0 +1,174 @@
+// lagged_window.cpp
+#include "lagged_window.h"
+#include <algorithm>
+
+size_t WindowConfig::getMaxHorizon() const {
+    return horizons.empty() ? 0 : *std::max_element(horizons.begin(), horizons.end());
+}
+
+void WindowConfig::validate() const {
+    if (lookback == 0) {
+        throw std::invalid_argument("Lookback must be at least one bar.");
+    }
+    if (horizons.empty()) {
+        throw std::invalid_argument("At least one target horizon is required.");
+    }
+}
+
+template <typename T>
+LaggedDatasetT<T>::LaggedDatasetT(const DataStorage& dataStorage, const WindowConfig& config) :
+    config_(config), numFeatures_(4 + dataStorage.getIndicatorCount()), numSamples_(0)
+{
+    config_.validate();
+    const size_t numBars = dataStorage.getBarDataSize();
+    const size_t span = config_.lookback + config_.getMaxHorizon();
+    numSamples_ = numBars >= span ? numBars - span + 1 : 0;
+
+    // Columns to rows, once: the only copy of the history the windows need.
+    std::vector<Span<const double>> columns = {dataStorage.getOpen(), dataStorage.getClose(),
+                                               dataStorage.getHigh(), dataStorage.getLow()};
+    for (size_t id = 0; id < dataStorage.getIndicatorCount(); ++id) {
+        columns.push_back(dataStorage.getIndicatorView(id));
+        if (columns.back().size() != numBars) {
+            throw std::invalid_argument("Indicator series must have one value per bar: " +
+                                        dataStorage.getIndicatorSchema().getName(id));
+        }
+    }
+    features_.resize(numBars * numFeatures_);
+    for (size_t f = 0; f < numFeatures_; ++f) {
+        const double* column = columns[f].data();
+        for (size_t i = 0; i < numBars; ++i) {
+            features_[i * numFeatures_ + f] = static_cast<T>(column[i]);
+        }
+    }
+
+    const Span<const double> close = dataStorage.getClose();
+    const size_t numTargets = config_.horizons.size();
+    targets_.resize(numSamples_ * numTargets);
+    for (size_t i = 0; i < numSamples_; ++i) {
+        const size_t last = i + config_.lookback - 1;
+        for (size_t k = 0; k < numTargets; ++k) {
+            const double future = close[last + config_.horizons[k]];
+            const double target = config_.targetType == WindowConfig::TargetType::Change ? future - close[last] : future;
+            targets_[i * numTargets + k] = static_cast<T>(target);
+        }
+    }
+}
+
+template <typename T>
+size_t LaggedDatasetT<T>::size() const {
+    return numSamples_;
+}
+
+template <typename T>
+size_t LaggedDatasetT<T>::getNumFeatures() const {
+    return numFeatures_;
+}
+
+template <typename T>
+size_t LaggedDatasetT<T>::getNumInputs() const {
+    return config_.lookback * numFeatures_;
+}
+
+template <typename T>
+size_t LaggedDatasetT<T>::getNumTargets() const {
+    return config_.horizons.size();
+}
+
+template <typename T>
+size_t LaggedDatasetT<T>::getInputStride() const {
+    return numFeatures_;
+}
+
+template <typename T>
+const T* LaggedDatasetT<T>::getInputs() const {
+    return features_.data();
+}
+
+template <typename T>
+const T* LaggedDatasetT<T>::getWindow(size_t i) const {
+    if (i >= numSamples_) {
+        throw std::out_of_range("Window index out of range in getWindow");
+    }
+    return features_.data() + i * numFeatures_;
+}
+
+template <typename T>
+const T* LaggedDatasetT<T>::getTargets() const {
+    return targets_.data();
+}
+
+template <typename T>
+const T* LaggedDatasetT<T>::getTarget(size_t i) const {
+    if (i >= numSamples_) {
+        throw std::out_of_range("Window index out of range in getTarget");
+    }
+    return targets_.data() + i * config_.horizons.size();
+}
+
+template <typename T>
+std::vector<T> LaggedDatasetT<T>::gatherInputs(size_t first, size_t count) const {
+    if (first > numSamples_ || count > numSamples_ - first) {
+        throw std::out_of_range("Window range out of range in gatherInputs");
+    }
+    const size_t numInputs = getNumInputs();
+    std::vector<T> inputs(count * numInputs);
+    for (size_t i = 0; i < count; ++i) {
+        const T* window = features_.data() + (first + i) * numFeatures_;
+        std::copy(window, window + numInputs, inputs.begin() + i * numInputs);
+    }
+    return inputs;
+}
+
+template <typename T>
+const WindowConfig& LaggedDatasetT<T>::getConfig() const {
+    return config_;
+}
+
+template <typename T>
+LaggedWindowBufferT<T>::LaggedWindowBufferT(size_t lookback, size_t numFeatures) :
+    lookback_(lookback), numFeatures_(numFeatures), rows_(2 * lookback * numFeatures)
+{
+    if (lookback_ == 0) {
+        throw std::invalid_argument("Lookback must be at least one bar.");
+    }
+}
+
+template <typename T>
+void LaggedWindowBufferT<T>::push(const T* features) {
+    std::copy(features, features + numFeatures_, rows_.begin() + next_ * numFeatures_);
+    std::copy(features, features + numFeatures_, rows_.begin() + (next_ + lookback_) * numFeatures_);
+    next_ = next_ + 1 == lookback_ ? 0 : next_ + 1;
+    count_ = std::min(count_ + 1, lookback_);
+}
+
+template <typename T>
+bool LaggedWindowBufferT<T>::isReady() const {
+    return count_ == lookback_;
+}
+
+template <typename T>
+const T* LaggedWindowBufferT<T>::window() const {
+    return rows_.data() + next_ * numFeatures_;
+}
+
+template <typename T>
+void LaggedWindowBufferT<T>::clear() {
+    next_ = 0;
+    count_ = 0;
+}
+
+template <typename T>
+size_t LaggedWindowBufferT<T>::getLookback() const {
+    return lookback_;
+}
+
+template <typename T>
+size_t LaggedWindowBufferT<T>::getNumFeatures() const {
+    return numFeatures_;
+}
+
+template class LaggedDatasetT<float>;
+template class LaggedDatasetT<double>;
+template class LaggedWindowBufferT<float>;
+template class LaggedWindowBufferT<double>;
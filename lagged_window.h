@@ -0,0 +1,90 @@
+// lagged_window.h
+#ifndef LAGGED_WINDOW_H
+#define LAGGED_WINDOW_H
+
+#include <vector>
+#include <stdexcept>
+#include "aligned_allocator.h"
+#include "data_storage.h"
+
+// Shape of the samples built from a bar history. The input of a sample is the window of the last
+// `lookback` bars, oldest first, each bar contributing its features: open, close, high, low, then
+// the indicators in ID order. Each horizon h adds one target, taken h bars after the window's last
+// bar: that bar's close (Close) or its change from the last bar's close (Change). Horizon 0 is the
+// last bar itself, as in NeuralNetworkT::train(const DataStorage&).
+struct WindowConfig {
+    enum class TargetType {
+        Close,
+        Change
+    };
+
+    size_t lookback = 1;
+    std::vector<size_t> horizons = {1};
+    TargetType targetType = TargetType::Close;
+
+    size_t getMaxHorizon() const;
+    void validate() const; // throws std::invalid_argument
+};
+
+// Lagged windows over a bar history without K copies of it. The bars' features are laid out once as
+// a row-major numBars x numFeatures matrix; window i is the lookback * numFeatures values starting
+// at row i, so consecutive windows overlap and lie getInputStride() = numFeatures values apart.
+// The batched kernels take that sample stride directly (see NeuralNetworkT::predictBatch and train).
+template <typename T>
+class LaggedDatasetT {
+public:
+    // Features are copied from dataStorage as it is (normalize it first); every indicator series
+    // must have one value per bar.
+    LaggedDatasetT(const DataStorage& dataStorage, const WindowConfig& config);
+
+    size_t size() const; // windows whose targets all lie inside the history
+    size_t getNumFeatures() const;
+    size_t getNumInputs() const; // lookback * numFeatures
+    size_t getNumTargets() const;
+    size_t getInputStride() const;
+
+    // Window i starts at getInputs() + i * getInputStride().
+    const T* getInputs() const;
+    const T* getWindow(size_t i) const;
+    // size() x getNumTargets(), row-major.
+    const T* getTargets() const;
+    const T* getTarget(size_t i) const;
+
+    // Dense copy of count windows from first, for consumers that need separate rows (e.g. calibration).
+    std::vector<T> gatherInputs(size_t first, size_t count) const;
+
+    const WindowConfig& getConfig() const;
+
+private:
+    WindowConfig config_;
+    size_t numFeatures_;
+    size_t numSamples_;
+    AlignedVector<T> features_;
+    std::vector<T> targets_;
+};
+
+// The last `lookback` feature rows of a live stream. Every row is stored twice, lookback rows apart,
+// so the current window is always one contiguous lookback * numFeatures block: push() writes two
+// rows and window() copies nothing.
+template <typename T>
+class LaggedWindowBufferT {
+public:
+    LaggedWindowBufferT(size_t lookback = 1, size_t numFeatures = 0);
+
+    void push(const T* features); // numFeatures values
+    bool isReady() const;         // lookback rows pushed since construction or clear()
+    const T* window() const;      // oldest row first; valid once isReady()
+    void clear();
+
+    size_t getLookback() const;
+    size_t getNumFeatures() const;
+
+private:
+    size_t lookback_;
+    size_t numFeatures_;
+    size_t next_ = 0;  // slot the next row goes to
+    size_t count_ = 0;
+    std::vector<T> rows_; // 2 * lookback rows
+};
+
+#endif // LAGGED_WINDOW_H
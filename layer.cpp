@@ -4,140 +4,192 @@
 #include <limits> 
 #include <stdexcept>
 #include <random>
+#include <algorithm>
 
-Layer::Layer(size_t numInputs, size_t numOutputs, ActivationType activationType) : 
-    numInputs_(numInputs), numOutputs_(numOutputs), activationType_(activationType), activationFunction_(relu)
+template <typename T>
+LayerT<T>::LayerT(size_t numInputs, size_t numOutputs, ActivationType activationType) : 
+    numInputs_(numInputs), numOutputs_(numOutputs), weightStride_(kernels::paddedStride<T>(numInputs)),
+    activationType_(activationType), kernelActivation_(kernels::Activation::ReLU)
 {
     if (numInputs == 0 || numOutputs == 0) {
         throw std::invalid_argument("Number of inputs and outputs must be greater than zero.");
     }
 
-    weights_.resize(numOutputs_, std::vector<double>(numInputs_));
-    biases_.resize(numOutputs_);
+    params_ = ParameterBuffer<T>(numOutputs_ * weightStride_ + numOutputs_);
 
     initializeWeights();
     setActivationFunction(activationType);
 }
 
-void Layer::setActivationFunction(ActivationType activationType) {
+template <typename T>
+LayerT<T>::LayerT(size_t numInputs, size_t numOutputs, ActivationType activationType, ParameterBuffer<T> params) :
+    numInputs_(numInputs), numOutputs_(numOutputs), weightStride_(kernels::paddedStride<T>(numInputs)),
+    params_(std::move(params)), activationType_(activationType), kernelActivation_(kernels::Activation::ReLU)
+{
+    if (numInputs == 0 || numOutputs == 0) {
+        throw std::invalid_argument("Number of inputs and outputs must be greater than zero.");
+    }
+    if (params_.size() != numOutputs_ * weightStride_ + numOutputs_) {
+        throw std::invalid_argument("Parameter buffer size does not match the layer shape.");
+    }
+
+    setActivationFunction(activationType);
+}
+
+template <typename T>
+void LayerT<T>::setActivationFunction(ActivationType activationType) {
     activationType_ = activationType; 
     switch (activationType) {
         case ActivationType::ReLU:
-            activationFunction_ = relu;
+            kernelActivation_ = kernels::Activation::ReLU;
             break;
         case ActivationType::Sigmoid:
-            activationFunction_ = sigmoid;
+            kernelActivation_ = kernels::Activation::Sigmoid;
             break;
         case ActivationType::Tanh:
-            activationFunction_ = tanh;
+            kernelActivation_ = kernels::Activation::Tanh;
             break;
         case ActivationType::Linear:
-            activationFunction_ = linear;
-            break;
         case ActivationType::None:
-            activationFunction_ = nullptr; 
+            kernelActivation_ = kernels::Activation::Identity;
             break;
     }
 }
 
-std::vector<double> Layer::forward(const std::vector<double>& input) const {  // const  
+template <typename T>
+std::vector<T> LayerT<T>::forward(const std::vector<T>& input) const {  // const  
     if (input.size() != numInputs_) {
         throw std::invalid_argument("Input size mismatch in Layer::forward()");
     }
 
-    outputCalculated_ = true;
+    std::vector<T> output(numOutputs_);
+    forward(input.data(), output.data());
+    return output;
+}
+
+template <typename T>
+void LayerT<T>::forward(const T* input, T* output) const {
+    kernels::gemv(getWeightData(), weightStride_, getBiasData(), input,
+                  numOutputs_, numInputs_, output, kernelActivation_, activationMode_);
+}
 
-    std::vector<double> output(numOutputs_);
-    for (size_t i = 0; i < numOutputs_; ++i) {
-        output[i] = 0.0;
-        for (size_t j = 0; j < numInputs_; ++j) {
-            output[i] += input[j] * weights_[i][j];
-        }
-        output[i] += biases_[i];
-        if (activationFunction_) {
-            output[i] = activationFunction_(output[i]);
-        }
-    }
+template <typename T>
+void LayerT<T>::forwardBatch(const T* input, size_t numSamples, T* output) const {
+    forwardBatch(input, numSamples, numInputs_, output);
+}
 
-    output_ = output;
-    outputCalculated_ = true; // Always set to true after successful calculation
-    return output;
+template <typename T>
+void LayerT<T>::forwardBatch(const T* input, size_t numSamples, size_t inputStride, T* output) const {
+    kernels::gemm(input, numSamples, inputStride, getWeightData(), weightStride_, getBiasData(),
+                  numOutputs_, numInputs_, output, numOutputs_, kernelActivation_, activationMode_);
 }
 
-void Layer::setWeights(const std::vector<std::vector<double>>& weights) {
+template <typename T>
+void LayerT<T>::setWeights(const std::vector<std::vector<T>>& weights) {
     if (weights.size() != numOutputs_ || weights[0].size() != numInputs_) {
         throw std::invalid_argument("Weight matrix dimensions mismatch in Layer::setWeights()");
     }
-    weights_ = weights;
+    for (size_t i = 0; i < numOutputs_; ++i) {
+        if (weights[i].size() != numInputs_) {
+            throw std::invalid_argument("Weight matrix dimensions mismatch in Layer::setWeights()");
+        }
+        std::copy(weights[i].begin(), weights[i].end(), getWeightData() + i * weightStride_);
+    }
 }
 
-std::vector<std::vector<double>> Layer::getWeights() const {
-    return weights_;
+template <typename T>
+std::vector<std::vector<T>> LayerT<T>::getWeights() const {
+    std::vector<std::vector<T>> weights(numOutputs_);
+    for (size_t i = 0; i < numOutputs_; ++i) {
+        const T* row = getWeightData() + i * weightStride_;
+        weights[i].assign(row, row + numInputs_);
+    }
+    return weights;
 }
 
-void Layer::setBiases(const std::vector<double>& biases) {
+template <typename T>
+void LayerT<T>::setBiases(const std::vector<T>& biases) {
     if (biases.size() != numOutputs_) {
         throw std::invalid_argument("Bias vector size mismatch in Layer::setBiases()");
     }
-    biases_ = biases;
+    std::copy(biases.begin(), biases.end(), getBiasData());
+}
+
+template <typename T>
+std::vector<T> LayerT<T>::getBiases() const {
+    return std::vector<T>(getBiasData(), getBiasData() + numOutputs_);
 }
 
-std::vector<double> Layer::getBiases() const {
-    return biases_;
+template <typename T>
+T* LayerT<T>::getWeightData() {
+    return params_.data();
 }
 
-size_t Layer::getInputSize() const {
+template <typename T>
+const T* LayerT<T>::getWeightData() const {
+    return params_.data();
+}
+
+template <typename T>
+T* LayerT<T>::getBiasData() {
+    return params_.data() + numOutputs_ * weightStride_;
+}
+
+template <typename T>
+const T* LayerT<T>::getBiasData() const {
+    return params_.data() + numOutputs_ * weightStride_;
+}
+
+template <typename T>
+size_t LayerT<T>::getWeightStride() const {
+    return weightStride_;
+}
+
+template <typename T>
+size_t LayerT<T>::getInputSize() const {
     return numInputs_;
 }
 
-size_t Layer::getOutputSize() const {
+template <typename T>
+size_t LayerT<T>::getOutputSize() const {
     return numOutputs_;
 }
 
-Layer::ActivationType Layer::getActivationFunction() const {
+template <typename T>
+typename LayerT<T>::ActivationType LayerT<T>::getActivationFunction() const {
     return activationType_;
 }
 
-void Layer::setDeltas(const std::vector<std::vector<double>>& deltas) {
-    deltas_ = deltas;
+template <typename T>
+kernels::Activation LayerT<T>::getKernelActivation() const {
+    return kernelActivation_;
 }
 
-std::vector<std::vector<double>> Layer::getDeltas() const {
-    return deltas_;
+template <typename T>
+void LayerT<T>::setActivationMode(kernels::ActivationMode mode) {
+    activationMode_ = mode;
 }
 
-std::vector<double> Layer::getOutput() const {
-    if (!outputCalculated_) {
-        throw std::runtime_error("Output not calculated yet. Call forward() first.");
-    }
-    return output_;
+template <typename T>
+kernels::ActivationMode LayerT<T>::getActivationMode() const {
+    return activationMode_;
 }
 
-void Layer::initializeWeights() {
+template <typename T>
+void LayerT<T>::initializeWeights() {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::normal_distribution<double> distribution(0.0, 1.0 / std::sqrt(numInputs_));
 
+    T* weights = getWeightData();
+    T* biases = getBiasData();
     for (size_t i = 0; i < numOutputs_; ++i) {
         for (size_t j = 0; j < numInputs_; ++j) {
-            weights_[i][j] = distribution(gen);
+            weights[i * weightStride_ + j] = static_cast<T>(distribution(gen));
         }
-        biases_[i] = 0.0; 
+        biases[i] = T(0); 
     }
 }
 
-double Layer::relu(double x) {
-    return std::max(0.0, x);
-}
-
-double Layer::sigmoid(double x) {
-    return 1.0 / (1.0 + std::exp(-x));
-}
-
-double Layer::tanh(double x) {
-    return std::tanh(x);
-}
-
-double Layer::linear(double x) {
-    return x;
-}
\ No newline at end of file
+template class LayerT<float>;
+template class LayerT<double>;
@@ -3,60 +3,96 @@
 #define LAYER_H
 
 #include <vector>
-#include <functional>
 #include <random>
 #include <stdexcept>
+#include <algorithm>
+#include "parameter_buffer.h"
+#include "math_kernels.h"
+
+enum class ActivationType {
+    ReLU,
+    Sigmoid,
+    Tanh,
+    Linear,
+    None 
+};
 
-class Layer {
+// Dense layer with parameters of type T (float or double).
+// The forward methods are read-only on the layer, so one layer may be evaluated
+// from several threads at once as long as nobody modifies its parameters.
+template <typename T>
+class LayerT {
 public:
-    enum class ActivationType {
-        ReLU,
-        Sigmoid,
-        Tanh,
-        Linear,
-        None 
-    };
+    using Scalar = T;
+    using ActivationType = ::ActivationType;
 
-    Layer(size_t numInputs, size_t numOutputs, ActivationType activationType = ActivationType::ReLU);
+    LayerT(size_t numInputs, size_t numOutputs, ActivationType activationType = ActivationType::ReLU);
 
-    void setActivationFunction(ActivationType activationType);
-    std::vector<double> forward(const std::vector<double>& input) const;
+    // Uses existing parameters laid out like getWeightData() (padded weight rows, then biases)
+    // without copying them, e.g. a block of a memory-mapped model file.
+    LayerT(size_t numInputs, size_t numOutputs, ActivationType activationType, ParameterBuffer<T> params);
+
+    // Converts a layer of another precision; parameters are rounded to T.
+    template <typename U>
+    explicit LayerT(const LayerT<U>& other);
 
-    void setWeights(const std::vector<std::vector<double>>& weights);
-    std::vector<std::vector<double>> getWeights() const;
-    void setBiases(const std::vector<double>& biases);
-    std::vector<double> getBiases() const;
+    void setActivationFunction(ActivationType activationType);
+    // Exact (the default) or fast approximate sigmoid/tanh, see kernels::ActivationMode.
+    void setActivationMode(kernels::ActivationMode mode);
+    std::vector<T> forward(const std::vector<T>& input) const;
+    // Allocation-free forward: reads getInputSize() values from input, writes getOutputSize() values to output.
+    void forward(const T* input, T* output) const;
+    // Row-major batch forward: input is numSamples x getInputSize(), output is numSamples x getOutputSize().
+    void forwardBatch(const T* input, size_t numSamples, T* output) const;
+    // As above with consecutive samples inputStride values apart; samples may overlap (lagged windows).
+    void forwardBatch(const T* input, size_t numSamples, size_t inputStride, T* output) const;
+
+    void setWeights(const std::vector<std::vector<T>>& weights);
+    std::vector<std::vector<T>> getWeights() const;
+    void setBiases(const std::vector<T>& biases);
+    std::vector<T> getBiases() const;
+
+    // Direct access to the contiguous parameter buffer.
+    // Row i of the weight matrix starts at getWeightData() + i * getWeightStride().
+    T* getWeightData();
+    const T* getWeightData() const;
+    T* getBiasData();
+    const T* getBiasData() const;
+    size_t getWeightStride() const;
     
     size_t getInputSize() const;
     size_t getOutputSize() const;
     ActivationType getActivationFunction() const;
+    kernels::Activation getKernelActivation() const;
+    kernels::ActivationMode getActivationMode() const;
 
 
-    void setDeltas(const std::vector<std::vector<double>>& deltas);
-    std::vector<std::vector<double>> getDeltas() const;
-    std::vector<double> getOutput() const; // To access output of a layer
-
 private:
     size_t numInputs_;
     size_t numOutputs_;
-    std::vector<std::vector<double>> weights_;
-    std::vector<double> biases_;
+    size_t weightStride_; // numInputs_ rounded up so each weight row is 64-byte aligned
+    ParameterBuffer<T> params_; // [numOutputs_ x weightStride_] weights, then numOutputs_ biases
     ActivationType activationType_; // Store the activation type
-
-    mutable std::vector<double> output_;       // mutable для изменения в const методах
-    mutable bool outputCalculated_ = false;  // mutable для изменения в const методах
-
-
-
-    std::function<double(double)> activationFunction_;
+    kernels::Activation kernelActivation_;
+    kernels::ActivationMode activationMode_ = kernels::ActivationMode::Exact;
 
     void initializeWeights();
-    static double relu(double x);
-    static double sigmoid(double x);
-    static double tanh(double x);
-    static double linear(double x);
-
-
 };
 
+template <typename T>
+template <typename U>
+LayerT<T>::LayerT(const LayerT<U>& other) :
+    LayerT(other.getInputSize(), other.getOutputSize(), other.getActivationFunction())
+{
+    for (size_t i = 0; i < numOutputs_; ++i) {
+        const U* source = other.getWeightData() + i * other.getWeightStride();
+        std::copy(source, source + numInputs_, getWeightData() + i * weightStride_);
+    }
+    std::copy(other.getBiasData(), other.getBiasData() + numOutputs_, getBiasData());
+    activationMode_ = other.getActivationMode();
+}
+
+using Layer = LayerT<double>;
+using LayerF = LayerT<float>;
+
 #endif // LAYER_H
\ No newline at end of file
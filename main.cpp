@@ -1,15 +1,11 @@
 #include <iostream>
 #include <stdexcept>
 #include <cstring> // For strcmp
-#include <fstream>
-#include <random>
-#include <cmath>
-#include <numeric>
+#include <map>
 #include <memory> // For unique_ptr
-#include "interface_function.h"
-#include "data_storage.h"
-#include "neural_network.h"
-#include "data_normalization.h"
+#include "network_model.h"
+#include "instrumentation.h"
+#include "counted_allocation.h"
 
 #ifdef _WIN32  // For Windows
     #include <windows.h>
@@ -18,37 +14,347 @@
 #endif
 
 
+
+
 // Interface function prototype (exposed to other applications)
 extern "C" __declspec(dllexport) std::vector<double> processData(const std::vector<BarData>& barData, 
                                                             const std::map<std::string, std::vector<double>>& indicatorData, 
                                                             bool useIndicators, bool isTraining);
 
+// Streaming inference: prediction for one closed bar. indicators holds numInputs - 4 values in the
+// column order processData uses, or nullptr for an OHLC-only network or to use the built-in indicators.
+extern "C" __declspec(dllexport) bool onBar(const BarData* bar, const double* indicators, double* prediction);
+
 extern "C" __declspec(dllexport) bool setNetworkParameters(size_t numInputs, size_t numOutputs, const char* normalizationTypeStr, const char* modelVersion);
 
 extern "C" __declspec(dllexport) bool addLayerToNetwork(size_t numOutputs, const char* activationTypeStr);
 
+extern "C" __declspec(dllexport) bool setTrainingBatchSize(size_t batchSize);
+
+// Fixes the indicator input columns: names[i] feeds network input 4 + i. count == 0 restores the
+// default (indicator names in ascending order).
+extern "C" __declspec(dllexport) bool setIndicatorSchema(const char* const* names, size_t count);
+
+// Adds a built-in indicator computed from the bars themselves and makes the indicator schema follow
+// the built-in indicators. typeStr: SMA, EMA, RSI, ATR, BollingerUpper, BollingerLower, MACD,
+// MACDSignal, MACDHistogram, RollingMin or RollingMax; period is the fast period for the MACD types.
+extern "C" __declspec(dllexport) bool addBuiltInIndicator(const char* name, const char* typeStr, size_t period,
+                                                        size_t slowPeriod, size_t signalPeriod, double numStd);
+
+// Feeds the network the last lookback bars instead of one (numInputs = lookback * features per bar) and
+// trains it on numHorizons targets, horizons[k] bars ahead (numOutputs = numHorizons). targetTypeStr:
+// "Close" (future close) or "Change" (future close minus the last close). lookback == 0 switches back
+// to single bars and same-bar close targets.
+extern "C" __declspec(dllexport) bool setLaggedWindow(size_t lookback, const size_t* horizons, size_t numHorizons,
+                                                    const char* targetTypeStr);
+
+extern "C" __declspec(dllexport) bool enableQuantizedInference(const std::vector<BarData>& calibrationBars,
+                                                             const std::map<std::string, std::vector<double>>& indicatorData,
+                                                             bool useIndicators, double* maxAbsError, double* meanAbsError);
+
+extern "C" __declspec(dllexport) bool disableQuantizedInference();
+
+// Compiles the current network and normalization into an immutable inference plan (see
+// inference_plan.h) used by processData and onBar until the network, its normalization, the window
+// or the activation mode change; an int8 network takes precedence while enabled. Fails for online
+// normalization statistics. *numSteps (if not null) receives the matrix products per prediction and
+// *normalizationFolded whether the normalization was folded into the weights (false for MinMax).
+extern "C" __declspec(dllexport) bool optimizeForInference(size_t* numSteps, bool* normalizationFolded);
+
+extern "C" __declspec(dllexport) bool disableOptimizedInference();
+
+// Switches ZScore to per-feature online statistics, updated with every bar: mode "Cumulative" (Welford
+// over all bars), "Exponential" (param = alpha) or "Window" (param = bars in the window); "Off"
+// returns to the fixed mean/std. The statistics are saved with the model.
+extern "C" __declspec(dllexport) bool setOnlineNormalization(const char* modeStr, double param);
+
+// Selects the update rule for training and its learning rate: typeStr "Momentum" (param1 = momentum),
+// "Adam" (param1 = beta1, param2 = beta2), "RMSProp" (param1 = decay) or "AdaGrad"; epsilon is used
+// by all but Momentum. Resets the optimizer state, which is otherwise saved with the model.
+extern "C" __declspec(dllexport) bool setOptimizer(const char* typeStr, double learningRate, double param1, double param2,
+                                                 double epsilon);
+
+// modeStr "Exact" (default) or "Fast": vectorized sigmoid/tanh approximations with an absolute error
+// below 3e-7 (see kernels::ActivationMode). Applies to training and inference, and to networks
+// created or loaded later.
+extern "C" __declspec(dllexport) bool setActivationMode(const char* modeStr);
+
 extern "C" __declspec(dllexport) bool saveNetworkModel(const char* filename);
 
+extern "C" __declspec(dllexport) bool saveNetworkModelBinary(const char* filename);
+
+// Predictions keep running on the current model while the file is read; the new model replaces it
+// atomically when complete, and calls already running finish on the old one.
 extern "C" __declspec(dllexport) bool loadNetworkModel(const char* filename);
 
-// Global variables
-static std::unique_ptr<NeuralNetwork> g_neuralNetwork = nullptr;
-static std::unique_ptr<DataNormalization> g_dataNormalization = nullptr;
-static std::string g_modelVersion = "1.0";
+// As loadNetworkModel, on a background thread; returns at once. Predictions use the current model
+// until the new one is in place. waitForModelLoad returns the result of the last such load.
+extern "C" __declspec(dllexport) bool loadNetworkModelAsync(const char* filename);
 
+extern "C" __declspec(dllexport) bool waitForModelLoad();
 
-bool initializeNeuralNetwork(size_t numInputs, size_t numOutputs, DataNormalization::NormalizationType normalizationType, const std::string& modelVersion) {
-    try {
-        g_neuralNetwork = std::make_unique<NeuralNetwork>(numInputs, numOutputs);
-        g_dataNormalization = std::make_unique<DataNormalization>(normalizationType);
-        g_modelVersion = modelVersion;
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Error initializing: " << e.what() << std::endl;
-        return false;
+// Hot-path statistics as one JSON object (see instrumentation.h): per-stage calls, latency
+// (mean, max, p50/p99/p999) and allocations, per-layer forward timings, and allocation totals.
+// Writes it NUL-terminated to buffer and its size including the NUL to *requiredSize (if not null);
+// returns false without writing when buffer is null or smaller than that.
+extern "C" __declspec(dllexport) bool getNetworkStats(char* buffer, size_t bufferSize, size_t* requiredSize);
+
+extern "C" __declspec(dllexport) bool resetNetworkStats();
+
+// Skips the probes at run time; statistics collected so far are kept.
+extern "C" __declspec(dllexport) bool setNetworkStatsEnabled(bool enabled);
+
+
+// Handle-based API. Each handle owns a model of its own: network, normalization, int8 copy or plan,
+// indicator schema, window config, optimizer, activation mode and onBar state, none of it shared with
+// other handles or with the model behind the exports above; every setting above has a model* export
+// of its own below. Model files hold the network, normalization and optimizer but not the indicator
+// schema, built-in indicators or window config; a load keeps the handle's own, so set them on the
+// handle to reproduce such a model. Calls on different handles run in parallel without any global
+// lock; on one handle, predictions do not wait for loads, training or settings changes (see
+// network_model.h). A handle stays valid until destroyModel, which must not overlap with other calls
+// on it.
+using ModelHandle = NetworkModel*;
+
+// Returns nullptr on failure. numInputs == 0 creates an empty model to modelLoad into.
+extern "C" __declspec(dllexport) ModelHandle createModel(size_t numInputs, size_t numOutputs, const char* normalizationTypeStr,
+                                                         const char* modelVersion);
+
+extern "C" __declspec(dllexport) bool destroyModel(ModelHandle model);
+
+extern "C" __declspec(dllexport) bool modelAddLayer(ModelHandle model, size_t numOutputs, const char* activationTypeStr);
+
+// Same formats as loadNetworkModel / saveNetworkModel / saveNetworkModelBinary.
+extern "C" __declspec(dllexport) bool modelLoad(ModelHandle model, const char* filename);
+
+extern "C" __declspec(dllexport) bool modelLoadAsync(ModelHandle model, const char* filename);
+
+extern "C" __declspec(dllexport) bool modelWaitForLoad(ModelHandle model);
+
+extern "C" __declspec(dllexport) bool modelSave(ModelHandle model, const char* filename);
+
+extern "C" __declspec(dllexport) bool modelSaveBinary(ModelHandle model, const char* filename);
+
+// Streaming prediction for one closed bar, as onBar.
+extern "C" __declspec(dllexport) bool modelPredict(ModelHandle model, const BarData* bar, const double* indicators, double* prediction);
+
+// Batch inference or training over a history, as processData.
+extern "C" __declspec(dllexport) std::vector<double> modelProcessData(ModelHandle model, const std::vector<BarData>& barData,
+                                                                     const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                     bool useIndicators, bool isTraining);
+
+// Settings of one handle; each takes the arguments of the export above with the same name.
+extern "C" __declspec(dllexport) bool modelSetTrainingBatchSize(ModelHandle model, size_t batchSize);
+
+extern "C" __declspec(dllexport) bool modelSetIndicatorSchema(ModelHandle model, const char* const* names, size_t count);
+
+extern "C" __declspec(dllexport) bool modelAddBuiltInIndicator(ModelHandle model, const char* name, const char* typeStr, size_t period,
+                                                             size_t slowPeriod, size_t signalPeriod, double numStd);
+
+extern "C" __declspec(dllexport) bool modelSetLaggedWindow(ModelHandle model, size_t lookback, const size_t* horizons,
+                                                         size_t numHorizons, const char* targetTypeStr);
+
+extern "C" __declspec(dllexport) bool modelEnableQuantizedInference(ModelHandle model, const std::vector<BarData>& calibrationBars,
+                                                                  const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                  bool useIndicators, double* maxAbsError, double* meanAbsError);
+
+extern "C" __declspec(dllexport) bool modelDisableQuantizedInference(ModelHandle model);
+
+extern "C" __declspec(dllexport) bool modelOptimizeForInference(ModelHandle model, size_t* numSteps, bool* normalizationFolded);
+
+extern "C" __declspec(dllexport) bool modelDisableOptimizedInference(ModelHandle model);
+
+extern "C" __declspec(dllexport) bool modelSetOnlineNormalization(ModelHandle model, const char* modeStr, double param);
+
+extern "C" __declspec(dllexport) bool modelSetOptimizer(ModelHandle model, const char* typeStr, double learningRate, double param1,
+                                                      double param2, double epsilon);
+
+// Applies to this handle's network and to networks it creates or loads later.
+extern "C" __declspec(dllexport) bool modelSetActivationMode(ModelHandle model, const char* modeStr);
+
+static NetworkModel g_model; // the model behind the exports that take no handle
+
+static DataNormalization::NormalizationType parseNormalizationType(const char* normalizationTypeStr) {
+    if (normalizationTypeStr && std::strcmp(normalizationTypeStr, "MinMax") == 0) {
+        return DataNormalization::NormalizationType::MinMax;
     }
+    if (normalizationTypeStr && std::strcmp(normalizationTypeStr, "ZScore") == 0) {
+        return DataNormalization::NormalizationType::ZScore;
+    }
+    throw std::invalid_argument("Invalid normalization type.");
+}
+
+static ActivationType parseActivationType(const char* activationTypeStr) {
+    static const std::map<std::string, ActivationType> types = {
+        {"ReLU", ActivationType::ReLU},
+        {"Sigmoid", ActivationType::Sigmoid},
+        {"Tanh", ActivationType::Tanh},
+        {"Linear", ActivationType::Linear},
+        {"None", ActivationType::None}
+    };
+    auto it = activationTypeStr ? types.find(activationTypeStr) : types.end();
+    if (it == types.end()) {
+        throw std::invalid_argument("Invalid activation type.");
+    }
+    return it->second;
 }
 
+static void checkBarArguments(const BarData* bar, const double* prediction) {
+    if (!bar || !prediction) {
+        throw std::invalid_argument("Bar and prediction must not be null.");
+    }
+}
+
+static NetworkModel& checkModel(ModelHandle model) {
+    if (!model) {
+        throw std::invalid_argument("Model handle must not be null.");
+    }
+    return *model;
+}
+
+// The settings below parse their C arguments the same way for the default model and for a handle.
+
+static std::vector<std::string> parseIndicatorNames(const char* const* names, size_t count) {
+    if (count > 0 && !names) {
+        throw std::invalid_argument("Indicator names must not be null.");
+    }
+
+    std::vector<std::string> indicatorNames;
+    for (size_t i = 0; i < count; ++i) {
+        indicatorNames.emplace_back(names[i]);
+    }
+    return indicatorNames;
+}
+
+static IndicatorEngine::IndicatorSpec parseIndicatorSpec(const char* name, const char* typeStr, size_t period,
+                                                         size_t slowPeriod, size_t signalPeriod, double numStd) {
+    static const std::map<std::string, IndicatorEngine::IndicatorType> types = {
+        {"SMA", IndicatorEngine::IndicatorType::SMA},
+        {"EMA", IndicatorEngine::IndicatorType::EMA},
+        {"RSI", IndicatorEngine::IndicatorType::RSI},
+        {"ATR", IndicatorEngine::IndicatorType::ATR},
+        {"BollingerUpper", IndicatorEngine::IndicatorType::BollingerUpper},
+        {"BollingerLower", IndicatorEngine::IndicatorType::BollingerLower},
+        {"MACD", IndicatorEngine::IndicatorType::MACD},
+        {"MACDSignal", IndicatorEngine::IndicatorType::MACDSignal},
+        {"MACDHistogram", IndicatorEngine::IndicatorType::MACDHistogram},
+        {"RollingMin", IndicatorEngine::IndicatorType::RollingMin},
+        {"RollingMax", IndicatorEngine::IndicatorType::RollingMax}
+    };
+    if (!name || !typeStr) {
+        throw std::invalid_argument("Indicator name and type must not be null.");
+    }
+    auto it = types.find(typeStr);
+    if (it == types.end()) {
+        throw std::invalid_argument("Invalid indicator type.");
+    }
+
+    IndicatorEngine::IndicatorSpec spec{it->second, period};
+    spec.slowPeriod = slowPeriod;
+    spec.signalPeriod = signalPeriod;
+    spec.numStd = numStd;
+    return spec;
+}
+
+static void applyLaggedWindow(NetworkModel& model, size_t lookback, const size_t* horizons, size_t numHorizons,
+                              const char* targetTypeStr) {
+    if (lookback == 0) {
+        model.clearLaggedWindow();
+        return;
+    }
+    if (numHorizons > 0 && !horizons) {
+        throw std::invalid_argument("Horizons must not be null.");
+    }
+
+    WindowConfig config;
+    config.lookback = lookback;
+    config.horizons.assign(horizons, horizons + numHorizons);
+    if (targetTypeStr && std::strcmp(targetTypeStr, "Close") == 0) {
+        config.targetType = WindowConfig::TargetType::Close;
+    } else if (targetTypeStr && std::strcmp(targetTypeStr, "Change") == 0) {
+        config.targetType = WindowConfig::TargetType::Change;
+    } else {
+        throw std::invalid_argument("Invalid target type.");
+    }
+    model.setLaggedWindow(config);
+}
+
+static void applyQuantizedInference(NetworkModel& model, const std::vector<BarData>& calibrationBars,
+                                    const std::map<std::string, std::vector<double>>& indicatorData,
+                                    bool useIndicators, double* maxAbsError, double* meanAbsError) {
+    const QuantizedNetwork::CalibrationReport report = model.enableQuantizedInference(calibrationBars, indicatorData, useIndicators);
+    if (maxAbsError) {
+        *maxAbsError = report.maxAbsError;
+    }
+    if (meanAbsError) {
+        *meanAbsError = report.meanAbsError;
+    }
+}
+
+static void applyOptimizedInference(NetworkModel& model, size_t* numSteps, bool* normalizationFolded) {
+    const std::shared_ptr<const InferencePlan> plan = model.optimizeForInference();
+    if (numSteps) {
+        *numSteps = plan->getNumSteps();
+    }
+    if (normalizationFolded) {
+        *normalizationFolded = plan->isNormalizationFolded();
+    }
+}
+
+static void applyOnlineNormalization(NetworkModel& model, const char* modeStr, double param) {
+    if (modeStr && std::strcmp(modeStr, "Off") == 0) {
+        model.disableOnlineNormalization();
+    } else if (modeStr && std::strcmp(modeStr, "Cumulative") == 0) {
+        model.enableOnlineNormalization(RunningStats(RunningStats::Mode::Cumulative));
+    } else if (modeStr && std::strcmp(modeStr, "Exponential") == 0) {
+        model.enableOnlineNormalization(RunningStats(RunningStats::Mode::Exponential, param));
+    } else if (modeStr && std::strcmp(modeStr, "Window") == 0) {
+        if (!(param >= 1.0)) {
+            throw std::invalid_argument("Window must hold at least one bar.");
+        }
+        model.enableOnlineNormalization(RunningStats(RunningStats::Mode::Window, 0.0, static_cast<size_t>(param)));
+    } else {
+        throw std::invalid_argument("Invalid online normalization mode.");
+    }
+}
+
+static OptimizerConfig parseOptimizerConfig(const char* typeStr, double param1, double param2, double epsilon) {
+    OptimizerConfig config;
+    config.epsilon = epsilon;
+    if (typeStr && std::strcmp(typeStr, "Momentum") == 0) {
+        config.type = OptimizerType::Momentum;
+        config.momentum = param1;
+    } else if (typeStr && std::strcmp(typeStr, "Adam") == 0) {
+        config.type = OptimizerType::Adam;
+        config.beta1 = param1;
+        config.beta2 = param2;
+    } else if (typeStr && std::strcmp(typeStr, "RMSProp") == 0) {
+        config.type = OptimizerType::RMSProp;
+        config.decay = param1;
+    } else if (typeStr && std::strcmp(typeStr, "AdaGrad") == 0) {
+        config.type = OptimizerType::AdaGrad;
+    } else {
+        throw std::invalid_argument("Invalid optimizer type.");
+    }
+    return config;
+}
+
+static kernels::ActivationMode parseActivationMode(const char* modeStr) {
+    if (modeStr && std::strcmp(modeStr, "Exact") == 0) {
+        return kernels::ActivationMode::Exact;
+    }
+    if (modeStr && std::strcmp(modeStr, "Fast") == 0) {
+        return kernels::ActivationMode::Fast;
+    }
+    throw std::invalid_argument("Invalid activation mode.");
+}
+
+#ifndef NN_DISABLE_INSTRUMENTATION
+// Every allocation made by this module is counted for getNetworkStats. The replacements live here, in
+// the module's entry file, so only the module that exports the API carries them.
+NN_DEFINE_COUNTED_NEW(instrumentation::countAllocation)
+#endif
+
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     return TRUE;
 }
@@ -57,13 +363,7 @@ extern "C" __declspec(dllexport) std::vector<double> processData(const std::vect
                                                             const std::map<std::string, std::vector<double>>& indicatorData, 
                                                             bool useIndicators, bool isTraining) {
     try {
-        if (!g_neuralNetwork || !g_dataNormalization) {
-            throw std::runtime_error("Network not initialized.");
-        }
-
-        InterfaceFunction interface(*g_neuralNetwork, *g_dataNormalization);
-        interface.setTrainingMode(isTraining);
-        return interface.processData(barData, indicatorData, useIndicators);
+        return g_model.processData(barData, indicatorData, useIndicators, isTraining);
     } catch (const std::exception& e) {
         std::cerr << "Error processing data: " << e.what() << std::endl;
         return {}; 
@@ -71,18 +371,22 @@ extern "C" __declspec(dllexport) std::vector<double> processData(const std::vect
 }
 
 
-extern "C" __declspec(dllexport) bool setNetworkParameters(size_t numInputs, size_t numOutputs, const char* normalizationTypeStr, const char* modelVersion) {
+extern "C" __declspec(dllexport) bool onBar(const BarData* bar, const double* indicators, double* prediction) {
     try {
-        DataNormalization::NormalizationType normalizationType;
-        if (std::strcmp(normalizationTypeStr, "MinMax") == 0) {
-            normalizationType = DataNormalization::NormalizationType::MinMax;
-        } else if (std::strcmp(normalizationTypeStr, "ZScore") == 0) {
-            normalizationType = DataNormalization::NormalizationType::ZScore;
-        } else {
-            throw std::invalid_argument("Invalid normalization type.");
-        }
+        checkBarArguments(bar, prediction);
+        *prediction = g_model.onBar(*bar, indicators);
+        return true;
 
-        return initializeNeuralNetwork(numInputs, numOutputs, normalizationType, modelVersion);
+    } catch (const std::exception& e) {
+        std::cerr << "Error processing bar: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setNetworkParameters(size_t numInputs, size_t numOutputs, const char* normalizationTypeStr, const char* modelVersion) {
+    try {
+        g_model.initialize(numInputs, numOutputs, parseNormalizationType(normalizationTypeStr), modelVersion);
+        return true;
 
     } catch (const std::exception& e) {
         std::cerr << "Error setting parameters: " << e.what() << std::endl;
@@ -92,112 +396,506 @@ extern "C" __declspec(dllexport) bool setNetworkParameters(size_t numInputs, siz
 
 
 extern "C" __declspec(dllexport) bool addLayerToNetwork(size_t numOutputs, const char* activationTypeStr) {
-     try {
-         if (!g_neuralNetwork) {
-            throw std::runtime_error("Network not initialized.");
+    try {
+        g_model.addLayer(numOutputs, parseActivationType(activationTypeStr));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding layer: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setTrainingBatchSize(size_t batchSize) {
+    try {
+        g_model.setTrainingBatchSize(batchSize);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting batch size: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setIndicatorSchema(const char* const* names, size_t count) {
+    try {
+        g_model.setIndicatorSchema(parseIndicatorNames(names, count));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting indicator schema: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool addBuiltInIndicator(const char* name, const char* typeStr, size_t period,
+                                                        size_t slowPeriod, size_t signalPeriod, double numStd) {
+    try {
+        g_model.addBuiltInIndicator(name, parseIndicatorSpec(name, typeStr, period, slowPeriod, signalPeriod, numStd));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding indicator: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setLaggedWindow(size_t lookback, const size_t* horizons, size_t numHorizons,
+                                                    const char* targetTypeStr) {
+    try {
+        applyLaggedWindow(g_model, lookback, horizons, numHorizons, targetTypeStr);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting lagged window: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool enableQuantizedInference(const std::vector<BarData>& calibrationBars,
+                                                             const std::map<std::string, std::vector<double>>& indicatorData,
+                                                             bool useIndicators, double* maxAbsError, double* meanAbsError) {
+    try {
+        applyQuantizedInference(g_model, calibrationBars, indicatorData, useIndicators, maxAbsError, meanAbsError);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error enabling quantized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool disableQuantizedInference() {
+    try {
+        g_model.disableQuantizedInference();
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error disabling quantized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool optimizeForInference(size_t* numSteps, bool* normalizationFolded) {
+    try {
+        applyOptimizedInference(g_model, numSteps, normalizationFolded);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error optimizing for inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool disableOptimizedInference() {
+    try {
+        g_model.disableOptimizedInference();
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error disabling optimized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setOnlineNormalization(const char* modeStr, double param) {
+    try {
+        applyOnlineNormalization(g_model, modeStr, param);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting online normalization: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setOptimizer(const char* typeStr, double learningRate, double param1, double param2,
+                                                 double epsilon) {
+    try {
+        g_model.setOptimizer(parseOptimizerConfig(typeStr, param1, param2, epsilon), learningRate);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting optimizer: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool setActivationMode(const char* modeStr) {
+    try {
+        g_model.setActivationMode(parseActivationMode(modeStr));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting activation mode: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool saveNetworkModel(const char* filename) {
+    try {
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
+        }
+        g_model.save(filename);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving model: " << e.what() << std::endl;
+        return false; 
+    }
+}
+
+extern "C" __declspec(dllexport) bool saveNetworkModelBinary(const char* filename) {
+    try {
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
+        }
+        g_model.saveBinary(filename);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Accepts both the binary format (mapped and used in place) and the text format written by saveNetworkModel.
+extern "C" __declspec(dllexport) bool loadNetworkModel(const char* filename) {
+    try {
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
         }
+        g_model.load(filename);
+        return true; 
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return false; 
+    }
+}
 
-        Layer::ActivationType activationType;
-         if (std::strcmp(activationTypeStr, "ReLU") == 0) {
-            activationType = Layer::ActivationType::ReLU;
-        } else if (std::strcmp(activationTypeStr, "Sigmoid") == 0) {
-            activationType = Layer::ActivationType::Sigmoid;
-        } else if (std::strcmp(activationTypeStr, "Tanh") == 0) {
-           activationType = Layer::ActivationType::Tanh;
-        } else if (std::strcmp(activationTypeStr, "Linear") == 0) {
-            activationType = Layer::ActivationType::Linear;
-        } else if (std::strcmp(activationTypeStr, "None") == 0) {
-            activationType = Layer::ActivationType::None;
-        } else {
-            throw std::invalid_argument("Invalid activation type.");
+extern "C" __declspec(dllexport) bool loadNetworkModelAsync(const char* filename) {
+    try {
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
         }
+        g_model.loadAsync(filename);
+        return true;
 
-        g_neuralNetwork->addLayer(numOutputs, activationType);
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool waitForModelLoad() {
+    try {
+        g_model.waitForLoad();
         return true;
 
     } catch (const std::exception& e) {
-        std::cerr << "Error adding layer: " << e.what() << std::endl;
+        std::cerr << "Error loading model: " << e.what() << std::endl;
         return false;
     }
 }
 
-extern "C" __declspec(dllexport) bool saveNetworkModel(const char* filename) {
+extern "C" __declspec(dllexport) ModelHandle createModel(size_t numInputs, size_t numOutputs, const char* normalizationTypeStr,
+                                                         const char* modelVersion) {
     try {
-        if (!g_neuralNetwork || !g_dataNormalization) {
-            throw std::runtime_error("Network not initialized.");
+        auto model = std::make_unique<NetworkModel>();
+        if (numInputs > 0) {
+            model->initialize(numInputs, numOutputs, parseNormalizationType(normalizationTypeStr), modelVersion ? modelVersion : "1.0");
         }
+        return model.release();
 
-        std::ofstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open file to save model.");
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating model: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+extern "C" __declspec(dllexport) bool destroyModel(ModelHandle model) {
+    delete model;
+    return model != nullptr;
+}
+
+extern "C" __declspec(dllexport) bool modelAddLayer(ModelHandle model, size_t numOutputs, const char* activationTypeStr) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
         }
+        model->addLayer(numOutputs, parseActivationType(activationTypeStr));
+        return true;
 
-        // 1. Save Model Version
-        file << g_modelVersion << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding layer: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        // 2. Save Normalization Type
-        file << static_cast<int>(g_dataNormalization->getNormalizationType()) << "\n";
+extern "C" __declspec(dllexport) bool modelLoad(ModelHandle model, const char* filename) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
+        }
+        model->load(filename);
+        return true;
 
-        if (g_dataNormalization->getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
-            file << g_dataNormalization->getMinRange() << " " << g_dataNormalization->getMaxRange() << "\n";
-        } else if (g_dataNormalization->getNormalizationType() == DataNormalization::NormalizationType::ZScore) {
-             file << g_dataNormalization->getMean() << " " << g_dataNormalization->getStd() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelLoadAsync(ModelHandle model, const char* filename) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
         }
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
+        }
+        model->loadAsync(filename);
+        return true;
 
-        // 3. Save Neural Network
-        g_neuralNetwork->saveModel(file); 
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        file.close();
+extern "C" __declspec(dllexport) bool modelWaitForLoad(ModelHandle model) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        model->waitForLoad();
+        return true;
 
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelSave(ModelHandle model, const char* filename) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
+        }
+        model->save(filename);
         return true;
 
     } catch (const std::exception& e) {
         std::cerr << "Error saving model: " << e.what() << std::endl;
-        return false; 
+        return false;
     }
 }
 
-extern "C" __declspec(dllexport) bool loadNetworkModel(const char* filename) {
+extern "C" __declspec(dllexport) bool modelSaveBinary(ModelHandle model, const char* filename) {
     try {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open file to load model.");
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        if (!filename) {
+            throw std::invalid_argument("File name must not be null.");
         }
+        model->saveBinary(filename);
+        return true;
 
-        // 1. Load Model Version
-        std::string modelVersion;
-        std::getline(file, modelVersion);
-        g_modelVersion = modelVersion;
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving model: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        //2. Load Normalization Type
-        int normalizationTypeInt;
-        file >> normalizationTypeInt;
-        DataNormalization::NormalizationType normalizationType = static_cast<DataNormalization::NormalizationType>(normalizationTypeInt);
+extern "C" __declspec(dllexport) bool modelPredict(ModelHandle model, const BarData* bar, const double* indicators, double* prediction) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        checkBarArguments(bar, prediction);
+        *prediction = model->onBar(*bar, indicators);
+        return true;
 
+    } catch (const std::exception& e) {
+        std::cerr << "Error processing bar: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        g_dataNormalization = std::make_unique<DataNormalization>(normalizationType);
+extern "C" __declspec(dllexport) std::vector<double> modelProcessData(ModelHandle model, const std::vector<BarData>& barData,
+                                                                     const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                     bool useIndicators, bool isTraining) {
+    try {
+        if (!model) {
+            throw std::invalid_argument("Model handle must not be null.");
+        }
+        return model->processData(barData, indicatorData, useIndicators, isTraining);
 
+    } catch (const std::exception& e) {
+        std::cerr << "Error processing data: " << e.what() << std::endl;
+        return {};
+    }
+}
 
-       if(g_dataNormalization->getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
-           double min, max;
-           file >> min >> max;
-           g_dataNormalization->setMinMaxRange(min, max);
-       } else if(g_dataNormalization->getNormalizationType() == DataNormalization::NormalizationType::ZScore) {
-            double mean, std;
-           file >> mean >> std;
-           g_dataNormalization->setMeanStd(mean, std);
-       }
+extern "C" __declspec(dllexport) bool modelSetTrainingBatchSize(ModelHandle model, size_t batchSize) {
+    try {
+        checkModel(model).setTrainingBatchSize(batchSize);
+        return true;
 
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting batch size: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-        //3. Load Neural Network
-        g_neuralNetwork = std::make_unique<NeuralNetwork>(); // Correctly create a new NeuralNetwork 
-        g_neuralNetwork->loadModel(file);
+extern "C" __declspec(dllexport) bool modelSetIndicatorSchema(ModelHandle model, const char* const* names, size_t count) {
+    try {
+        checkModel(model).setIndicatorSchema(parseIndicatorNames(names, count));
+        return true;
 
-        file.close();
-        return true; 
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting indicator schema: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelAddBuiltInIndicator(ModelHandle model, const char* name, const char* typeStr, size_t period,
+                                                             size_t slowPeriod, size_t signalPeriod, double numStd) {
+    try {
+        checkModel(model).addBuiltInIndicator(name, parseIndicatorSpec(name, typeStr, period, slowPeriod, signalPeriod, numStd));
+        return true;
 
     } catch (const std::exception& e) {
-        std::cerr << "Error loading model: " << e.what() << std::endl;
-        return false; 
+        std::cerr << "Error adding indicator: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelSetLaggedWindow(ModelHandle model, size_t lookback, const size_t* horizons,
+                                                         size_t numHorizons, const char* targetTypeStr) {
+    try {
+        applyLaggedWindow(checkModel(model), lookback, horizons, numHorizons, targetTypeStr);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting lagged window: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelEnableQuantizedInference(ModelHandle model, const std::vector<BarData>& calibrationBars,
+                                                                  const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                  bool useIndicators, double* maxAbsError, double* meanAbsError) {
+    try {
+        applyQuantizedInference(checkModel(model), calibrationBars, indicatorData, useIndicators, maxAbsError, meanAbsError);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error enabling quantized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelDisableQuantizedInference(ModelHandle model) {
+    try {
+        checkModel(model).disableQuantizedInference();
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error disabling quantized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelOptimizeForInference(ModelHandle model, size_t* numSteps, bool* normalizationFolded) {
+    try {
+        applyOptimizedInference(checkModel(model), numSteps, normalizationFolded);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error optimizing for inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelDisableOptimizedInference(ModelHandle model) {
+    try {
+        checkModel(model).disableOptimizedInference();
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error disabling optimized inference: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelSetOnlineNormalization(ModelHandle model, const char* modeStr, double param) {
+    try {
+        applyOnlineNormalization(checkModel(model), modeStr, param);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting online normalization: " << e.what() << std::endl;
+        return false;
     }
-}
\ No newline at end of file
+}
+
+extern "C" __declspec(dllexport) bool modelSetOptimizer(ModelHandle model, const char* typeStr, double learningRate, double param1,
+                                                      double param2, double epsilon) {
+    try {
+        checkModel(model).setOptimizer(parseOptimizerConfig(typeStr, param1, param2, epsilon), learningRate);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting optimizer: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool modelSetActivationMode(ModelHandle model, const char* modeStr) {
+    try {
+        checkModel(model).setActivationMode(parseActivationMode(modeStr));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting activation mode: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool getNetworkStats(char* buffer, size_t bufferSize, size_t* requiredSize) {
+    try {
+        const std::string stats = instrumentation::toJson();
+        if (requiredSize) {
+            *requiredSize = stats.size() + 1;
+        }
+        if (!buffer || bufferSize < stats.size() + 1) {
+            return false;
+        }
+        std::memcpy(buffer, stats.c_str(), stats.size() + 1);
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading network stats: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+extern "C" __declspec(dllexport) bool resetNetworkStats() {
+    instrumentation::reset();
+    return true;
+}
+
+extern "C" __declspec(dllexport) bool setNetworkStatsEnabled(bool enabled) {
+    instrumentation::setEnabled(enabled);
+    return true;
+}
@@ -0,0 +1,89 @@
+// mapped_file.cpp
+#include "mapped_file.h"
+
+#ifdef _WIN32  // For Windows
+    #include <windows.h>
+#else // For Linux/macOS
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file to map: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not map empty or unreadable file: " + path);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not create file mapping: " + path);
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Could not map file: " + path);
+    }
+
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    data_ = static_cast<unsigned char*>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mappingHandle_));
+    CloseHandle(static_cast<HANDLE>(fileHandle_));
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file to map: " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not map empty or unreadable file: " + path);
+    }
+
+    // MAP_PRIVATE: writes (e.g. further training) copy the touched pages instead of changing the file.
+    void* view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("Could not map file: " + path);
+    }
+
+    data_ = static_cast<unsigned char*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile() {
+    ::munmap(data_, size_);
+}
+
+#endif
+
+unsigned char* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
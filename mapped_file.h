@@ -0,0 +1,32 @@
+// mapped_file.h
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+// Whole-file copy-on-write memory mapping. Pages are shared with the page cache (and with other
+// processes mapping the same file) until written; writes stay private to this mapping and never
+// reach the file. The mapping starts on a page boundary.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    unsigned char* data() const;
+    size_t size() const;
+
+private:
+    unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
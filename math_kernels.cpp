@@ -0,0 +1,813 @@
+// math_kernels.cpp
+#include "math_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX512F__)
+    #define NN_SIMD_AVX512
+    #include <immintrin.h>
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+    #define NN_SIMD_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace kernels {
+
+namespace {
+
+    // Thin wrapper over the selected vector register type, so each kernel is written once
+    // per scalar type. The scalar fallback uses one "lane" and plain arithmetic.
+    template <typename T>
+    struct Simd;
+
+#if defined(NN_SIMD_AVX512)
+    template <>
+    struct Simd<double> {
+        using Vec = __m512d;
+        static constexpr std::size_t kLanes = 8;
+        static Vec zero() { return _mm512_setzero_pd(); }
+        static Vec load(const double* p) { return _mm512_load_pd(p); }
+        static Vec loadu(const double* p) { return _mm512_loadu_pd(p); }
+        static Vec set1(double v) { return _mm512_set1_pd(v); }
+        static Vec fmadd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+        static Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+        static Vec sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+        static Vec min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+        // test > 0 ? a : b per lane
+        static Vec selectPositive(Vec test, Vec a, Vec b) {
+            return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(test, _mm512_setzero_pd(), _CMP_GT_OQ), b, a);
+        }
+        static void store(double* p, Vec v) { _mm512_store_pd(p, v); }
+        static void storeu(double* p, Vec v) { _mm512_storeu_pd(p, v); }
+        static double sum(Vec v) { return _mm512_reduce_add_pd(v); }
+    };
+
+    template <>
+    struct Simd<float> {
+        using Vec = __m512;
+        static constexpr std::size_t kLanes = 16;
+        static Vec zero() { return _mm512_setzero_ps(); }
+        static Vec load(const float* p) { return _mm512_load_ps(p); }
+        static Vec loadu(const float* p) { return _mm512_loadu_ps(p); }
+        static Vec set1(float v) { return _mm512_set1_ps(v); }
+        static Vec fmadd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+        static Vec add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+        static Vec sqrt(Vec a) { return _mm512_sqrt_ps(a); }
+        static Vec min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+        static Vec selectPositive(Vec test, Vec a, Vec b) {
+            return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(test, _mm512_setzero_ps(), _CMP_GT_OQ), b, a);
+        }
+        static void store(float* p, Vec v) { _mm512_store_ps(p, v); }
+        static void storeu(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+        static float sum(Vec v) { return _mm512_reduce_add_ps(v); }
+    };
+#elif defined(NN_SIMD_AVX2)
+    template <>
+    struct Simd<double> {
+        using Vec = __m256d;
+        static constexpr std::size_t kLanes = 4;
+        static Vec zero() { return _mm256_setzero_pd(); }
+        static Vec load(const double* p) { return _mm256_load_pd(p); }
+        static Vec loadu(const double* p) { return _mm256_loadu_pd(p); }
+        static Vec set1(double v) { return _mm256_set1_pd(v); }
+        static Vec fmadd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+        static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+        static Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+        static Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+        static Vec selectPositive(Vec test, Vec a, Vec b) {
+            return _mm256_blendv_pd(b, a, _mm256_cmp_pd(test, _mm256_setzero_pd(), _CMP_GT_OQ));
+        }
+        static void store(double* p, Vec v) { _mm256_store_pd(p, v); }
+        static void storeu(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+        static double sum(Vec v) {
+            __m128d lo = _mm256_castpd256_pd128(v);
+            __m128d hi = _mm256_extractf128_pd(v, 1);
+            lo = _mm_add_pd(lo, hi);
+            __m128d shuf = _mm_unpackhi_pd(lo, lo);
+            return _mm_cvtsd_f64(_mm_add_sd(lo, shuf));
+        }
+    };
+
+    template <>
+    struct Simd<float> {
+        using Vec = __m256;
+        static constexpr std::size_t kLanes = 8;
+        static Vec zero() { return _mm256_setzero_ps(); }
+        static Vec load(const float* p) { return _mm256_load_ps(p); }
+        static Vec loadu(const float* p) { return _mm256_loadu_ps(p); }
+        static Vec set1(float v) { return _mm256_set1_ps(v); }
+        static Vec fmadd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+        static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+        static Vec sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+        static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+        static Vec selectPositive(Vec test, Vec a, Vec b) {
+            return _mm256_blendv_ps(b, a, _mm256_cmp_ps(test, _mm256_setzero_ps(), _CMP_GT_OQ));
+        }
+        static void store(float* p, Vec v) { _mm256_store_ps(p, v); }
+        static void storeu(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+        static float sum(Vec v) {
+            __m128 lo = _mm256_castps256_ps128(v);
+            __m128 hi = _mm256_extractf128_ps(v, 1);
+            lo = _mm_add_ps(lo, hi);
+            lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+            lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+            return _mm_cvtss_f32(lo);
+        }
+    };
+#else
+    template <typename T>
+    struct Simd {
+        using Vec = T;
+        static constexpr std::size_t kLanes = 1;
+        static Vec zero() { return T(0); }
+        static Vec load(const T* p) { return *p; }
+        static Vec loadu(const T* p) { return *p; }
+        static Vec set1(T v) { return v; }
+        static Vec fmadd(Vec a, Vec b, Vec c) { return a * b + c; }
+        static Vec add(Vec a, Vec b) { return a + b; }
+        static Vec sub(Vec a, Vec b) { return a - b; }
+        static Vec mul(Vec a, Vec b) { return a * b; }
+        static Vec div(Vec a, Vec b) { return a / b; }
+        static Vec sqrt(Vec a) { return std::sqrt(a); }
+        static Vec min(Vec a, Vec b) { return b < a ? b : a; }
+        static Vec max(Vec a, Vec b) { return a < b ? b : a; }
+        static Vec selectPositive(Vec test, Vec a, Vec b) { return test > T(0) ? a : b; }
+        static void store(T* p, Vec v) { *p = v; }
+        static void storeu(T* p, Vec v) { *p = v; }
+        static T sum(Vec v) { return v; }
+    };
+#endif
+
+    // Sample and output-row block sizes for gemm: a block of 64 weight rows of up to
+    // 64 inputs (32 KB in double) stays in L1/L2 while 64 samples stream past it.
+    constexpr std::size_t kSampleBlock = 64;
+    constexpr std::size_t kRowBlock = 64;
+
+    // Applies op to y[0..n) one vector at a time. The tail goes through a zero-padded copy, so every
+    // value sees the same arithmetic wherever it sits in the array.
+    template <typename T, typename Op>
+    void transform(T* y, std::size_t n, Op op) {
+        using S = Simd<T>;
+        std::size_t i = 0;
+        for (; i + S::kLanes <= n; i += S::kLanes) {
+            S::storeu(y + i, op(S::loadu(y + i)));
+        }
+        if (i < n) {
+            T tail[S::kLanes] = {};
+            std::copy(y + i, y + n, tail);
+            S::storeu(tail, op(S::loadu(tail)));
+            std::copy(tail, tail + (n - i), y + i);
+        }
+    }
+
+    // As transform, for delta[i] = op(y[i], delta[i]).
+    template <typename T, typename Op>
+    void transformDelta(const T* y, T* delta, std::size_t n, Op op) {
+        using S = Simd<T>;
+        std::size_t i = 0;
+        for (; i + S::kLanes <= n; i += S::kLanes) {
+            S::storeu(delta + i, op(S::loadu(y + i), S::loadu(delta + i)));
+        }
+        if (i < n) {
+            T yTail[S::kLanes] = {};
+            T deltaTail[S::kLanes] = {};
+            std::copy(y + i, y + n, yTail);
+            std::copy(delta + i, delta + n, deltaTail);
+            S::storeu(deltaTail, op(S::loadu(yTail), S::loadu(deltaTail)));
+            std::copy(deltaTail, deltaTail + (n - i), delta + i);
+        }
+    }
+
+    // Rational minimax approximation of tanh, see ActivationMode::Fast. The clamp bound is where the
+    // approximation reaches 1 in float; the constant goes first so a NaN input stays NaN.
+    template <typename T>
+    typename Simd<T>::Vec fastTanh(typename Simd<T>::Vec x) {
+        using S = Simd<T>;
+        using Vec = typename S::Vec;
+        const T bound = T(7.90531110763549805);
+        x = S::min(S::set1(bound), S::max(S::set1(-bound), x));
+        const Vec x2 = S::mul(x, x);
+        Vec p = S::set1(T(-2.76076847742355e-16));
+        p = S::fmadd(p, x2, S::set1(T(2.00018790482477e-13)));
+        p = S::fmadd(p, x2, S::set1(T(-8.60467152213735e-11)));
+        p = S::fmadd(p, x2, S::set1(T(5.12229709037114e-08)));
+        p = S::fmadd(p, x2, S::set1(T(1.48572235717979e-05)));
+        p = S::fmadd(p, x2, S::set1(T(6.37261928875436e-04)));
+        p = S::fmadd(p, x2, S::set1(T(4.89352455891786e-03)));
+        p = S::mul(p, x);
+        Vec q = S::set1(T(1.19825839466702e-06));
+        q = S::fmadd(q, x2, S::set1(T(1.18534705686654e-04)));
+        q = S::fmadd(q, x2, S::set1(T(2.26843463243900e-03)));
+        q = S::fmadd(q, x2, S::set1(T(4.89352518554385e-03)));
+        return S::div(p, q);
+    }
+
+    // y[r] = dot(w row r, x) + bias[r]; the caller applies the activation over y afterwards.
+    // Four rows share every load of x.
+    template <typename T>
+    void gemvImpl(const T* w, std::size_t stride, const T* bias,
+                  const T* x, std::size_t rows, std::size_t cols, T* y) {
+        using S = Simd<T>;
+        using Vec = typename S::Vec;
+        std::size_t r = 0;
+        for (; r + 4 <= rows; r += 4) {
+            const T* w0 = w + r * stride;
+            const T* w1 = w0 + stride;
+            const T* w2 = w1 + stride;
+            const T* w3 = w2 + stride;
+            Vec a0 = S::zero(), a1 = S::zero(), a2 = S::zero(), a3 = S::zero();
+            std::size_t j = 0;
+            for (; j + S::kLanes <= cols; j += S::kLanes) {
+                Vec xv = S::loadu(x + j);
+                a0 = S::fmadd(S::load(w0 + j), xv, a0);
+                a1 = S::fmadd(S::load(w1 + j), xv, a1);
+                a2 = S::fmadd(S::load(w2 + j), xv, a2);
+                a3 = S::fmadd(S::load(w3 + j), xv, a3);
+            }
+            T s0 = S::sum(a0), s1 = S::sum(a1), s2 = S::sum(a2), s3 = S::sum(a3);
+            for (; j < cols; ++j) {
+                T xj = x[j];
+                s0 += w0[j] * xj;
+                s1 += w1[j] * xj;
+                s2 += w2[j] * xj;
+                s3 += w3[j] * xj;
+            }
+            y[r] = s0 + bias[r];
+            y[r + 1] = s1 + bias[r + 1];
+            y[r + 2] = s2 + bias[r + 2];
+            y[r + 3] = s3 + bias[r + 3];
+        }
+        for (; r < rows; ++r) {
+            y[r] = dot(w + r * stride, x, cols) + bias[r];
+        }
+    }
+
+    // 2 samples x 4 weight rows register tile: 8 accumulators, 6 loads per step.
+    template <typename T>
+    inline void gemmTile2x4(const T* x0, const T* x1, const T* w, std::size_t stride,
+                            const T* bias, std::size_t cols, T* y0, T* y1) {
+        using S = Simd<T>;
+        using Vec = typename S::Vec;
+        const T* w0 = w;
+        const T* w1 = w0 + stride;
+        const T* w2 = w1 + stride;
+        const T* w3 = w2 + stride;
+        Vec a00 = S::zero(), a01 = S::zero(), a02 = S::zero(), a03 = S::zero();
+        Vec a10 = S::zero(), a11 = S::zero(), a12 = S::zero(), a13 = S::zero();
+        std::size_t j = 0;
+        for (; j + S::kLanes <= cols; j += S::kLanes) {
+            Vec xa = S::loadu(x0 + j);
+            Vec xb = S::loadu(x1 + j);
+            Vec wv = S::load(w0 + j);
+            a00 = S::fmadd(wv, xa, a00);
+            a10 = S::fmadd(wv, xb, a10);
+            wv = S::load(w1 + j);
+            a01 = S::fmadd(wv, xa, a01);
+            a11 = S::fmadd(wv, xb, a11);
+            wv = S::load(w2 + j);
+            a02 = S::fmadd(wv, xa, a02);
+            a12 = S::fmadd(wv, xb, a12);
+            wv = S::load(w3 + j);
+            a03 = S::fmadd(wv, xa, a03);
+            a13 = S::fmadd(wv, xb, a13);
+        }
+        T s[8] = {S::sum(a00), S::sum(a01), S::sum(a02), S::sum(a03),
+                  S::sum(a10), S::sum(a11), S::sum(a12), S::sum(a13)};
+        for (; j < cols; ++j) {
+            T xa = x0[j], xb = x1[j];
+            s[0] += w0[j] * xa; s[4] += w0[j] * xb;
+            s[1] += w1[j] * xa; s[5] += w1[j] * xb;
+            s[2] += w2[j] * xa; s[6] += w2[j] * xb;
+            s[3] += w3[j] * xa; s[7] += w3[j] * xb;
+        }
+        for (std::size_t k = 0; k < 4; ++k) {
+            y0[k] = s[k] + bias[k];
+            y1[k] = s[k + 4] + bias[k];
+        }
+    }
+
+    // The activation is applied to each tile's outputs while they are still in L1.
+    template <typename T>
+    void gemmImpl(const T* x, std::size_t n, std::size_t xStride,
+                  const T* w, std::size_t wStride, const T* bias,
+                  std::size_t rows, std::size_t cols,
+                  T* y, std::size_t yStride, Activation act, ActivationMode mode) {
+        for (std::size_t i0 = 0; i0 < n; i0 += kSampleBlock) {
+            const std::size_t i1 = std::min(n, i0 + kSampleBlock);
+            for (std::size_t r0 = 0; r0 < rows; r0 += kRowBlock) {
+                const std::size_t r1 = std::min(rows, r0 + kRowBlock);
+                std::size_t i = i0;
+                for (; i + 2 <= i1; i += 2) {
+                    const T* xa = x + i * xStride;
+                    const T* xb = xa + xStride;
+                    T* ya = y + i * yStride;
+                    T* yb = ya + yStride;
+                    std::size_t r = r0;
+                    for (; r + 4 <= r1; r += 4) {
+                        gemmTile2x4(xa, xb, w + r * wStride, wStride, bias + r, cols, ya + r, yb + r);
+                    }
+                    for (; r < r1; ++r) {
+                        const T* wr = w + r * wStride;
+                        ya[r] = dot(wr, xa, cols) + bias[r];
+                        yb[r] = dot(wr, xb, cols) + bias[r];
+                    }
+                    applyActivation(ya + r0, r1 - r0, act, mode);
+                    applyActivation(yb + r0, r1 - r0, act, mode);
+                }
+                if (i < i1) {
+                    T* yi = y + i * yStride + r0;
+                    gemvImpl(w + r0 * wStride, wStride, bias + r0, x + i * xStride, r1 - r0, cols, yi);
+                    applyActivation(yi, r1 - r0, act, mode);
+                }
+            }
+        }
+    }
+
+} // namespace
+
+template <typename T>
+T dot(const T* a, const T* b, std::size_t n) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    std::size_t i = 0;
+    Vec acc0 = S::zero(), acc1 = S::zero();
+    for (; i + 2 * S::kLanes <= n; i += 2 * S::kLanes) {
+        acc0 = S::fmadd(S::loadu(a + i), S::loadu(b + i), acc0);
+        acc1 = S::fmadd(S::loadu(a + i + S::kLanes), S::loadu(b + i + S::kLanes), acc1);
+    }
+    T sum = S::sum(S::add(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+template <typename T>
+void gemv(const T* w, std::size_t stride, const T* bias,
+          const T* x, std::size_t rows, std::size_t cols,
+          T* y, Activation act, ActivationMode mode) {
+    gemvImpl(w, stride, bias, x, rows, cols, y);
+    applyActivation(y, rows, act, mode);
+}
+
+template <typename T>
+void gemm(const T* x, std::size_t n, std::size_t xStride,
+          const T* w, std::size_t wStride, const T* bias,
+          std::size_t rows, std::size_t cols,
+          T* y, std::size_t yStride, Activation act, ActivationMode mode) {
+    gemmImpl(x, n, xStride, w, wStride, bias, rows, cols, y, yStride, act, mode);
+}
+
+template <typename T>
+void weightGradient(const T* delta, std::size_t n, std::size_t deltaStride,
+                    const T* x, std::size_t xStride,
+                    std::size_t rows, std::size_t cols,
+                    T* g, std::size_t gStride, T* gBias) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    // Four gradient rows stay hot in L1 while the samples stream past; every load of x feeds four rows.
+    std::size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        T* g0 = g + r * gStride;
+        T* g1 = g0 + gStride;
+        T* g2 = g1 + gStride;
+        T* g3 = g2 + gStride;
+        for (std::size_t i = 0; i < n; ++i) {
+            const T* d = delta + i * deltaStride + r;
+            const T* xi = x + i * xStride;
+            const Vec d0 = S::set1(d[0]), d1 = S::set1(d[1]), d2 = S::set1(d[2]), d3 = S::set1(d[3]);
+            std::size_t j = 0;
+            for (; j + S::kLanes <= cols; j += S::kLanes) {
+                const Vec xv = S::loadu(xi + j);
+                S::store(g0 + j, S::fmadd(d0, xv, S::load(g0 + j)));
+                S::store(g1 + j, S::fmadd(d1, xv, S::load(g1 + j)));
+                S::store(g2 + j, S::fmadd(d2, xv, S::load(g2 + j)));
+                S::store(g3 + j, S::fmadd(d3, xv, S::load(g3 + j)));
+            }
+            for (; j < cols; ++j) {
+                g0[j] += d[0] * xi[j];
+                g1[j] += d[1] * xi[j];
+                g2[j] += d[2] * xi[j];
+                g3[j] += d[3] * xi[j];
+            }
+            gBias[r] += d[0];
+            gBias[r + 1] += d[1];
+            gBias[r + 2] += d[2];
+            gBias[r + 3] += d[3];
+        }
+    }
+    for (; r < rows; ++r) {
+        T* gr = g + r * gStride;
+        for (std::size_t i = 0; i < n; ++i) {
+            const T d = delta[i * deltaStride + r];
+            const T* xi = x + i * xStride;
+            const Vec dv = S::set1(d);
+            std::size_t j = 0;
+            for (; j + S::kLanes <= cols; j += S::kLanes) {
+                S::store(gr + j, S::fmadd(dv, S::loadu(xi + j), S::load(gr + j)));
+            }
+            for (; j < cols; ++j) {
+                gr[j] += d * xi[j];
+            }
+            gBias[r] += d;
+        }
+    }
+}
+
+template <typename T>
+void inputGradient(const T* delta, std::size_t n, std::size_t deltaStride,
+                   const T* w, std::size_t wStride,
+                   std::size_t rows, std::size_t cols,
+                   T* dx, std::size_t dxStride) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    for (std::size_t i = 0; i < n; ++i) {
+        const T* d = delta + i * deltaStride;
+        T* out = dx + i * dxStride;
+        std::fill(out, out + cols, T(0));
+        for (std::size_t r = 0; r < rows; ++r) {
+            const T* wr = w + r * wStride;
+            const Vec dv = S::set1(d[r]);
+            std::size_t j = 0;
+            for (; j + S::kLanes <= cols; j += S::kLanes) {
+                S::storeu(out + j, S::fmadd(dv, S::load(wr + j), S::loadu(out + j)));
+            }
+            for (; j < cols; ++j) {
+                out[j] += d[r] * wr[j];
+            }
+        }
+    }
+}
+
+template <typename T>
+void applyActivation(T* y, std::size_t n, Activation act, ActivationMode mode) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    switch (act) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            transform(y, n, [](Vec v) { return S::max(v, S::zero()); });
+            break;
+        case Activation::Sigmoid:
+            if (mode == ActivationMode::Fast) {
+                const Vec half = S::set1(T(0.5));
+                transform(y, n, [half](Vec v) { return S::fmadd(fastTanh<T>(S::mul(v, half)), half, half); });
+            } else {
+                for (std::size_t i = 0; i < n; ++i) {
+                    y[i] = T(1) / (T(1) + std::exp(-y[i]));
+                }
+            }
+            break;
+        case Activation::Tanh:
+            if (mode == ActivationMode::Fast) {
+                transform(y, n, [](Vec v) { return fastTanh<T>(v); });
+            } else {
+                for (std::size_t i = 0; i < n; ++i) {
+                    y[i] = std::tanh(y[i]);
+                }
+            }
+            break;
+    }
+}
+
+template <typename T>
+void multiplyActivationDerivative(const T* y, T* delta, std::size_t n, Activation act) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec one = S::set1(T(1));
+    switch (act) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            transformDelta(y, delta, n, [](Vec yv, Vec dv) { return S::selectPositive(yv, dv, S::zero()); });
+            break;
+        case Activation::Sigmoid:
+            transformDelta(y, delta, n, [one](Vec yv, Vec dv) { return S::mul(dv, S::mul(yv, S::sub(one, yv))); });
+            break;
+        case Activation::Tanh:
+            transformDelta(y, delta, n, [one](Vec yv, Vec dv) { return S::mul(dv, S::sub(one, S::mul(yv, yv))); });
+            break;
+    }
+}
+
+template <typename T>
+void minMaxScaleBars(T* open, T* close, T* high, T* low, std::size_t n, T lo, T hi) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vlo = S::set1(lo);
+    const Vec vspan = S::set1(hi - lo);
+    const Vec zero = S::zero();
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec o = S::loadu(open + i);
+        const Vec c = S::loadu(close + i);
+        const Vec h = S::loadu(high + i);
+        const Vec l = S::loadu(low + i);
+        const Vec mn = S::min(S::min(o, c), S::min(h, l));
+        const Vec range = S::sub(S::max(S::max(o, c), S::max(h, l)), mn);
+        // One division per bar; a zero range gets a zero scale, which yields lo for all four prices.
+        const Vec scale = S::selectPositive(range, S::div(vspan, range), zero);
+        S::storeu(open + i, S::fmadd(S::sub(o, mn), scale, vlo));
+        S::storeu(close + i, S::fmadd(S::sub(c, mn), scale, vlo));
+        S::storeu(high + i, S::fmadd(S::sub(h, mn), scale, vlo));
+        S::storeu(low + i, S::fmadd(S::sub(l, mn), scale, vlo));
+    }
+    for (; i < n; ++i) {
+        const T mn = std::min(std::min(open[i], close[i]), std::min(high[i], low[i]));
+        const T range = std::max(std::max(open[i], close[i]), std::max(high[i], low[i])) - mn;
+        const T scale = range > T(0) ? (hi - lo) / range : T(0);
+        open[i] = lo + (open[i] - mn) * scale;
+        close[i] = lo + (close[i] - mn) * scale;
+        high[i] = lo + (high[i] - mn) * scale;
+        low[i] = lo + (low[i] - mn) * scale;
+    }
+}
+
+template <typename T>
+void scaleShift(T* x, std::size_t n, T scale, T offset) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vscale = S::set1(scale);
+    const Vec voffset = S::set1(offset);
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        S::storeu(x + i, S::fmadd(S::loadu(x + i), vscale, voffset));
+    }
+    for (; i < n; ++i) {
+        x[i] = x[i] * scale + offset;
+    }
+}
+
+template <typename T>
+void columnMinMax(const T* x, std::size_t n, T& minValue, T& maxValue) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    minValue = x[0];
+    maxValue = x[0];
+    std::size_t i = 0;
+    if (n >= S::kLanes) {
+        Vec mn = S::loadu(x);
+        Vec mx = mn;
+        for (i = S::kLanes; i + S::kLanes <= n; i += S::kLanes) {
+            const Vec v = S::loadu(x + i);
+            mn = S::min(mn, v);
+            mx = S::max(mx, v);
+        }
+        T lanes[2 * S::kLanes];
+        S::storeu(lanes, mn);
+        S::storeu(lanes + S::kLanes, mx);
+        for (std::size_t k = 0; k < S::kLanes; ++k) {
+            minValue = std::min(minValue, lanes[k]);
+            maxValue = std::max(maxValue, lanes[S::kLanes + k]);
+        }
+    }
+    for (; i < n; ++i) {
+        minValue = std::min(minValue, x[i]);
+        maxValue = std::max(maxValue, x[i]);
+    }
+}
+
+template <typename T>
+void columnMeanStd(const T* x, std::size_t n, T& mean, T& stdDev) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    Vec acc = S::zero();
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        acc = S::add(acc, S::loadu(x + i));
+    }
+    T sum = S::sum(acc);
+    for (; i < n; ++i) {
+        sum += x[i];
+    }
+    mean = sum / static_cast<T>(n);
+
+    const Vec vmean = S::set1(mean);
+    acc = S::zero();
+    for (i = 0; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec d = S::sub(S::loadu(x + i), vmean);
+        acc = S::fmadd(d, d, acc);
+    }
+    T squares = S::sum(acc);
+    for (; i < n; ++i) {
+        squares += (x[i] - mean) * (x[i] - mean);
+    }
+    stdDev = std::sqrt(squares / static_cast<T>(n));
+}
+
+// The optimizer steps read and write every buffer once, front to back; the vector loop runs over
+// whole registers and the tail repeats the same arithmetic one value at a time.
+
+template <typename T>
+void momentumStep(T* p, const T* g, T* velocity, std::size_t n, T rate, T momentum) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vrate = S::set1(-rate);
+    const Vec vmomentum = S::set1(momentum);
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec update = S::fmadd(vmomentum, S::loadu(velocity + i), S::mul(vrate, S::loadu(g + i)));
+        S::storeu(velocity + i, update);
+        S::storeu(p + i, S::add(S::loadu(p + i), update));
+    }
+    for (; i < n; ++i) {
+        const T update = -rate * g[i] + momentum * velocity[i];
+        velocity[i] = update;
+        p[i] += update;
+    }
+}
+
+template <typename T>
+void adamStep(T* p, const T* g, T* m, T* v, std::size_t n, T gradScale, T rate, T beta1, T beta2, T epsilon) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vscale = S::set1(gradScale);
+    const Vec vrate = S::set1(rate);
+    const Vec vbeta1 = S::set1(beta1);
+    const Vec vbeta2 = S::set1(beta2);
+    const Vec vgain1 = S::set1(T(1) - beta1);
+    const Vec vgain2 = S::set1(T(1) - beta2);
+    const Vec vepsilon = S::set1(epsilon);
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec grad = S::mul(S::loadu(g + i), vscale);
+        const Vec first = S::fmadd(vbeta1, S::loadu(m + i), S::mul(vgain1, grad));
+        const Vec second = S::fmadd(vbeta2, S::loadu(v + i), S::mul(vgain2, S::mul(grad, grad)));
+        S::storeu(m + i, first);
+        S::storeu(v + i, second);
+        const Vec step = S::div(S::mul(vrate, first), S::add(S::sqrt(second), vepsilon));
+        S::storeu(p + i, S::sub(S::loadu(p + i), step));
+    }
+    for (; i < n; ++i) {
+        const T grad = g[i] * gradScale;
+        m[i] = beta1 * m[i] + (T(1) - beta1) * grad;
+        v[i] = beta2 * v[i] + (T(1) - beta2) * grad * grad;
+        p[i] -= rate * m[i] / (std::sqrt(v[i]) + epsilon);
+    }
+}
+
+template <typename T>
+void rmsPropStep(T* p, const T* g, T* v, std::size_t n, T gradScale, T rate, T decay, T epsilon) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vscale = S::set1(gradScale);
+    const Vec vrate = S::set1(rate);
+    const Vec vdecay = S::set1(decay);
+    const Vec vgain = S::set1(T(1) - decay);
+    const Vec vepsilon = S::set1(epsilon);
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec grad = S::mul(S::loadu(g + i), vscale);
+        const Vec second = S::fmadd(vdecay, S::loadu(v + i), S::mul(vgain, S::mul(grad, grad)));
+        S::storeu(v + i, second);
+        const Vec step = S::div(S::mul(vrate, grad), S::add(S::sqrt(second), vepsilon));
+        S::storeu(p + i, S::sub(S::loadu(p + i), step));
+    }
+    for (; i < n; ++i) {
+        const T grad = g[i] * gradScale;
+        v[i] = decay * v[i] + (T(1) - decay) * grad * grad;
+        p[i] -= rate * grad / (std::sqrt(v[i]) + epsilon);
+    }
+}
+
+template <typename T>
+void adaGradStep(T* p, const T* g, T* v, std::size_t n, T gradScale, T rate, T epsilon) {
+    using S = Simd<T>;
+    using Vec = typename S::Vec;
+    const Vec vscale = S::set1(gradScale);
+    const Vec vrate = S::set1(rate);
+    const Vec vepsilon = S::set1(epsilon);
+    std::size_t i = 0;
+    for (; i + S::kLanes <= n; i += S::kLanes) {
+        const Vec grad = S::mul(S::loadu(g + i), vscale);
+        const Vec second = S::fmadd(grad, grad, S::loadu(v + i));
+        S::storeu(v + i, second);
+        const Vec step = S::div(S::mul(vrate, grad), S::add(S::sqrt(second), vepsilon));
+        S::storeu(p + i, S::sub(S::loadu(p + i), step));
+    }
+    for (; i < n; ++i) {
+        const T grad = g[i] * gradScale;
+        v[i] += grad * grad;
+        p[i] -= rate * grad / (std::sqrt(v[i]) + epsilon);
+    }
+}
+
+#if defined(NN_SIMD_AVX512) || defined(NN_SIMD_AVX2)
+namespace {
+
+    // x * w for 32 int8 pairs, summed into 8 int32 lanes. maddubs needs an unsigned first
+    // operand, so it is fed |x| and w * sign(x); with values in [-127, 127] the int16
+    // pair sums (at most 2 * 127 * 127) cannot saturate.
+    inline __m256i dotStepInt8(__m256i acc, __m256i absX, __m256i signX, __m256i w) {
+        const __m256i pairs = _mm256_maddubs_epi16(absX, _mm256_sign_epi8(w, signX));
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+    }
+
+    inline std::int32_t sumInt32(__m256i v) {
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(s);
+    }
+}
+
+void gemvInt8(const std::int8_t* w, std::size_t stride, const std::int8_t* x,
+              std::size_t rows, std::int32_t* y) {
+    std::size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const std::int8_t* w0 = w + r * stride;
+        const std::int8_t* w1 = w0 + stride;
+        const std::int8_t* w2 = w1 + stride;
+        const std::int8_t* w3 = w2 + stride;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (std::size_t j = 0; j < stride; j += 32) {
+            const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j));
+            const __m256i absX = _mm256_abs_epi8(xv);
+            a0 = dotStepInt8(a0, absX, xv, _mm256_load_si256(reinterpret_cast<const __m256i*>(w0 + j)));
+            a1 = dotStepInt8(a1, absX, xv, _mm256_load_si256(reinterpret_cast<const __m256i*>(w1 + j)));
+            a2 = dotStepInt8(a2, absX, xv, _mm256_load_si256(reinterpret_cast<const __m256i*>(w2 + j)));
+            a3 = dotStepInt8(a3, absX, xv, _mm256_load_si256(reinterpret_cast<const __m256i*>(w3 + j)));
+        }
+        y[r] = sumInt32(a0);
+        y[r + 1] = sumInt32(a1);
+        y[r + 2] = sumInt32(a2);
+        y[r + 3] = sumInt32(a3);
+    }
+    for (; r < rows; ++r) {
+        const std::int8_t* wr = w + r * stride;
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t j = 0; j < stride; j += 32) {
+            const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + j));
+            acc = dotStepInt8(acc, _mm256_abs_epi8(xv), xv, _mm256_load_si256(reinterpret_cast<const __m256i*>(wr + j)));
+        }
+        y[r] = sumInt32(acc);
+    }
+}
+#else
+void gemvInt8(const std::int8_t* w, std::size_t stride, const std::int8_t* x,
+              std::size_t rows, std::int32_t* y) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        const std::int8_t* wr = w + r * stride;
+        std::int32_t acc = 0;
+        for (std::size_t j = 0; j < stride; ++j) {
+            acc += std::int32_t(wr[j]) * std::int32_t(x[j]);
+        }
+        y[r] = acc;
+    }
+}
+#endif
+
+const char* simdLevel() {
+#if defined(NN_SIMD_AVX512)
+    return "avx512";
+#elif defined(NN_SIMD_AVX2)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
+
+#define NN_INSTANTIATE_KERNELS(T)                                                                        \
+    template T dot<T>(const T*, const T*, std::size_t);                                                  \
+    template void gemv<T>(const T*, std::size_t, const T*, const T*, std::size_t, std::size_t,           \
+                          T*, Activation, ActivationMode);                                               \
+    template void gemm<T>(const T*, std::size_t, std::size_t, const T*, std::size_t, const T*,           \
+                          std::size_t, std::size_t, T*, std::size_t, Activation, ActivationMode);        \
+    template void weightGradient<T>(const T*, std::size_t, std::size_t, const T*, std::size_t,           \
+                                    std::size_t, std::size_t, T*, std::size_t, T*);                      \
+    template void inputGradient<T>(const T*, std::size_t, std::size_t, const T*, std::size_t,            \
+                                   std::size_t, std::size_t, T*, std::size_t);                           \
+    template void applyActivation<T>(T*, std::size_t, Activation, ActivationMode);                        \
+    template void multiplyActivationDerivative<T>(const T*, T*, std::size_t, Activation);                 \
+    template void minMaxScaleBars<T>(T*, T*, T*, T*, std::size_t, T, T);                                  \
+    template void scaleShift<T>(T*, std::size_t, T, T);                                                   \
+    template void columnMinMax<T>(const T*, std::size_t, T&, T&);                                         \
+    template void columnMeanStd<T>(const T*, std::size_t, T&, T&);                                        \
+    template void momentumStep<T>(T*, const T*, T*, std::size_t, T, T);                                  \
+    template void adamStep<T>(T*, const T*, T*, T*, std::size_t, T, T, T, T, T);                         \
+    template void rmsPropStep<T>(T*, const T*, T*, std::size_t, T, T, T, T);                             \
+    template void adaGradStep<T>(T*, const T*, T*, std::size_t, T, T, T);
+
+NN_INSTANTIATE_KERNELS(float)
+NN_INSTANTIATE_KERNELS(double)
+
+#undef NN_INSTANTIATE_KERNELS
+
+} // namespace kernels
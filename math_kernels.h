@@ -0,0 +1,133 @@
+// math_kernels.h
+#ifndef MATH_KERNELS_H
+#define MATH_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Low-level dense kernels used by Layer and NeuralNetwork.
+// The SIMD path is selected at compile time: AVX-512F, then AVX2+FMA, otherwise a portable scalar loop.
+namespace kernels {
+
+    enum class Activation {
+        Identity,
+        ReLU,
+        Sigmoid,
+        Tanh
+    };
+
+    // Accuracy of Sigmoid and Tanh. Exact evaluates std::exp / std::tanh for every value. Fast is
+    // vectorized: tanh is a rational minimax approximation (odd degree 13 over even degree 6, clamped
+    // at |x| = 7.9053) and sigmoid(x) = (1 + tanh(x / 2)) / 2. Its absolute error is below 3e-7 for
+    // tanh and 2e-7 for sigmoid, in float and in double. Identity and ReLU are exact in both modes.
+    enum class ActivationMode {
+        Exact,
+        Fast
+    };
+
+    // Weight rows are padded to a multiple of this many bytes, so every row starts on a 64-byte boundary.
+    constexpr std::size_t kRowAlignmentBytes = 64;
+
+    template <typename T>
+    inline std::size_t paddedStride(std::size_t cols) {
+        constexpr std::size_t rowAlignment = kRowAlignmentBytes / sizeof(T);
+        return (cols + rowAlignment - 1) / rowAlignment * rowAlignment;
+    }
+
+    // All kernels are instantiated for float and double.
+
+    // Dot product of two vectors of length n.
+    template <typename T>
+    T dot(const T* a, const T* b, std::size_t n);
+
+    // y[r] = act(sum_j w[r * stride + j] * x[j] + bias[r]) for r in [0, rows).
+    // w must be 64-byte aligned and stride a paddedStride<T>() value; x and y may be unaligned.
+    template <typename T>
+    void gemv(const T* w, std::size_t stride, const T* bias,
+              const T* x, std::size_t rows, std::size_t cols,
+              T* y, Activation act, ActivationMode mode);
+
+    // Batched form of gemv: y[i * yStride + r] = act(dot(w row r, x + i * xStride) + bias[r])
+    // for n samples. Samples and weight rows are processed in cache-sized blocks, so each
+    // block of weights is loaded once per block of samples rather than once per sample.
+    template <typename T>
+    void gemm(const T* x, std::size_t n, std::size_t xStride,
+              const T* w, std::size_t wStride, const T* bias,
+              std::size_t rows, std::size_t cols,
+              T* y, std::size_t yStride, Activation act, ActivationMode mode);
+
+    // Weight gradient of a dense layer over a batch: g[r * gStride + j] += sum_i delta[i][r] * x[i][j]
+    // and gBias[r] += sum_i delta[i][r]. g must be 64-byte aligned with gStride a paddedStride<T>() value.
+    template <typename T>
+    void weightGradient(const T* delta, std::size_t n, std::size_t deltaStride,
+                        const T* x, std::size_t xStride,
+                        std::size_t rows, std::size_t cols,
+                        T* g, std::size_t gStride, T* gBias);
+
+    // Gradient with respect to the layer input: dx[i][j] = sum_r delta[i][r] * w[r * wStride + j].
+    template <typename T>
+    void inputGradient(const T* delta, std::size_t n, std::size_t deltaStride,
+                       const T* w, std::size_t wStride,
+                       std::size_t rows, std::size_t cols,
+                       T* dx, std::size_t dxStride);
+
+    // y[i] = act(y[i]) in place for i in [0, n).
+    template <typename T>
+    void applyActivation(T* y, std::size_t n, Activation act, ActivationMode mode);
+
+    // delta[i] *= act'(z[i]), with the derivative expressed through the activation output y[i] = act(z[i]).
+    // The same expression serves both modes.
+    template <typename T>
+    void multiplyActivationDerivative(const T* y, T* delta, std::size_t n, Activation act);
+
+    // Data normalization kernels. They work in place on columnar buffers of any alignment.
+
+    // Per-bar min-max scaling of OHLC columns: the four prices of bar i are mapped from their own
+    // [min, max] onto [lo, hi]. A bar whose four prices are equal maps to lo.
+    template <typename T>
+    void minMaxScaleBars(T* open, T* close, T* high, T* low, std::size_t n, T lo, T hi);
+
+    // x[i] = x[i] * scale + offset, e.g. z-scoring with scale = 1 / std and offset = -mean / std.
+    template <typename T>
+    void scaleShift(T* x, std::size_t n, T scale, T offset);
+
+    // Minimum and maximum of x[0..n); n must be greater than zero.
+    template <typename T>
+    void columnMinMax(const T* x, std::size_t n, T& minValue, T& maxValue);
+
+    // Mean and population standard deviation of x[0..n) (two passes); n must be greater than zero.
+    template <typename T>
+    void columnMeanStd(const T* x, std::size_t n, T& mean, T& stdDev);
+
+    // Fused optimizer updates over n parameters p with gradient g and per-parameter state of the same
+    // length: one pass over all buffers, any alignment. gradScale multiplies the raw gradient (e.g.
+    // 1 / batch size); rate is the step size, for Adam with its bias correction already folded in.
+
+    // velocity = momentum * velocity - rate * g; p += velocity. The gradient scale is folded into rate.
+    template <typename T>
+    void momentumStep(T* p, const T* g, T* velocity, std::size_t n, T rate, T momentum);
+
+    // m = beta1 * m + (1 - beta1) * g; v = beta2 * v + (1 - beta2) * g^2; p -= rate * m / (sqrt(v) + epsilon).
+    template <typename T>
+    void adamStep(T* p, const T* g, T* m, T* v, std::size_t n, T gradScale, T rate, T beta1, T beta2, T epsilon);
+
+    // v = decay * v + (1 - decay) * g^2; p -= rate * g / (sqrt(v) + epsilon).
+    template <typename T>
+    void rmsPropStep(T* p, const T* g, T* v, std::size_t n, T gradScale, T rate, T decay, T epsilon);
+
+    // v += g^2; p -= rate * g / (sqrt(v) + epsilon).
+    template <typename T>
+    void adaGradStep(T* p, const T* g, T* v, std::size_t n, T gradScale, T rate, T epsilon);
+
+    // Integer matrix-vector product for int8 inference: y[r] = sum_j w[r * stride + j] * x[j], accumulated in int32.
+    // stride must be a paddedStride<std::int8_t>() value and w 64-byte aligned. Rows of w and x are read up to
+    // stride, so their padding must be zero. Values must lie in [-127, 127].
+    void gemvInt8(const std::int8_t* w, std::size_t stride, const std::int8_t* x,
+                  std::size_t rows, std::int32_t* y);
+
+    // Name of the instruction set the kernels were compiled for ("avx512", "avx2" or "scalar").
+    const char* simdLevel();
+
+} // namespace kernels
+
+#endif // MATH_KERNELS_H
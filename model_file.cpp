@@ -0,0 +1,279 @@
+// model_file.cpp
+#include "model_file.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace model_file {
+
+namespace {
+
+    size_t alignUp(size_t bytes) {
+        return (bytes + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+    }
+
+    void writePadding(std::ostream& out, size_t written) {
+        static const char zeros[kBlockAlignment] = {};
+        out.write(zeros, static_cast<std::streamsize>(alignUp(written) - written));
+    }
+
+    // Throws unless [offset, offset + bytes) lies inside a file of fileSize bytes.
+    void checkRange(std::uint64_t offset, std::uint64_t bytes, size_t fileSize) {
+        if (offset > fileSize || bytes > fileSize - offset) {
+            throw std::runtime_error("Model file is truncated or corrupt.");
+        }
+    }
+
+    template <typename T>
+    T readScalar(const unsigned char* block, size_t index, size_t scalarSize) {
+        if (scalarSize == sizeof(float)) {
+            float value;
+            std::memcpy(&value, block + index * sizeof(float), sizeof(float));
+            return static_cast<T>(value);
+        }
+        double value;
+        std::memcpy(&value, block + index * sizeof(double), sizeof(double));
+        return static_cast<T>(value);
+    }
+
+    // Copies a block laid out like a parameter block (rows sourceStride values apart, then the biases)
+    // in the file's scalar type into dest, laid out as LayerT<T> keeps it.
+    template <typename T>
+    void readBlock(const unsigned char* block, size_t numInputs, size_t numOutputs, size_t sourceStride,
+                   size_t scalarSize, T* dest) {
+        const size_t stride = kernels::paddedStride<T>(numInputs);
+        for (size_t r = 0; r < numOutputs; ++r) {
+            for (size_t j = 0; j < numInputs; ++j) {
+                dest[r * stride + j] = readScalar<T>(block, r * sourceStride + j, scalarSize);
+            }
+            dest[numOutputs * stride + r] = readScalar<T>(block, numOutputs * sourceStride + r, scalarSize);
+        }
+    }
+}
+
+template <typename T>
+void saveBinary(std::ostream& out, const NeuralNetworkT<T>& network,
+                const DataNormalization& normalization, const std::string& modelVersion) {
+    const auto& layers = network.getLayers();
+    if (layers.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before saving.");
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    const OptimizerT<T>& optimizer = network.getOptimizer();
+    const bool hasOptimizerState = optimizer.hasState() && optimizer.getLayerCount() == layers.size();
+    header.formatVersion = hasOptimizerState ? kFormatVersion : 1;
+    header.scalarSize = static_cast<std::uint16_t>(sizeof(T));
+    header.rowAlignment = static_cast<std::uint16_t>(kernels::kRowAlignmentBytes);
+    header.normalizationType = static_cast<std::uint32_t>(normalization.getNormalizationType());
+    header.versionLength = static_cast<std::uint32_t>(modelVersion.size());
+    header.numInputs = network.getNumInputs();
+    header.numLayers = layers.size();
+    if (normalization.getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
+        header.normalizationParams[0] = normalization.getMinRange();
+        header.normalizationParams[1] = normalization.getMaxRange();
+    } else {
+        header.normalizationParams[0] = normalization.getMean();
+        header.normalizationParams[1] = normalization.getStd();
+    }
+
+    std::vector<LayerRecord> records(layers.size());
+    size_t offset = sizeof(FileHeader) + alignUp(modelVersion.size()) + alignUp(records.size() * sizeof(LayerRecord));
+    for (size_t i = 0; i < layers.size(); ++i) {
+        records[i] = {};
+        records[i].numInputs = layers[i].getInputSize();
+        records[i].numOutputs = layers[i].getOutputSize();
+        records[i].offset = offset;
+        records[i].activationType = static_cast<std::uint32_t>(layers[i].getActivationFunction());
+        const size_t count = layers[i].getOutputSize() * layers[i].getWeightStride() + layers[i].getOutputSize();
+        offset += alignUp(count * sizeof(T));
+    }
+    OptimizerRecord optimizerRecord = {};
+    if (hasOptimizerState) {
+        const OptimizerConfig& config = optimizer.getConfig();
+        std::memcpy(optimizerRecord.magic, kOptimizerMagic, sizeof(kOptimizerMagic));
+        optimizerRecord.type = static_cast<std::uint32_t>(config.type);
+        optimizerRecord.stateCount = static_cast<std::uint32_t>(config.getStateCount());
+        optimizerRecord.stepCount = optimizer.getStepCount();
+        optimizerRecord.momentum = config.momentum;
+        optimizerRecord.beta1 = config.beta1;
+        optimizerRecord.beta2 = config.beta2;
+        optimizerRecord.decay = config.decay;
+        optimizerRecord.epsilon = config.epsilon;
+        offset += sizeof(OptimizerRecord);
+        for (size_t slot = 0; slot < config.getStateCount(); ++slot) {
+            for (size_t i = 0; i < layers.size(); ++i) {
+                offset += alignUp(optimizer.getStateSize(i) * sizeof(T));
+            }
+        }
+    }
+    std::string stats;
+    if (normalization.hasOnlineStats()) {
+        std::ostringstream statsStream;
+        normalization.saveStats(statsStream);
+        stats = statsStream.str();
+    }
+    header.fileSize = offset + stats.size();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(modelVersion.data(), static_cast<std::streamsize>(modelVersion.size()));
+    writePadding(out, modelVersion.size());
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(LayerRecord)));
+    writePadding(out, records.size() * sizeof(LayerRecord));
+
+    // Weights and biases are contiguous in the layer, so each block is a single write.
+    for (const auto& layer : layers) {
+        const size_t bytes = (layer.getOutputSize() * layer.getWeightStride() + layer.getOutputSize()) * sizeof(T);
+        out.write(reinterpret_cast<const char*>(layer.getWeightData()), static_cast<std::streamsize>(bytes));
+        writePadding(out, bytes);
+    }
+    if (hasOptimizerState) {
+        out.write(reinterpret_cast<const char*>(&optimizerRecord), sizeof(optimizerRecord));
+        for (size_t slot = 0; slot < optimizerRecord.stateCount; ++slot) {
+            for (size_t i = 0; i < layers.size(); ++i) {
+                const size_t bytes = optimizer.getStateSize(i) * sizeof(T);
+                out.write(reinterpret_cast<const char*>(optimizer.getState(slot, i)), static_cast<std::streamsize>(bytes));
+                writePadding(out, bytes);
+            }
+        }
+    }
+    out.write(stats.data(), static_cast<std::streamsize>(stats.size()));
+
+    if (!out) {
+        throw std::runtime_error("Could not write model file.");
+    }
+}
+
+template <typename T>
+NeuralNetworkT<T> loadBinary(const std::string& path, DataNormalization& normalization, std::string& modelVersion) {
+    auto file = std::make_shared<MappedFile>(path);
+    unsigned char* base = file->data();
+    const size_t fileSize = file->size();
+
+    FileHeader header;
+    checkRange(0, sizeof(header), fileSize);
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a binary model file: " + path);
+    }
+    if (header.formatVersion < 1 || header.formatVersion > kFormatVersion) {
+        throw std::runtime_error("Unsupported model file version " + std::to_string(header.formatVersion) + ".");
+    }
+    if ((header.scalarSize != sizeof(float) && header.scalarSize != sizeof(double)) ||
+        header.rowAlignment == 0 || header.rowAlignment % header.scalarSize != 0 ||
+        header.fileSize != fileSize || header.numLayers == 0 ||
+        header.normalizationType > static_cast<std::uint32_t>(DataNormalization::NormalizationType::ZScore)) {
+        throw std::runtime_error("Model file is truncated or corrupt.");
+    }
+
+    checkRange(sizeof(FileHeader), header.versionLength, fileSize);
+    modelVersion.assign(reinterpret_cast<const char*>(base + sizeof(FileHeader)), header.versionLength);
+
+    normalization = DataNormalization(static_cast<DataNormalization::NormalizationType>(header.normalizationType));
+    if (normalization.getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
+        normalization.setMinMaxRange(header.normalizationParams[0], header.normalizationParams[1]);
+    } else {
+        normalization.setMeanStd(header.normalizationParams[0], header.normalizationParams[1]);
+    }
+
+    const size_t recordsOffset = sizeof(FileHeader) + alignUp(header.versionLength);
+    if (header.numLayers > fileSize / sizeof(LayerRecord)) {
+        throw std::runtime_error("Model file is truncated or corrupt.");
+    }
+    checkRange(recordsOffset, header.numLayers * sizeof(LayerRecord), fileSize);
+
+    // Blocks can be used in place only if they already have the layout LayerT<T> expects.
+    const bool inPlace = header.scalarSize == sizeof(T) && header.rowAlignment == kernels::kRowAlignmentBytes;
+    const size_t rowAlignment = header.rowAlignment / header.scalarSize;
+
+    NeuralNetworkT<T> network(header.numInputs, 0);
+    size_t expectedInputs = header.numInputs;
+    size_t blocksEnd = recordsOffset + alignUp(header.numLayers * sizeof(LayerRecord));
+    for (size_t i = 0; i < header.numLayers; ++i) {
+        LayerRecord record;
+        std::memcpy(&record, base + recordsOffset + i * sizeof(LayerRecord), sizeof(record));
+        if (record.numInputs != expectedInputs || record.numOutputs == 0 || record.offset % kBlockAlignment != 0 ||
+            record.activationType > static_cast<std::uint32_t>(ActivationType::None) ||
+            record.numInputs > fileSize || record.numOutputs > fileSize) {
+            throw std::runtime_error("Model file is truncated or corrupt.");
+        }
+        const size_t numInputs = record.numInputs;
+        const size_t numOutputs = record.numOutputs;
+        const ActivationType activationType = static_cast<ActivationType>(record.activationType);
+        const size_t sourceStride = (numInputs + rowAlignment - 1) / rowAlignment * rowAlignment;
+        const size_t count = numOutputs * sourceStride + numOutputs;
+        checkRange(record.offset, count * header.scalarSize, fileSize);
+        blocksEnd = std::max<size_t>(blocksEnd, record.offset + alignUp(count * header.scalarSize));
+        unsigned char* block = base + record.offset;
+
+        if (inPlace) {
+            ParameterBuffer<T> params(reinterpret_cast<T*>(block), count, file);
+            network.addLayer(LayerT<T>(numInputs, numOutputs, activationType, std::move(params)));
+        } else {
+            const size_t stride = kernels::paddedStride<T>(numInputs);
+            ParameterBuffer<T> params(numOutputs * stride + numOutputs);
+            readBlock(block, numInputs, numOutputs, sourceStride, header.scalarSize, params.data());
+            network.addLayer(LayerT<T>(numInputs, numOutputs, activationType, std::move(params)));
+        }
+        expectedInputs = numOutputs;
+    }
+
+    if (header.formatVersion >= 2) {
+        // The state is always copied: training writes to it, while the parameters may stay mapped.
+        OptimizerRecord record;
+        checkRange(blocksEnd, sizeof(record), fileSize);
+        std::memcpy(&record, base + blocksEnd, sizeof(record));
+        OptimizerConfig config;
+        config.type = static_cast<OptimizerType>(record.type);
+        config.momentum = record.momentum;
+        config.beta1 = record.beta1;
+        config.beta2 = record.beta2;
+        config.decay = record.decay;
+        config.epsilon = record.epsilon;
+        if (std::memcmp(record.magic, kOptimizerMagic, sizeof(kOptimizerMagic)) != 0 ||
+            record.type > static_cast<std::uint32_t>(OptimizerType::AdaGrad) || record.stateCount != config.getStateCount()) {
+            throw std::runtime_error("Model file is truncated or corrupt.");
+        }
+        OptimizerT<T>& optimizer = network.getOptimizer();
+        optimizer.setConfig(config);
+        optimizer.reserve(network.getLayers());
+        optimizer.setStepCount(record.stepCount);
+        blocksEnd += sizeof(record);
+        for (size_t slot = 0; slot < record.stateCount; ++slot) {
+            for (size_t i = 0; i < network.getLayers().size(); ++i) {
+                const LayerT<T>& layer = network.getLayers()[i];
+                const size_t sourceStride = (layer.getInputSize() + rowAlignment - 1) / rowAlignment * rowAlignment;
+                const size_t count = layer.getOutputSize() * sourceStride + layer.getOutputSize();
+                checkRange(blocksEnd, count * header.scalarSize, fileSize);
+                readBlock(base + blocksEnd, layer.getInputSize(), layer.getOutputSize(), sourceStride, header.scalarSize,
+                          optimizer.getState(slot, i));
+                blocksEnd += alignUp(count * header.scalarSize);
+            }
+        }
+    }
+
+    if (blocksEnd < fileSize) {
+        std::istringstream stats(std::string(reinterpret_cast<const char*>(base + blocksEnd), fileSize - blocksEnd));
+        normalization.loadStats(stats);
+    }
+    return network;
+}
+
+bool isBinaryModel(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(kMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == static_cast<std::streamsize>(sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+template void saveBinary<float>(std::ostream&, const NeuralNetworkT<float>&, const DataNormalization&, const std::string&);
+template void saveBinary<double>(std::ostream&, const NeuralNetworkT<double>&, const DataNormalization&, const std::string&);
+template NeuralNetworkT<float> loadBinary<float>(const std::string&, DataNormalization&, std::string&);
+template NeuralNetworkT<double> loadBinary<double>(const std::string&, DataNormalization&, std::string&);
+
+} // namespace model_file
@@ -0,0 +1,90 @@
+// model_file.h
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <stdexcept>
+#include "neural_network.h"
+#include "data_normalization.h"
+
+// Versioned binary model file, laid out so that it can be memory-mapped and used without parsing:
+//
+//   FileHeader                 64 bytes
+//   model version string       header.versionLength bytes, zero-padded to a multiple of 64
+//   LayerRecord[numLayers]     32 bytes each, zero-padded to a multiple of 64
+//   parameter blocks           one per layer at LayerRecord::offset (64-byte aligned), stored exactly
+//                              as LayerT keeps them in memory: padded weight rows, then the biases
+//   optimizer state            version 2 only, right after the last parameter block: an OptimizerRecord,
+//                              then for each state buffer and each layer a block laid out like that
+//                              layer's parameter block (64-byte aligned)
+//   normalization statistics   optional, from the end of the last block to fileSize: the online
+//                              statistics as written by DataNormalization::saveStats
+//
+// A network with optimizer state (one that has been trained) is written as version 2, so training
+// can resume from the file; otherwise as version 1, which readers of either version accept.
+//
+// All fields are little-endian. A file whose scalar size and row alignment match the loading
+// network is used in place: the layers view the mapped blocks, so loading costs a few page faults
+// and processes loading the same file share its pages. Other files are converted while loading.
+namespace model_file {
+
+    constexpr char kMagic[8] = {'N', 'N', 'M', 'O', 'D', 'E', 'L', '\0'};
+    constexpr std::uint32_t kFormatVersion = 2;
+    constexpr char kOptimizerMagic[8] = {'N', 'N', 'O', 'P', 'T', 'I', 'M', '\0'};
+    constexpr std::size_t kBlockAlignment = 64;
+
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint16_t scalarSize;        // 4 (float) or 8 (double)
+        std::uint16_t rowAlignment;      // bytes each weight row is padded to (kernels::kRowAlignmentBytes)
+        std::uint32_t normalizationType; // DataNormalization::NormalizationType
+        std::uint32_t versionLength;
+        std::uint64_t numInputs;
+        std::uint64_t numLayers;
+        double normalizationParams[2];   // min/max range for MinMax, mean/std for ZScore
+        std::uint64_t fileSize;
+    };
+    static_assert(sizeof(FileHeader) == 64, "FileHeader must stay 64 bytes");
+
+    struct LayerRecord {
+        std::uint64_t numInputs;
+        std::uint64_t numOutputs;
+        std::uint64_t offset; // of the parameter block from the start of the file
+        std::uint32_t activationType;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(LayerRecord) == 32, "LayerRecord must stay 32 bytes");
+
+    struct OptimizerRecord {
+        char magic[8];
+        std::uint32_t type;       // OptimizerType
+        std::uint32_t stateCount; // state buffers per layer
+        std::uint64_t stepCount;
+        double momentum;
+        double beta1;
+        double beta2;
+        double decay;
+        double epsilon;
+    };
+    static_assert(sizeof(OptimizerRecord) == 64, "OptimizerRecord must stay 64 bytes");
+
+    // Writes network (with its optimizer state, if any), normalization parameters (with online statistics,
+    // if enabled) and model version. out must be opened in binary mode.
+    template <typename T>
+    void saveBinary(std::ostream& out, const NeuralNetworkT<T>& network,
+                    const DataNormalization& normalization, const std::string& modelVersion);
+
+    // Maps the file at path and returns the network stored in it, with its optimizer state; normalization
+    // and modelVersion are filled in from the file. Throws std::runtime_error on a malformed or unsupported file.
+    template <typename T>
+    NeuralNetworkT<T> loadBinary(const std::string& path, DataNormalization& normalization, std::string& modelVersion);
+
+    // True if the file at path starts with the binary model magic.
+    bool isBinaryModel(const std::string& path);
+
+} // namespace model_file
+
+#endif // MODEL_FILE_H
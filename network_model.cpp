@@ -0,0 +1,443 @@
+// network_model.cpp
+#include "network_model.h"
+#include "model_file.h"
+#include <fstream>
+
+NetworkModel::NetworkModel() : snapshot_(std::make_shared<const Snapshot>()) {}
+
+NetworkModel::~NetworkModel() {
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    if (pendingLoad_.valid()) {
+        pendingLoad_.wait();
+    }
+}
+
+void NetworkModel::requireInitialized(const Snapshot& snapshot) {
+    if (!snapshot.network || !snapshot.normalization) {
+        throw std::runtime_error("Network not initialized.");
+    }
+}
+
+void NetworkModel::applyWindowConfig(const Snapshot& snapshot, InterfaceFunction& interface) {
+    if (snapshot.useWindows) {
+        interface.setWindowConfig(snapshot.windowConfig);
+    } else {
+        interface.clearWindowConfig();
+    }
+}
+
+void NetworkModel::publish(Snapshot next, bool resetStream) {
+    ++next.version;
+    if (resetStream) {
+        ++next.streamGeneration;
+    }
+    snapshot_.publish(std::make_shared<const Snapshot>(std::move(next)));
+}
+
+DataNormalization NetworkModel::currentNormalization(const Snapshot& snapshot) const {
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    if (streamInterface_ && streamSnapshot_ && streamSnapshot_->streamGeneration == snapshot.streamGeneration) {
+        return streamInterface_->getDataNormalization();
+    }
+    return *snapshot.normalization;
+}
+
+void NetworkModel::initialize(size_t numInputs, size_t numOutputs, DataNormalization::NormalizationType normalizationType,
+                              const std::string& modelVersion) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    auto network = std::make_shared<NeuralNetwork>(numInputs, numOutputs);
+    network->setActivationMode(activationMode_);
+    next.network = std::move(network);
+    next.normalization = std::make_shared<const DataNormalization>(normalizationType);
+    next.quantizedNetwork.reset();
+    next.inferencePlan.reset();
+    next.modelVersion = modelVersion;
+    ++next.indicatorGeneration;
+    publish(std::move(next), true);
+}
+
+bool NetworkModel::isInitialized() const {
+    auto snapshot = snapshot_.pin();
+    return snapshot->network && snapshot->normalization;
+}
+
+std::uint64_t NetworkModel::getVersion() const {
+    return snapshot_.pin()->version;
+}
+
+void NetworkModel::addLayer(size_t numOutputs, ActivationType activationType) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto network = std::make_shared<NeuralNetwork>(*next.network);
+    network->addLayer(numOutputs, activationType);
+    next.network = std::move(network);
+    next.quantizedNetwork.reset();
+    next.inferencePlan.reset();
+    publish(std::move(next), false);
+}
+
+void NetworkModel::setTrainingBatchSize(size_t batchSize) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto network = std::make_shared<NeuralNetwork>(*next.network);
+    network->setBatchSize(batchSize);
+    next.network = std::move(network);
+    publish(std::move(next), false);
+}
+
+std::vector<double> NetworkModel::processData(const std::vector<BarData>& barData,
+                                              const std::map<std::string, std::vector<double>>& indicatorData,
+                                              bool useIndicators, bool isTraining) {
+    if (!isTraining) {
+        // A reference rather than a pin: a long history must not hold back the next version.
+        const std::shared_ptr<const Snapshot> snapshot = snapshot_.acquire();
+        requireInitialized(*snapshot);
+
+        InterfaceFunction interface(*snapshot->network);
+        interface.getDataNormalization() = *snapshot->normalization;
+        interface.setIndicatorSchema(snapshot->indicatorSchema);
+        applyWindowConfig(*snapshot, interface);
+        interface.setQuantizedNetwork(snapshot->quantizedNetwork.get());
+        interface.setInferencePlan(snapshot->inferencePlan.get());
+        return interface.processData(barData, indicatorData, useIndicators);
+    }
+
+    // Training runs on a copy while inference continues on the current version.
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto network = std::make_shared<NeuralNetwork>(*next.network);
+    InterfaceFunction interface(*network);
+    interface.getDataNormalization() = *next.normalization;
+    interface.setTrainingMode(true);
+    interface.setIndicatorSchema(next.indicatorSchema);
+    interface.setLearningRate(learningRate_);
+    applyWindowConfig(next, interface);
+    std::vector<double> result = interface.processData(barData, indicatorData, useIndicators);
+
+    // A calibrated int8 copy or a compiled plan of the old weights would be stale.
+    next.network = std::move(network);
+    next.quantizedNetwork.reset();
+    next.inferencePlan.reset();
+    // Online statistics now hold the history the network was trained on; onBar and save continue
+    // from them rather than from the statistics before training.
+    const bool onlineStats = interface.getDataNormalization().hasOnlineStats();
+    if (onlineStats) {
+        next.normalization = std::make_shared<DataNormalization>(interface.getDataNormalization());
+    }
+    publish(std::move(next), onlineStats);
+    return result;
+}
+
+double NetworkModel::onBar(const BarData& bar, const double* indicators) {
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    auto snapshot = snapshot_.pin();
+    requireInitialized(*snapshot);
+
+    if (streamSnapshot_.get() != snapshot.get()) {
+        // A new version: start over if it changed the inputs, else carry the stream state over.
+        const bool restart = !streamInterface_ || streamSnapshot_->streamGeneration != snapshot->streamGeneration;
+        if (streamSnapshot_ && streamSnapshot_->indicatorGeneration != snapshot->indicatorGeneration) {
+            indicatorEngine_.reset();
+        }
+        if (restart) {
+            streamInterface_ = std::make_unique<InterfaceFunction>(*snapshot->network);
+            streamInterface_->getDataNormalization() = *snapshot->normalization;
+            applyWindowConfig(*snapshot, *streamInterface_);
+        } else {
+            streamInterface_->setNeuralNetwork(*snapshot->network);
+        }
+        streamInterface_->setIndicatorSchema(snapshot->indicatorSchema);
+        streamSnapshot_ = snapshot.shared();
+    }
+    if (!indicators && indicatorEngine_.getIndicatorCount() > 0) {
+        indicatorValues_.resize(indicatorEngine_.getIndicatorCount());
+        indicatorEngine_.update(bar, indicatorValues_.data());
+        indicators = indicatorValues_.data();
+    }
+    streamInterface_->setQuantizedNetwork(snapshot->quantizedNetwork.get());
+    streamInterface_->setInferencePlan(snapshot->inferencePlan.get());
+    return streamInterface_->onBar(bar, indicators);
+}
+
+void NetworkModel::setIndicatorSchema(const std::vector<std::string>& names) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    next.indicatorSchema = IndicatorSchema(names);
+    publish(std::move(next), false);
+}
+
+void NetworkModel::addBuiltInIndicator(const std::string& name, const IndicatorEngine::IndicatorSpec& spec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // onBar waits until the schema that matches the engine is published.
+    std::lock_guard<std::mutex> streamLock(streamMutex_);
+    Snapshot next = *snapshot_.acquire();
+    indicatorEngine_.addIndicator(name, spec);
+    next.indicatorSchema = indicatorEngine_.getSchema();
+    publish(std::move(next), false);
+}
+
+void NetworkModel::setLaggedWindow(const WindowConfig& config) {
+    config.validate();
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    next.windowConfig = config;
+    next.useWindows = true;
+    next.quantizedNetwork.reset();
+    next.inferencePlan.reset();
+    publish(std::move(next), true); // the next onBar starts a new window
+}
+
+void NetworkModel::clearLaggedWindow() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    next.windowConfig = WindowConfig();
+    next.useWindows = false;
+    next.inferencePlan.reset();
+    publish(std::move(next), true);
+}
+
+QuantizedNetwork::CalibrationReport NetworkModel::enableQuantizedInference(const std::vector<BarData>& calibrationBars,
+                                                                           const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                           bool useIndicators) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    try {
+        requireInitialized(next);
+
+        InterfaceFunction interface(*next.network);
+        interface.getDataNormalization() = *next.normalization;
+        interface.setIndicatorSchema(next.indicatorSchema);
+        applyWindowConfig(next, interface);
+        std::vector<double> calibrationInputs = interface.createInputMatrix(calibrationBars, indicatorData, useIndicators);
+        size_t numSamples = calibrationBars.size();
+        if (next.useWindows && next.windowConfig.lookback > 1) {
+            // Calibrate on the windows themselves: rows of lookback consecutive bars.
+            const size_t lookback = next.windowConfig.lookback;
+            const size_t numInputs = next.network->getNumInputs();
+            const size_t numFeatures = numInputs / lookback;
+            numSamples = numSamples >= lookback ? numSamples - lookback + 1 : 0;
+            std::vector<double> windows(numSamples * numInputs);
+            for (size_t i = 0; i < numSamples; ++i) {
+                std::copy(calibrationInputs.begin() + i * numFeatures, calibrationInputs.begin() + i * numFeatures + numInputs,
+                          windows.begin() + i * numInputs);
+            }
+            calibrationInputs = std::move(windows);
+        }
+        auto quantizedNetwork = std::make_shared<const QuantizedNetwork>(*next.network, calibrationInputs, numSamples);
+        const QuantizedNetwork::CalibrationReport report = quantizedNetwork->getCalibrationReport();
+        next.quantizedNetwork = std::move(quantizedNetwork);
+        publish(std::move(next), false);
+        return report;
+    } catch (...) {
+        if (next.quantizedNetwork) {
+            next.quantizedNetwork.reset();
+            publish(std::move(next), false);
+        }
+        throw;
+    }
+}
+
+void NetworkModel::disableQuantizedInference() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    next.quantizedNetwork.reset();
+    publish(std::move(next), false);
+}
+
+std::shared_ptr<const InferencePlan> NetworkModel::optimizeForInference() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    try {
+        requireInitialized(next);
+        const size_t lookback = next.useWindows ? next.windowConfig.lookback : 1;
+        auto plan = std::make_shared<const InferencePlan>(*next.network, *next.normalization, lookback);
+        next.inferencePlan = plan;
+        publish(std::move(next), false);
+        return plan;
+    } catch (...) {
+        if (next.inferencePlan) {
+            next.inferencePlan.reset();
+            publish(std::move(next), false);
+        }
+        throw;
+    }
+}
+
+void NetworkModel::disableOptimizedInference() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    next.inferencePlan.reset();
+    publish(std::move(next), false);
+}
+
+void NetworkModel::enableOnlineNormalization(const RunningStats& prototype) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto normalization = std::make_shared<DataNormalization>(*next.normalization);
+    normalization->enableOnlineStats(prototype);
+    next.normalization = std::move(normalization);
+    next.inferencePlan.reset(); // compiled with the previous normalization
+    publish(std::move(next), true); // the next onBar starts from the new statistics
+}
+
+void NetworkModel::disableOnlineNormalization() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto normalization = std::make_shared<DataNormalization>(*next.normalization);
+    normalization->disableOnlineStats();
+    next.normalization = std::move(normalization);
+    next.inferencePlan.reset();
+    publish(std::move(next), true);
+}
+
+void NetworkModel::setOptimizer(const OptimizerConfig& config, double learningRate) {
+    if (!(learningRate > 0.0)) {
+        throw std::invalid_argument("Learning rate must be positive.");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    requireInitialized(next);
+    auto network = std::make_shared<NeuralNetwork>(*next.network);
+    network->setOptimizer(config);
+    next.network = std::move(network);
+    learningRate_ = learningRate;
+    publish(std::move(next), false);
+}
+
+void NetworkModel::setActivationMode(kernels::ActivationMode mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    activationMode_ = mode;
+    if (next.network) {
+        auto network = std::make_shared<NeuralNetwork>(*next.network);
+        network->setActivationMode(mode);
+        next.network = std::move(network);
+    }
+    next.quantizedNetwork.reset(); // calibrated with the previous mode
+    next.inferencePlan.reset();
+    publish(std::move(next), false);
+}
+
+void NetworkModel::save(const std::string& filename) const {
+    const std::shared_ptr<const Snapshot> snapshot = snapshot_.acquire();
+    requireInitialized(*snapshot);
+
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file to save model.");
+    }
+
+    // 1. Save Model Version
+    file << snapshot->modelVersion << "\n";
+
+    // 2. Save Normalization Type
+    const DataNormalization normalization = currentNormalization(*snapshot);
+    file << static_cast<int>(normalization.getNormalizationType()) << "\n";
+
+    if (normalization.getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
+        file << normalization.getMinRange() << " " << normalization.getMaxRange() << "\n";
+    } else if (normalization.getNormalizationType() == DataNormalization::NormalizationType::ZScore) {
+        file << normalization.getMean() << " " << normalization.getStd() << "\n";
+    }
+    if (normalization.hasOnlineStats()) {
+        file << "stats\n";
+        normalization.saveStats(file);
+    }
+
+    // 3. Save Neural Network
+    snapshot->network->saveModel(file);
+}
+
+void NetworkModel::saveBinary(const std::string& filename) const {
+    const std::shared_ptr<const Snapshot> snapshot = snapshot_.acquire();
+    requireInitialized(*snapshot);
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file to save model.");
+    }
+    model_file::saveBinary(file, *snapshot->network, currentNormalization(*snapshot), snapshot->modelVersion);
+}
+
+void NetworkModel::load(const std::string& filename) {
+    std::shared_ptr<NeuralNetwork> network;
+    std::shared_ptr<DataNormalization> normalization;
+    std::string modelVersion;
+
+    // The file is read without any lock; inference and other writers go on meanwhile.
+    if (model_file::isBinaryModel(filename)) {
+        normalization = std::make_shared<DataNormalization>();
+        network = std::make_shared<NeuralNetwork>(model_file::loadBinary<double>(filename, *normalization, modelVersion));
+    } else {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open file to load model.");
+        }
+
+        // 1. Load Model Version
+        std::getline(file, modelVersion);
+
+        // 2. Load Normalization Type
+        int normalizationTypeInt;
+        file >> normalizationTypeInt;
+        normalization = std::make_shared<DataNormalization>(static_cast<DataNormalization::NormalizationType>(normalizationTypeInt));
+
+        if (normalization->getNormalizationType() == DataNormalization::NormalizationType::MinMax) {
+            double min, max;
+            file >> min >> max;
+            normalization->setMinMaxRange(min, max);
+        } else if (normalization->getNormalizationType() == DataNormalization::NormalizationType::ZScore) {
+            double mean, std;
+            file >> mean >> std;
+            normalization->setMeanStd(mean, std);
+        }
+
+        // Online statistics, present only if they were enabled when the model was saved
+        file >> std::ws;
+        if (file.peek() == 's') {
+            std::string tag;
+            file >> tag;
+            normalization->loadStats(file);
+        }
+
+        // 3. Load Neural Network
+        network = std::make_shared<NeuralNetwork>();
+        network->loadModel(file);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot next = *snapshot_.acquire();
+    network->setActivationMode(activationMode_);
+    next.network = std::move(network);
+    next.normalization = std::move(normalization);
+    next.modelVersion = modelVersion;
+    next.quantizedNetwork.reset();
+    next.inferencePlan.reset();
+    ++next.indicatorGeneration;
+    publish(std::move(next), true);
+}
+
+void NetworkModel::loadAsync(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(loadMutex_);
+    if (pendingLoad_.valid()) {
+        pendingLoad_.wait();
+    }
+    pendingLoad_ = std::async(std::launch::async, [this, filename] { load(filename); });
+}
+
+void NetworkModel::waitForLoad() {
+    std::future<void> pendingLoad;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        pendingLoad = std::move(pendingLoad_);
+    }
+    if (pendingLoad.valid()) {
+        pendingLoad.get();
+    }
+}
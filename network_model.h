@@ -0,0 +1,140 @@
+// network_model.h
+#ifndef NETWORK_MODEL_H
+#define NETWORK_MODEL_H
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "data_storage.h"
+#include "neural_network.h"
+#include "data_normalization.h"
+#include "quantized_network.h"
+#include "inference_plan.h"
+#include "interface_function.h"
+#include "indicator_engine.h"
+#include "indicator_schema.h"
+#include "lagged_window.h"
+#include "snapshot_cell.h"
+
+// Everything one model needs between calls: the network and its normalization, the int8 copy or
+// compiled plan used for inference, the indicator schema and built-in indicators, the window config,
+// the training settings and the onBar state. The DLL exports operate on NetworkModel objects; the
+// legacy exports on one default instance, the handle exports on instances of their own.
+//
+// What inference reads lives in an immutable Snapshot published through a SnapshotCell. Inference
+// (processData without training) pins the current snapshot and takes no lock, so it never waits for
+// a load, a training pass or a settings change; those build a new snapshot from a copy of what they
+// change, under a writer mutex, publish it atomically and return once no reader can still reach the
+// old one. A running inference call finishes on the version it started with. onBar additionally
+// serializes its callers on the model's stream state (normalization statistics, window, built-in
+// indicators) and moves that state over to a new version without resetting it, unless the change
+// was a new network, normalization or window, as before.
+//
+// Different models share nothing and run fully in parallel. Methods throw on error
+// (std::invalid_argument for bad arguments, std::runtime_error otherwise) and leave the model as it
+// was, except where noted.
+class NetworkModel {
+public:
+    NetworkModel();
+    ~NetworkModel();
+    NetworkModel(const NetworkModel&) = delete;
+    NetworkModel& operator=(const NetworkModel&) = delete;
+
+    // Creates an empty network and normalization; the indicator schema, window config, learning
+    // rate and activation mode are kept.
+    void initialize(size_t numInputs, size_t numOutputs, DataNormalization::NormalizationType normalizationType,
+                    const std::string& modelVersion);
+    bool isInitialized() const;
+
+    void addLayer(size_t numOutputs, ActivationType activationType);
+    void setTrainingBatchSize(size_t batchSize);
+
+    // Inference returns the first output per bar (NaN before a window is full); training returns
+    // an empty vector. Training runs on a copy of the network that replaces it when done; with online
+    // normalization the statistics gathered over the training bars replace the previous ones too, and
+    // the next onBar continues from them.
+    std::vector<double> processData(const std::vector<BarData>& barData,
+                                    const std::map<std::string, std::vector<double>>& indicatorData,
+                                    bool useIndicators, bool isTraining);
+    // Streaming inference for one closed bar; indicators may be nullptr to use the built-in indicators.
+    double onBar(const BarData& bar, const double* indicators);
+
+    void setIndicatorSchema(const std::vector<std::string>& names);
+    void addBuiltInIndicator(const std::string& name, const IndicatorEngine::IndicatorSpec& spec);
+    void setLaggedWindow(const WindowConfig& config);
+    void clearLaggedWindow();
+
+    // Returns the calibration report; on failure the int8 network is dropped.
+    QuantizedNetwork::CalibrationReport enableQuantizedInference(const std::vector<BarData>& calibrationBars,
+                                                                 const std::map<std::string, std::vector<double>>& indicatorData,
+                                                                 bool useIndicators);
+    void disableQuantizedInference();
+    // Compiles the plan and returns a reference that keeps it alive; on failure the plan is dropped.
+    std::shared_ptr<const InferencePlan> optimizeForInference();
+    void disableOptimizedInference();
+
+    void enableOnlineNormalization(const RunningStats& prototype);
+    void disableOnlineNormalization();
+    void setOptimizer(const OptimizerConfig& config, double learningRate);
+    void setActivationMode(kernels::ActivationMode mode);
+
+    void save(const std::string& filename) const;       // text format
+    void saveBinary(const std::string& filename) const; // see model_file.h
+    // Accepts both formats; the binary one is mapped and used in place. The file is read and the new
+    // version built while inference goes on with the current one, which it replaces when complete.
+    void load(const std::string& filename);
+    // As load, on a background thread; returns at once. A load started earlier is waited for first
+    // and its error, if any, is dropped.
+    void loadAsync(const std::string& filename);
+    // Waits for the last loadAsync and rethrows its error, if any. Returns at once without one.
+    void waitForLoad();
+
+    // Number of versions published so far, for tests and monitoring.
+    std::uint64_t getVersion() const;
+
+private:
+    // Everything inference reads; never modified once published.
+    struct Snapshot {
+        std::shared_ptr<const NeuralNetwork> network;
+        std::shared_ptr<const DataNormalization> normalization;
+        std::shared_ptr<const QuantizedNetwork> quantizedNetwork; // int8 copy used for inference when enabled
+        std::shared_ptr<const InferencePlan> inferencePlan;       // compiled network and normalization
+        std::string modelVersion = "1.0";
+        IndicatorSchema indicatorSchema;
+        WindowConfig windowConfig;
+        bool useWindows = false;
+        std::uint64_t version = 0;
+        std::uint64_t streamGeneration = 0;    // changes when onBar has to start over
+        std::uint64_t indicatorGeneration = 0; // changes when the built-in indicators forget their bars
+    };
+
+    SnapshotCell<Snapshot> snapshot_;
+
+    // Writer state, guarded by mutex_.
+    mutable std::mutex mutex_;
+    double learningRate_ = 0.1;
+    kernels::ActivationMode activationMode_ = kernels::ActivationMode::Exact;
+
+    std::mutex loadMutex_; // guards pendingLoad_; never held while waiting for mutex_
+    std::future<void> pendingLoad_;
+
+    // onBar state, guarded by streamMutex_ (taken after mutex_ where both are held).
+    mutable std::mutex streamMutex_;
+    std::shared_ptr<const Snapshot> streamSnapshot_; // version the stream runs on, kept alive by it
+    std::unique_ptr<InterfaceFunction> streamInterface_; // keeps onBar state between bars
+    IndicatorEngine indicatorEngine_; // built-in indicators for onBar
+    std::vector<double> indicatorValues_;
+
+    static void requireInitialized(const Snapshot& snapshot);
+    static void applyWindowConfig(const Snapshot& snapshot, InterfaceFunction& interface);
+    // Publishes next as the following version; with resetStream the next onBar starts over.
+    void publish(Snapshot next, bool resetStream);
+    // Normalization to save: once onBar has run on this version, its copy holds the most recent online statistics.
+    DataNormalization currentNormalization(const Snapshot& snapshot) const;
+};
+
+#endif // NETWORK_MODEL_H
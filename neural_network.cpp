@@ -1,74 +1,131 @@
 #include "neural_network.h"
+#include "instrumentation.h"
 #include <cmath>
 #include <stdexcept>
 #include <fstream> 
 #include <sstream> 
 #include <iostream>
 #include <random>
+#include <algorithm>
+#include <limits>
 
 
 
-NeuralNetwork::NeuralNetwork(size_t numInputs, size_t numOutputs) : numInputs_(numInputs), numOutputs_(numOutputs) {}
+template <typename T>
+NeuralNetworkT<T>::NeuralNetworkT(size_t numInputs, size_t numOutputs) : numInputs_(numInputs), numOutputs_(numOutputs) {}
 
-void NeuralNetwork::addLayer(size_t numOutputs, Layer::ActivationType activationType) {
+template <typename T>
+void NeuralNetworkT<T>::addLayer(size_t numOutputs, ActivationType activationType) {
     size_t numInputs = layers_.empty() ? numInputs_ : layers_.back().getOutputSize();
     layers_.emplace_back(numInputs, numOutputs, activationType);
+    layers_.back().setActivationMode(activationMode_);
     numOutputs_ = numOutputs;
+}
 
-    if (!previousWeightUpdates_.empty()) {
-        previousWeightUpdates_.resize(layers_.size());
-        previousWeightUpdates_.back().resize(layers_.back().getOutputSize(), std::vector<double>(layers_.back().getInputSize(), 0.0));
-    }
-
-    if (!previousBiasUpdates_.empty()) {
-        previousBiasUpdates_.resize(layers_.size());
-        previousBiasUpdates_.back().resize(layers_.back().getOutputSize(), 0.0);
-    }
+template <typename T>
+void NeuralNetworkT<T>::addLayer(const LayerT<T>& layer) {
+    addLayer(LayerT<T>(layer));
 }
 
-void NeuralNetwork::addLayer(const Layer& layer) {
+template <typename T>
+void NeuralNetworkT<T>::addLayer(LayerT<T>&& layer) {
     if (!layers_.empty() && layers_.back().getOutputSize() != layer.getInputSize()) {
         throw std::invalid_argument("Number of inputs in new layer must match the number of outputs in the previous layer.");
     }
-    layers_.push_back(layer);
+    layers_.push_back(std::move(layer));
+    layers_.back().setActivationMode(activationMode_);
     if (layers_.size() == 1) {
-        numInputs_ = layer.getInputSize();
+        numInputs_ = layers_.back().getInputSize();
     }
-    numOutputs_ = layer.getOutputSize();
-
-     if (!previousWeightUpdates_.empty())
-    {
-        previousWeightUpdates_.resize(layers_.size());
-         previousWeightUpdates_.back().resize(layers_.back().getOutputSize(), std::vector<double>(layers_.back().getInputSize(), 0.0));
+    numOutputs_ = layers_.back().getOutputSize();
+}
 
+template <typename T>
+std::vector<T> NeuralNetworkT<T>::predict(const std::vector<T>& input) const {
+    if (layers_.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before predicting.");
+    }
+    if (input.size() != numInputs_) {
+        throw std::invalid_argument("Input size mismatch.");
     }
 
-    if (!previousBiasUpdates_.empty())
-    {
+    std::vector<T> output(numOutputs_);
+    predictInto(input.data(), output.data());
+    return output;
+}
 
-         previousBiasUpdates_.resize(layers_.size());
-         previousBiasUpdates_.back().resize(layers_.back().getOutputSize(), 0.0);
+template <typename T>
+void NeuralNetworkT<T>::predictInto(const T* input, T* output) const {
+    thread_local InferenceWorkspaceT<T> workspace;
+    predictInto(input, output, workspace);
+}
 
+template <typename T>
+void NeuralNetworkT<T>::predictInto(const T* input, T* output, InferenceWorkspaceT<T>& workspace) const {
+    if (layers_.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before predicting.");
+    }
+    workspace.reserve(getMaxLayerWidth());
+
+    NN_PROFILE_LAYERS();
+    const T* layerInput = input;
+    for (size_t i = 0; i + 1 < layers_.size(); ++i) {
+        T* layerOutput = workspace.getBuffer(i);
+        layers_[i].forward(layerInput, layerOutput);
+        NN_PROFILE_LAYER_DONE(i);
+        layerInput = layerOutput;
     }
+    layers_.back().forward(layerInput, output);
+    NN_PROFILE_LAYER_DONE(layers_.size() - 1);
+}
 
+template <typename T>
+InferenceWorkspaceT<T> NeuralNetworkT<T>::createWorkspace() const {
+    return InferenceWorkspaceT<T>(getMaxLayerWidth());
 }
 
-std::vector<double> NeuralNetwork::predict(const std::vector<double>& input) const {
+template <typename T>
+std::vector<T> NeuralNetworkT<T>::predictBatch(const std::vector<T>& inputs, size_t numSamples) const {
     if (layers_.empty()) {
         throw std::runtime_error("Neural network is empty. Add layers before predicting.");
     }
-    if (input.size() != numInputs_) {
+    if (inputs.size() != numSamples * numInputs_) {
         throw std::invalid_argument("Input size mismatch.");
     }
+    return predictBatch(inputs.data(), numSamples, numInputs_);
+}
 
-    std::vector<double> output = input;
-    for (const auto& layer : layers_) {
-        output = layer.forward(output);
+template <typename T>
+std::vector<T> NeuralNetworkT<T>::predictBatch(const T* inputs, size_t numSamples, size_t inputStride) const {
+    if (layers_.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before predicting.");
     }
-    return output;
+
+    // Samples go through the whole network in chunks, so the intermediate
+    // activations of a chunk stay in cache between layers.
+    const size_t chunkSize = 256;
+    const size_t maxWidth = getMaxLayerWidth();
+    std::vector<T> bufferA(chunkSize * maxWidth);
+    std::vector<T> bufferB(chunkSize * maxWidth);
+    std::vector<T> outputs(numSamples * numOutputs_);
+
+    for (size_t start = 0; start < numSamples; start += chunkSize) {
+        const size_t count = std::min(chunkSize, numSamples - start);
+        const T* layerInput = inputs + start * inputStride;
+        NN_PROFILE_LAYERS();
+        for (size_t i = 0; i < layers_.size(); ++i) {
+            T* layerOutput = (i + 1 == layers_.size()) ? outputs.data() + start * numOutputs_
+                                                            : (i % 2 == 0 ? bufferA.data() : bufferB.data());
+            layers_[i].forwardBatch(layerInput, count, i == 0 ? inputStride : layers_[i].getInputSize(), layerOutput);
+            NN_PROFILE_LAYER_DONE(i);
+            layerInput = layerOutput;
+        }
+    }
+    return outputs;
 }
 
-void NeuralNetwork::train(const DataStorage& trainingData, size_t epochs, double learningRate) {
+template <typename T>
+void NeuralNetworkT<T>::train(const DataStorage& trainingData, size_t epochs, double learningRate) {
     if (layers_.empty()) {
         throw std::runtime_error("Neural network is empty. Add layers before training.");
     }
@@ -86,37 +143,259 @@ void NeuralNetwork::train(const DataStorage& trainingData, size_t epochs, double
     }
 
 
-    if (previousWeightUpdates_.empty()) {
-        previousWeightUpdates_.resize(layers_.size());
-        for (size_t i = 0; i < layers_.size(); ++i) {
-            previousWeightUpdates_[i].resize(layers_[i].getOutputSize(), std::vector<double>(layers_[i].getInputSize(), 0.0));
-        }
+    initializeOptimizer();
+
+    if (batchSize_ > 1 || trainingThreads_ > 1) {
+        trainMiniBatch(trainingData, epochs, learningRate);
+        return;
     }
 
-    if (previousBiasUpdates_.empty()) {
-        previousBiasUpdates_.resize(layers_.size());
-        for (size_t i = 0; i < layers_.size(); ++i) {
-            previousBiasUpdates_[i].resize(layers_[i].getOutputSize(), 0.0);
+    Span<const double> open = trainingData.getOpen();
+    Span<const double> close = trainingData.getClose();
+    Span<const double> high = trainingData.getHigh();
+    Span<const double> low = trainingData.getLow();
+    std::vector<T> input(numInputs_);
+    std::vector<T> target(numOutputs_);
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        for (size_t i = 0; i < open.size(); ++i) {
+            input[0] = static_cast<T>(open[i]);
+            input[1] = static_cast<T>(close[i]);
+            input[2] = static_cast<T>(high[i]);
+            input[3] = static_cast<T>(low[i]);
+            target[0] = static_cast<T>(close[i]);
+
+            const std::vector<T>& output = forwardAndRecord(input);
+            backpropagate(target, output);
+            updateWeights(learningRate, input);
         }
+    }
+}
+
+template <typename T>
+void NeuralNetworkT<T>::train(const LaggedDatasetT<T>& dataset, size_t epochs, double learningRate) {
+    if (layers_.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before training.");
+    }
+    if (dataset.size() == 0) {
+        throw std::runtime_error("Training data is empty. Provide data before training.");
+    }
+    if (numInputs_ != dataset.getNumInputs() || numOutputs_ != dataset.getNumTargets()) {
+        throw std::runtime_error("Network inputs and outputs must match the window and its targets.");
+    }
+
+    initializeOptimizer();
+    trainMiniBatch(dataset.getInputs(), dataset.getInputStride(), dataset.getTargets(), dataset.size(), epochs, learningRate);
+}
+
+// Optimizer state for every layer; state of layers that did not change since the last training is kept.
+template <typename T>
+void NeuralNetworkT<T>::initializeOptimizer() {
+    optimizer_.reserve(layers_);
+}
 
+template <typename T>
+void NeuralNetworkT<T>::trainMiniBatch(const DataStorage& trainingData, size_t epochs, double learningRate) {
+    // Same OHLC -> close samples as the per-sample path, laid out once as row-major matrices.
+    const size_t numSamples = trainingData.getBarDataSize();
+    Span<const double> open = trainingData.getOpen();
+    Span<const double> close = trainingData.getClose();
+    Span<const double> high = trainingData.getHigh();
+    Span<const double> low = trainingData.getLow();
+    std::vector<T> inputs(numSamples * numInputs_);
+    std::vector<T> targets(numSamples);
+    for (size_t i = 0; i < numSamples; ++i) {
+        T* row = inputs.data() + i * numInputs_;
+        row[0] = static_cast<T>(open[i]);
+        row[1] = static_cast<T>(close[i]);
+        row[2] = static_cast<T>(high[i]);
+        row[3] = static_cast<T>(low[i]);
+        targets[i] = static_cast<T>(close[i]);
     }
+    trainMiniBatch(inputs.data(), numInputs_, targets.data(), numSamples, epochs, learningRate);
+}
 
+// Sample i is inputs + i * inputStride (rows may overlap) with targets + i * numOutputs_.
+template <typename T>
+void NeuralNetworkT<T>::trainMiniBatch(const T* inputs, size_t inputStride, const T* targets, size_t numSamples,
+                                       size_t epochs, double learningRate) {
+    ThreadPool pool(trainingThreads_);
+    const size_t numThreads = pool.getThreadCount();
+    trainingWorkspaces_.resize(numThreads);
+
+    if (hogwild_) {
+        // Each thread walks its own slice of the data and updates the shared weights and optimizer
+        // state directly, without synchronisation (see setHogwild). Step numbers interleave the
+        // threads' batches, as if they had run in turn; an epoch takes as many rounds as the largest
+        // slice has batches.
+        const size_t largestSlice = (numSamples + numThreads - 1) / numThreads;
+        const size_t batchesPerThread = (largestSlice + batchSize_ - 1) / batchSize_;
+        for (size_t epoch = 0; epoch < epochs; ++epoch) {
+            const size_t firstStep = optimizer_.getStepCount() + 1;
+            pool.run([&](size_t t) {
+                const size_t begin = numSamples * t / numThreads;
+                const size_t end = numSamples * (t + 1) / numThreads;
+                size_t batch = 0;
+                for (size_t start = begin; start < end; start += batchSize_, ++batch) {
+                    const size_t count = std::min(batchSize_, end - start);
+                    computeBatchGradients(inputs + start * inputStride, inputStride, targets + start * numOutputs_, count, trainingWorkspaces_[t]);
+                    applyGradients(trainingWorkspaces_[t], optimizer_.getStep(firstStep + batch * numThreads + t, learningRate, count));
+                }
+            });
+            optimizer_.advance(batchesPerThread * numThreads);
+        }
+        return;
+    }
 
     for (size_t epoch = 0; epoch < epochs; ++epoch) {
-        for (size_t i = 0; i < trainingData.getBarDataSize(); ++i) {
-            BarData bar = trainingData.getBarData(i);
-            std::vector<double> input = {bar.open, bar.close, bar.high, bar.low};
-            std::vector<double> target = {bar.close};
+        for (size_t start = 0; start < numSamples; start += batchSize_) {
+            const size_t count = std::min(batchSize_, numSamples - start);
+            if (numThreads == 1) {
+                computeBatchGradients(inputs + start * inputStride, inputStride, targets + start * numOutputs_, count, trainingWorkspaces_[0]);
+            } else {
+                pool.run([&](size_t t) {
+                    const size_t begin = start + count * t / numThreads;
+                    const size_t end = start + count * (t + 1) / numThreads;
+                    computeBatchGradients(inputs + begin * inputStride, inputStride, targets + begin * numOutputs_, end - begin, trainingWorkspaces_[t]);
+                });
+                reduceGradients(pool);
+            }
+            applyGradients(trainingWorkspaces_[0], optimizer_.beginStep(learningRate, count));
+        }
+    }
+}
 
-            std::vector<double> output = predict(input);
-            backpropagate(target, output, input); // Pass input to backpropagate
-            updateWeights(learningRate, input);
+// Sums the gradients of every training workspace into workspace 0. Each thread owns a slice of every
+// layer's gradient block and adds the workspaces in index order, so the result is deterministic.
+template <typename T>
+void NeuralNetworkT<T>::reduceGradients(ThreadPool& pool) {
+    const size_t numThreads = pool.getThreadCount();
+    pool.run([&](size_t t) {
+        for (size_t i = 0; i < layers_.size(); ++i) {
+            const size_t size = trainingWorkspaces_[0].getGradientSize(i);
+            const size_t begin = size * t / numThreads;
+            const size_t end = size * (t + 1) / numThreads;
+            T* total = trainingWorkspaces_[0].getWeightGradient(i);
+            for (size_t w = 1; w < trainingWorkspaces_.size(); ++w) {
+                const T* partial = trainingWorkspaces_[w].getWeightGradient(i);
+                for (size_t k = begin; k < end; ++k) {
+                    total[k] += partial[k];
+                }
+            }
         }
+    });
+}
+
+template <typename T>
+void NeuralNetworkT<T>::computeBatchGradients(const T* inputs, size_t inputStride, const T* targets, size_t count,
+                                              TrainingWorkspaceT<T>& workspace) const {
+    workspace.reserve(layers_, count);
+    workspace.clearGradients();
+
+    const T* layerInput = inputs;
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        layers_[i].forwardBatch(layerInput, count, i == 0 ? inputStride : layers_[i].getInputSize(), workspace.getActivations(i));
+        layerInput = workspace.getActivations(i);
+    }
+
+    // Squared-error loss: dL/dy = y - target.
+    const size_t last = layers_.size() - 1;
+    const T* output = workspace.getActivations(last);
+    T* delta = workspace.getDeltas(last);
+    for (size_t k = 0; k < count * numOutputs_; ++k) {
+        delta[k] = output[k] - targets[k];
+    }
+    kernels::multiplyActivationDerivative(output, delta, count * numOutputs_, layers_[last].getKernelActivation());
+
+    for (size_t i = layers_.size(); i-- > 0;) {
+        const LayerT<T>& layer = layers_[i];
+        const size_t numIn = layer.getInputSize();
+        const size_t numOut = layer.getOutputSize();
+        const T* x = (i == 0) ? inputs : workspace.getActivations(i - 1);
+        const size_t xStride = (i == 0) ? inputStride : numIn;
+
+        kernels::weightGradient(workspace.getDeltas(i), count, numOut, x, xStride, numOut, numIn,
+                                workspace.getWeightGradient(i), layer.getWeightStride(), workspace.getBiasGradient(i));
+
+        if (i > 0) {
+            kernels::inputGradient(workspace.getDeltas(i), count, numOut, layer.getWeightData(), layer.getWeightStride(),
+                                   numOut, numIn, workspace.getDeltas(i - 1), numIn);
+            kernels::multiplyActivationDerivative(workspace.getActivations(i - 1), workspace.getDeltas(i - 1),
+                                                  count * numIn, layers_[i - 1].getKernelActivation());
+        }
+    }
+}
+
+// One optimizer step along the batch gradient: a layer's gradient block has the layout of its
+// parameter block, so each layer is a single fused pass.
+template <typename T>
+void NeuralNetworkT<T>::applyGradients(const TrainingWorkspaceT<T>& workspace, const typename OptimizerT<T>::Step& step) {
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        optimizer_.update(i, layers_[i], 0, workspace.getGradientSize(i), workspace.getWeightGradient(i), step);
     }
 }
 
+template <typename T>
+void NeuralNetworkT<T>::setBatchSize(size_t batchSize) {
+    if (batchSize == 0) {
+        throw std::invalid_argument("Batch size must be greater than zero.");
+    }
+    batchSize_ = batchSize;
+}
+
+template <typename T>
+size_t NeuralNetworkT<T>::getBatchSize() const {
+    return batchSize_;
+}
+
+template <typename T>
+void NeuralNetworkT<T>::setTrainingThreads(size_t numThreads) {
+    if (numThreads == 0) {
+        throw std::invalid_argument("Training thread count must be greater than zero.");
+    }
+    trainingThreads_ = numThreads;
+}
+
+template <typename T>
+size_t NeuralNetworkT<T>::getTrainingThreads() const {
+    return trainingThreads_;
+}
 
-void NeuralNetwork::saveModel(std::ostream& file) const {
+template <typename T>
+void NeuralNetworkT<T>::setHogwild(bool enabled) {
+    hogwild_ = enabled;
+}
+
+template <typename T>
+void NeuralNetworkT<T>::setOptimizer(const OptimizerConfig& config) {
+    optimizer_.setConfig(config);
+}
+
+template <typename T>
+OptimizerT<T>& NeuralNetworkT<T>::getOptimizer() {
+    return optimizer_;
+}
+
+template <typename T>
+const OptimizerT<T>& NeuralNetworkT<T>::getOptimizer() const {
+    return optimizer_;
+}
+
+template <typename T>
+void NeuralNetworkT<T>::setActivationMode(kernels::ActivationMode mode) {
+    activationMode_ = mode;
+    for (auto& layer : layers_) {
+        layer.setActivationMode(mode);
+    }
+}
+
+template <typename T>
+kernels::ActivationMode NeuralNetworkT<T>::getActivationMode() const {
+    return activationMode_;
+}
+
+template <typename T>
+void NeuralNetworkT<T>::saveModel(std::ostream& file) const {
+    const std::streamsize previousPrecision = file.precision(std::numeric_limits<T>::max_digits10);
     file << numInputs_ << " " << numOutputs_ << "\n";
 
     for (const auto& layer : layers_) {
@@ -124,24 +403,30 @@ void NeuralNetwork::saveModel(std::ostream& file) const {
 
         const auto& weights = layer.getWeights();
         for (const auto& row : weights) {
-            for (double weight : row) {
+            for (T weight : row) {
                 file << weight << " ";
             }
             file << "\n";
         }
 
         const auto& biases = layer.getBiases();
-        for (double bias : biases) {
+        for (T bias : biases) {
             file << bias << " ";
         }
         file << "\n";
     }
+    file.precision(previousPrecision);
+
+    if (optimizer_.hasState()) {
+        file << "optimizer\n";
+        optimizer_.save(file, layers_);
+    }
 }
 
-void NeuralNetwork::loadModel(std::istream& file) {
+template <typename T>
+void NeuralNetworkT<T>::loadModel(std::istream& file) {
     layers_.clear();
-    previousWeightUpdates_.clear();
-    previousBiasUpdates_.clear();
+    optimizer_.clear();
 
 
     size_t numInputs, numOutputs;
@@ -149,23 +434,27 @@ void NeuralNetwork::loadModel(std::istream& file) {
     numInputs_ = numInputs;
     numOutputs_ = numOutputs;
 
+    // Values are parsed as double and rounded to T, so a model saved by either precision loads in both.
+    double value;
     int activationTypeInt;
     while (file >> numInputs >> numOutputs >> activationTypeInt) {
-        Layer::ActivationType activationType = static_cast<Layer::ActivationType>(activationTypeInt);
-        Layer layer(numInputs, numOutputs, activationType);
+        ActivationType activationType = static_cast<ActivationType>(activationTypeInt);
+        LayerT<T> layer(numInputs, numOutputs, activationType);
 
-        std::vector<std::vector<double>> weights(numOutputs, std::vector<double>(numInputs));
+        std::vector<std::vector<T>> weights(numOutputs, std::vector<T>(numInputs));
         for (size_t i = 0; i < numOutputs; ++i) {
             for (size_t j = 0; j < numInputs; ++j) {
-                file >> weights[i][j];
+                file >> value;
+                weights[i][j] = static_cast<T>(value);
             }
         }
         layer.setWeights(weights);
 
 
-        std::vector<double> biases(numOutputs);
+        std::vector<T> biases(numOutputs);
         for (size_t i = 0; i < numOutputs; ++i) {
-            file >> biases[i];
+            file >> value;
+            biases[i] = static_cast<T>(value);
         }
         layer.setBiases(biases);
 
@@ -173,33 +462,71 @@ void NeuralNetwork::loadModel(std::istream& file) {
         addLayer(layer); 
 
     }
+
+    // The layers end at the optional optimizer section (or at the end of the file).
+    if (!file.eof()) {
+        file.clear();
+        std::string tag;
+        if (file >> tag && tag == "optimizer") {
+            optimizer_.load(file, layers_);
+        }
+    }
 }
 
 
 
-std::vector<Layer>& NeuralNetwork::getLayers() {
+template <typename T>
+std::vector<LayerT<T>>& NeuralNetworkT<T>::getLayers() {
+    return layers_;
+}
+
+template <typename T>
+const std::vector<LayerT<T>>& NeuralNetworkT<T>::getLayers() const {
     return layers_;
 }
 
-size_t NeuralNetwork::getNumInputs() const {
+template <typename T>
+size_t NeuralNetworkT<T>::getMaxLayerWidth() const {
+    size_t maxWidth = 0;
+    for (const auto& layer : layers_) {
+        maxWidth = std::max(maxWidth, layer.getOutputSize());
+    }
+    return maxWidth;
+}
+
+template <typename T>
+size_t NeuralNetworkT<T>::getNumInputs() const {
     return numInputs_;
 }
 
-size_t NeuralNetwork::getNumOutputs() const {
+template <typename T>
+size_t NeuralNetworkT<T>::getNumOutputs() const {
     return numOutputs_;
 }
 
-std::vector<std::vector<double>> NeuralNetwork::calculateDeltas(const std::vector<double>& target, const std::vector<double>& output, const Layer& layer) const {
-
-    std::vector<std::vector<double>> deltas(1, std::vector<double>(layer.getOutputSize()));
-    for (size_t i = 0; i < layer.getOutputSize(); ++i) {
-        double error = target[i] - output[i];
-        deltas[0][i] = error * activationDerivative(output[i], layer.getActivationFunction());
+// Training forward pass: keeps every layer's output in layerOutputs_, where backpropagate()
+// and updateWeights() read it back instead of running the layers again.
+// Inference never touches this state, so predict() stays read-only on the network.
+template <typename T>
+const std::vector<T>& NeuralNetworkT<T>::forwardAndRecord(const std::vector<T>& input) {
+    if (input.size() != numInputs_) {
+        throw std::invalid_argument("Input size mismatch.");
+    }
+    layerOutputs_.resize(layers_.size());
+    layerDeltas_.resize(layers_.size());
+    const T* layerInput = input.data();
+    for (size_t i = 0; i < layers_.size(); ++i) {
+        layerOutputs_[i].resize(layers_[i].getOutputSize());
+        layerDeltas_[i].resize(layers_[i].getOutputSize());
+        layers_[i].forward(layerInput, layerOutputs_[i].data());
+        layerInput = layerOutputs_[i].data();
     }
-    return deltas;
+    return layerOutputs_.back();
 }
 
-void NeuralNetwork::backpropagate(const std::vector<double>& target, const std::vector<double>& output, const std::vector<double>& input) { // Added input parameter
+// Computes dL/dz for every layer into layerDeltas_ from the recorded outputs (squared-error loss).
+template <typename T>
+void NeuralNetworkT<T>::backpropagate(const std::vector<T>& target, const std::vector<T>& output) {
 
     if (layers_.empty()) {
         throw std::runtime_error("Cannot backpropagate on an empty network.");
@@ -209,173 +536,55 @@ void NeuralNetwork::backpropagate(const std::vector<double>& target, const std::
         throw std::invalid_argument("Target size mismatch with output layer size.");
     }
 
-
-
- std::vector<std::vector<std::vector<double>>> deltas;
-    deltas.push_back(calculateDeltas(target, output, layers_.back()));  
-
-
-
-    for (size_t i = layers_.size() - 2; i >= 0; --i) {
-        std::vector<double> nextLayerWeightedSum(layers_[i].getOutputSize(), 0.0);
-        for (size_t j = 0; j < layers_[i + 1].getOutputSize(); ++j) {
-            for (size_t k = 0; k < layers_[i].getOutputSize(); ++k) {
-                nextLayerWeightedSum[k] += deltas.back()[0][j] * layers_[i + 1].getWeights()[j][k];
-            }
-        }
-
-
-        std::vector<double> prevLayerOutput = (i == 0) ? input : layers_[i - 1].getOutput();
-        std::vector<double> currentLayerOutput = layers_[i].forward(prevLayerOutput);
-
-
-
-        deltas.insert(deltas.begin(), calculateDeltas(nextLayerWeightedSum, currentLayerOutput, layers_[i]));
-
-
-
-
+    const size_t last = layers_.size() - 1;
+    std::vector<T>& outputDelta = layerDeltas_[last];
+    for (size_t k = 0; k < target.size(); ++k) {
+        outputDelta[k] = output[k] - target[k];
     }
-
-
-    for (size_t i = 0; i < layers_.size(); ++i) {
-        layers_[i].setDeltas(deltas[i]);
+    kernels::multiplyActivationDerivative(output.data(), outputDelta.data(), outputDelta.size(), layers_[last].getKernelActivation());
+
+    for (size_t i = last; i > 0; --i) {
+        const LayerT<T>& layer = layers_[i];
+        kernels::inputGradient(layerDeltas_[i].data(), 1, layer.getOutputSize(), layer.getWeightData(), layer.getWeightStride(),
+                               layer.getOutputSize(), layer.getInputSize(), layerDeltas_[i - 1].data(), layer.getInputSize());
+        kernels::multiplyActivationDerivative(layerOutputs_[i - 1].data(), layerDeltas_[i - 1].data(),
+                                              layer.getInputSize(), layers_[i - 1].getKernelActivation());
     }
 }
 
-
-void NeuralNetwork::updateWeights(double learningRate, const std::vector<double>& input) {
-    std::vector<double> layerInput = input;
-
-    if (previousWeightUpdates_.empty()) {
-       previousWeightUpdates_.resize(layers_.size());
-       for(size_t i = 0; i < layers_.size(); ++i)
-       {
-           previousWeightUpdates_[i].resize(layers_[i].getOutputSize(), std::vector<double>(layers_[i].getInputSize(), 0.0));
-       }
-
-    }
-
-    if(previousBiasUpdates_.empty())
-    {
-         previousBiasUpdates_.resize(layers_.size());
-
-        for(size_t i = 0; i < layers_.size(); ++i)
-        {
-            previousBiasUpdates_[i].resize(layers_[i].getOutputSize(), 0.0);
-
-        }
-    }
-
-
-
-
+// Optimizer step from layerDeltas_, with each layer's input taken from the recorded outputs. The
+// gradient of weight row j is deltas[j] * input; it is formed one row at a time next to the update.
+template <typename T>
+void NeuralNetworkT<T>::updateWeights(double learningRate, const std::vector<T>& input) {
+    const typename OptimizerT<T>::Step step = optimizer_.beginStep(learningRate, 1);
     for (size_t i = 0; i < layers_.size(); ++i) {
-        Layer& layer = layers_[i];
-        std::vector<std::vector<double>>& weights = layer.getWeights();
-        std::vector<double>& biases = layer.getBiases();
-        std::vector<std::vector<double>> deltas = layer.getDeltas();
-
-        for (size_t j = 0; j < layer.getOutputSize(); ++j) {
-            for (size_t k = 0; k < layer.getInputSize(); ++k) {
-                 double weightUpdate = learningRate * deltas[0][j] * layerInput[k] + momentum_ * previousWeightUpdates_[i][j][k];
-                 weights[j][k] += weightUpdate;
-                 previousWeightUpdates_[i][j][k] = weightUpdate;
+        LayerT<T>& layer = layers_[i];
+        const size_t numIn = layer.getInputSize();
+        const size_t numOut = layer.getOutputSize();
+        const size_t stride = layer.getWeightStride();
+        const T* layerInput = (i == 0) ? input.data() : layerOutputs_[i - 1].data();
+        const T* deltas = layerDeltas_[i].data();
+
+        if (gradientRow_.size() < numIn) {
+            gradientRow_.resize(numIn);
+        }
+        T* gradient = gradientRow_.data();
+        for (size_t j = 0; j < numOut; ++j) {
+            for (size_t k = 0; k < numIn; ++k) {
+                gradient[k] = deltas[j] * layerInput[k];
             }
-
-
-            double biasUpdate = learningRate * deltas[0][j] + momentum_ * previousBiasUpdates_[i][j];
-
-            biases[j] += biasUpdate;
-            previousBiasUpdates_[i][j] = biasUpdate;
-
-
+            optimizer_.update(i, layer, j * stride, numIn, gradient, step);
         }
-
-        layerInput = layer.forward(layerInput); 
+        optimizer_.update(i, layer, numOut * stride, numOut, deltas, step);
     }
 }
 
 
-void NeuralNetwork::setTrainingMode(bool isTraining) {
+template <typename T>
+void NeuralNetworkT<T>::setTrainingMode(bool isTraining) {
 
     (void)isTraining;
 }
 
-
-
-
-double NeuralNetwork::activationFunction(double x, Layer::ActivationType type) {
-
-    switch (type) {
-    case Layer::ActivationType::ReLU:
-        return relu(x);
-    case Layer::ActivationType::Sigmoid:
-        return sigmoid(x);
-    case Layer::ActivationType::Tanh:
-        return tanh(x);
-    case Layer::ActivationType::Linear:
-        return x;
-    case Layer::ActivationType::None:
-        return x;
-    default:
-        throw std::invalid_argument("Unknown activation type");
-
-    }
-}
-
-
-
-double NeuralNetwork::activationDerivative(double x, Layer::ActivationType type) {
-
-      switch (type) {
-    case Layer::ActivationType::ReLU:
-        return reluDerivative(x);
-    case Layer::ActivationType::Sigmoid:
-        return sigmoidDerivative(x);
-    case Layer::ActivationType::Tanh:
-        return 1.0 - std::pow(tanh(x), 2); 
-    case Layer::ActivationType::Linear:
-        return 1.0;
-    case Layer::ActivationType::None:
-        return 1.0;
-    default:
-        throw std::invalid_argument("Unknown activation type");
-    }
-}
-
-
-double NeuralNetwork::relu(double x) {
-    return std::max(0.0, x);
-}
-
-
-double NeuralNetwork::reluDerivative(double x) {
-
-    return x > 0 ? 1.0 : 0.0;
-}
-
-
-
-double NeuralNetwork::sigmoid(double x) {
-
-    return 1.0 / (1.0 + std::exp(-x));
-}
-
-
-
-
-double NeuralNetwork::sigmoidDerivative(double x) {
-
-    double sig = sigmoid(x);
-    return sig * (1.0 - sig);
-
-}
-
-
-
-
-double NeuralNetwork::tanh(double x) {
-
-    return std::tanh(x);
-}
\ No newline at end of file
+template class NeuralNetworkT<float>;
+template class NeuralNetworkT<double>;
@@ -4,53 +4,148 @@
 #include <vector>
 #include "layer.h"
 #include "data_storage.h"
+#include "inference_workspace.h"
+#include "training_workspace.h"
+#include "thread_pool.h"
+#include "lagged_window.h"
+#include "optimizer.h"
 #include <stdexcept>
 #include <fstream> 
 #include <iostream>
 
 
-class NeuralNetwork {
+// Feed-forward network computing in T (float or double). Bar data stays double and is
+// converted when it enters the network.
+// Prediction (predict, predictInto, predictBatch) is const and keeps its scratch state per thread
+// or per caller, so a single network can serve many threads concurrently. Training and
+// topology changes mutate the network and must not overlap with predictions.
+template <typename T>
+class NeuralNetworkT {
 public:
-    NeuralNetwork(size_t numInputs = 0, size_t numOutputs = 0);
+    using Scalar = T;
 
-    void addLayer(size_t numOutputs, Layer::ActivationType activationType = Layer::ActivationType::ReLU);
-    void addLayer(const Layer& layer);
+    NeuralNetworkT(size_t numInputs = 0, size_t numOutputs = 0);
 
-    std::vector<double> predict(const std::vector<double>& input) const;
+    // Converts a network of another precision. Parameters are rounded to T; the optimizer config is
+    // copied, its state is not.
+    template <typename U>
+    explicit NeuralNetworkT(const NeuralNetworkT<U>& other);
 
-    void train(const DataStorage& trainingData, size_t epochs, double learningRate);
+    void addLayer(size_t numOutputs, ActivationType activationType = ActivationType::ReLU);
+    void addLayer(const LayerT<T>& layer);
+    void addLayer(LayerT<T>&& layer); // keeps the layer's parameter buffer, e.g. a mapped view
+
+    std::vector<T> predict(const std::vector<T>& input) const;
+    // inputs is a row-major numSamples x getNumInputs() matrix; returns numSamples x getNumOutputs().
+    std::vector<T> predictBatch(const std::vector<T>& inputs, size_t numSamples) const;
+    // As above with consecutive samples inputStride values apart, e.g. the overlapping windows of a
+    // LaggedDatasetT (inputs = getInputs(), inputStride = getInputStride()).
+    std::vector<T> predictBatch(const T* inputs, size_t numSamples, size_t inputStride) const;
+
+    // Allocation-free prediction: reads getNumInputs() values from input and writes getNumOutputs() values to output.
+    // The first overload uses a per-thread workspace that is sized on the first call.
+    void predictInto(const T* input, T* output) const;
+    void predictInto(const T* input, T* output, InferenceWorkspaceT<T>& workspace) const;
+    InferenceWorkspaceT<T> createWorkspace() const;
 
+    void train(const DataStorage& trainingData, size_t epochs, double learningRate);
+    // Trains on lagged windows and their horizon targets in place, in mini-batches of getBatchSize()
+    // windows. Needs getNumInputs() == dataset.getNumInputs() and getNumOutputs() == dataset.getNumTargets().
+    void train(const LaggedDatasetT<T>& dataset, size_t epochs, double learningRate);
+
+    // Samples per parameter update in train(). 1 (the default) is per-sample SGD; larger values
+    // accumulate gradients over the batch with matrix-matrix kernels and update once per batch.
+    void setBatchSize(size_t batchSize);
+    size_t getBatchSize() const;
+
+    // Worker threads used by mini-batch training. In the default synchronous mode each batch is split
+    // across the threads and the per-thread gradients are summed in a fixed order, so results are
+    // reproducible for a given thread count. Hogwild mode lets every thread update the shared
+    // parameters without locking; it scales better but is not deterministic.
+    void setTrainingThreads(size_t numThreads);
+    size_t getTrainingThreads() const;
+    // Hogwild: each thread trains on its own slice of the samples and applies its batches to the
+    // shared parameters and optimizer state as it goes. The optimizer config, momentum included, is
+    // used as set; asynchronous updates add momentum of their own, so a lower momentum may train
+    // better with many threads. An epoch advances the step count by the thread count times the
+    // batches in the largest slice.
+    //
+    // The threads read and write the parameters and optimizer state concurrently with plain,
+    // non-atomic accesses. That is a data race and so undefined behaviour in C++; it is a deliberate
+    // trade-off for speed, relying on aligned float/double loads and stores not tearing on the
+    // supported x86-64 compilers. ThreadSanitizer reports these races. Use the synchronous mode where
+    // that is not acceptable.
+    void setHogwild(bool enabled);
+
+    // Update rule used by train(); momentum SGD (0.9) by default. Setting it clears the optimizer state.
+    void setOptimizer(const OptimizerConfig& config);
+    OptimizerT<T>& getOptimizer();
+    const OptimizerT<T>& getOptimizer() const;
+
+    // Accuracy of sigmoid/tanh in every layer, including layers added later (see kernels::ActivationMode).
+    // Exact by default; not stored in model files.
+    void setActivationMode(kernels::ActivationMode mode);
+    kernels::ActivationMode getActivationMode() const;
+
+    // Text import/export. Values are written with enough digits to round-trip exactly. Once the network
+    // has been trained the optimizer state follows the layers, so training can resume from the file.
+    // See model_file.h for the binary format that can be memory-mapped.
     void saveModel(std::ostream& file) const;
     void loadModel(std::istream& file);
 
-    std::vector<Layer>& getLayers();
+    std::vector<LayerT<T>>& getLayers();
+    const std::vector<LayerT<T>>& getLayers() const;
+    size_t getMaxLayerWidth() const;
     size_t getNumInputs() const;
     size_t getNumOutputs() const;
 
     void setTrainingMode(bool isTraining);
 
 private:
-    std::vector<Layer> layers_;
+    std::vector<LayerT<T>> layers_;
     size_t numInputs_;
     size_t numOutputs_;
 
-    double momentum_ = 0.9;
-    std::vector<std::vector<std::vector<double>>> previousWeightUpdates_;
-    std::vector<std::vector<double>> previousBiasUpdates_;
-
-    std::vector<std::vector<double>> calculateDeltas(const std::vector<double>& target, const std::vector<double>& output, const Layer& layer) const;
-    void backpropagate(const std::vector<double>& target, const std::vector<double>& output);
-    void updateWeights(double learningRate, const std::vector<double>& input);
-
-    static double activationFunction(double x, Layer::ActivationType type);
-    static double activationDerivative(double x, Layer::ActivationType type);
-
-    static double relu(double x);
-    static double reluDerivative(double x);
-    static double sigmoid(double x);
-    static double sigmoidDerivative(double x);
-    static double tanh(double x);
-
+    OptimizerT<T> optimizer_;
+    kernels::ActivationMode activationMode_ = kernels::ActivationMode::Exact;
+    std::vector<std::vector<T>> layerOutputs_; // per-layer outputs of the last training forward pass
+    std::vector<std::vector<T>> layerDeltas_;  // per-layer dL/dz of the last backpropagate()
+    std::vector<T> gradientRow_;               // one weight row's gradient in updateWeights()
+
+    size_t batchSize_ = 1;
+    size_t trainingThreads_ = 1;
+    bool hogwild_ = false;
+    std::vector<TrainingWorkspaceT<T>> trainingWorkspaces_; // one per training thread
+
+    void initializeOptimizer();
+    void trainMiniBatch(const DataStorage& trainingData, size_t epochs, double learningRate);
+    void trainMiniBatch(const T* inputs, size_t inputStride, const T* targets, size_t numSamples,
+                        size_t epochs, double learningRate);
+    void computeBatchGradients(const T* inputs, size_t inputStride, const T* targets, size_t count,
+                               TrainingWorkspaceT<T>& workspace) const;
+    void applyGradients(const TrainingWorkspaceT<T>& workspace, const typename OptimizerT<T>::Step& step);
+    void reduceGradients(ThreadPool& pool);
+
+    const std::vector<T>& forwardAndRecord(const std::vector<T>& input);
+    void backpropagate(const std::vector<T>& target, const std::vector<T>& output);
+    void updateWeights(double learningRate, const std::vector<T>& input);
 };
 
+template <typename T>
+template <typename U>
+NeuralNetworkT<T>::NeuralNetworkT(const NeuralNetworkT<U>& other) :
+    NeuralNetworkT(other.getNumInputs(), other.getNumOutputs())
+{
+    activationMode_ = other.getActivationMode();
+    for (const auto& layer : other.getLayers()) {
+        addLayer(LayerT<T>(layer));
+    }
+    numInputs_ = other.getNumInputs();
+    numOutputs_ = other.getNumOutputs();
+    optimizer_.setConfig(other.getOptimizer().getConfig());
+}
+
+using NeuralNetwork = NeuralNetworkT<double>;
+using NeuralNetworkF = NeuralNetworkT<float>;
+
 #endif // NEURAL_NETWORK_H
\ No newline at end of file
@@ -0,0 +1,241 @@
+// optimizer.cpp
+#include "optimizer.h"
+#include <cmath>
+#include <limits>
+#include <string>
+
+void OptimizerConfig::validate() const {
+    switch (type) {
+        case OptimizerType::Momentum:
+            if (!(momentum >= 0.0 && momentum < 1.0)) {
+                throw std::invalid_argument("Momentum must lie in [0, 1).");
+            }
+            break;
+        case OptimizerType::Adam:
+            if (!(beta1 >= 0.0 && beta1 < 1.0) || !(beta2 >= 0.0 && beta2 < 1.0)) {
+                throw std::invalid_argument("Adam decay rates must lie in [0, 1).");
+            }
+            break;
+        case OptimizerType::RMSProp:
+            if (!(decay >= 0.0 && decay < 1.0)) {
+                throw std::invalid_argument("RMSProp decay must lie in [0, 1).");
+            }
+            break;
+        case OptimizerType::AdaGrad:
+            break;
+        default:
+            throw std::invalid_argument("Invalid optimizer type.");
+    }
+    if (type != OptimizerType::Momentum && !(epsilon > 0.0)) {
+        throw std::invalid_argument("Epsilon must be positive.");
+    }
+}
+
+size_t OptimizerConfig::getStateCount() const {
+    return type == OptimizerType::Adam ? 2 : 1;
+}
+
+template <typename T>
+OptimizerT<T>::OptimizerT(const OptimizerConfig& config) : config_(config) {
+    config_.validate();
+}
+
+template <typename T>
+const OptimizerConfig& OptimizerT<T>::getConfig() const {
+    return config_;
+}
+
+template <typename T>
+void OptimizerT<T>::setConfig(const OptimizerConfig& config) {
+    config.validate();
+    config_ = config;
+    clear();
+}
+
+template <typename T>
+void OptimizerT<T>::reserve(const std::vector<LayerT<T>>& layers) {
+    for (size_t slot = 0; slot < 2; ++slot) {
+        std::vector<AlignedVector<T>>& state = state_[slot];
+        if (slot >= config_.getStateCount()) {
+            state.clear();
+            continue;
+        }
+        state.resize(layers.size());
+        for (size_t i = 0; i < layers.size(); ++i) {
+            const size_t size = layers[i].getOutputSize() * layers[i].getWeightStride() + layers[i].getOutputSize();
+            if (state[i].size() != size) {
+                state[i].assign(size, T(0));
+            }
+        }
+    }
+}
+
+template <typename T>
+void OptimizerT<T>::clear() {
+    state_[0].clear();
+    state_[1].clear();
+    stepCount_ = 0;
+}
+
+template <typename T>
+bool OptimizerT<T>::hasState() const {
+    return !state_[0].empty();
+}
+
+template <typename T>
+typename OptimizerT<T>::Step OptimizerT<T>::beginStep(double learningRate, size_t batchSize) {
+    return getStep(++stepCount_, learningRate, batchSize);
+}
+
+template <typename T>
+typename OptimizerT<T>::Step OptimizerT<T>::getStep(size_t step, double learningRate, size_t batchSize) const {
+    Step result;
+    result.gradScale = static_cast<T>(1.0 / static_cast<double>(batchSize));
+    result.momentum = static_cast<T>(config_.momentum);
+    switch (config_.type) {
+        case OptimizerType::Momentum:
+            // The batch mean is folded into the step size.
+            result.rate = static_cast<T>(learningRate / static_cast<double>(batchSize));
+            break;
+        case OptimizerType::Adam: {
+            // Bias correction of both moments as one factor on the step size (Kingma & Ba, section 2).
+            const double t = static_cast<double>(step);
+            result.rate = static_cast<T>(learningRate * std::sqrt(1.0 - std::pow(config_.beta2, t)) /
+                                         (1.0 - std::pow(config_.beta1, t)));
+            break;
+        }
+        default:
+            result.rate = static_cast<T>(learningRate);
+            break;
+    }
+    return result;
+}
+
+template <typename T>
+void OptimizerT<T>::advance(size_t steps) {
+    stepCount_ += steps;
+}
+
+template <typename T>
+size_t OptimizerT<T>::getStepCount() const {
+    return stepCount_;
+}
+
+template <typename T>
+void OptimizerT<T>::update(size_t layerIndex, LayerT<T>& layer, size_t offset, size_t count, const T* gradient, const Step& step) {
+    T* params = layer.getWeightData() + offset;
+    T* first = state_[0][layerIndex].data() + offset;
+    switch (config_.type) {
+        case OptimizerType::Momentum:
+            kernels::momentumStep(params, gradient, first, count, step.rate, step.momentum);
+            break;
+        case OptimizerType::Adam:
+            kernels::adamStep(params, gradient, first, state_[1][layerIndex].data() + offset, count, step.gradScale,
+                              step.rate, static_cast<T>(config_.beta1), static_cast<T>(config_.beta2),
+                              static_cast<T>(config_.epsilon));
+            break;
+        case OptimizerType::RMSProp:
+            kernels::rmsPropStep(params, gradient, first, count, step.gradScale, step.rate,
+                                 static_cast<T>(config_.decay), static_cast<T>(config_.epsilon));
+            break;
+        case OptimizerType::AdaGrad:
+            kernels::adaGradStep(params, gradient, first, count, step.gradScale, step.rate, static_cast<T>(config_.epsilon));
+            break;
+    }
+}
+
+template <typename T>
+size_t OptimizerT<T>::getLayerCount() const {
+    return state_[0].size();
+}
+
+template <typename T>
+size_t OptimizerT<T>::getStateSize(size_t layerIndex) const {
+    return state_[0].at(layerIndex).size();
+}
+
+template <typename T>
+T* OptimizerT<T>::getState(size_t slot, size_t layerIndex) {
+    return state_[slot].at(layerIndex).data();
+}
+
+template <typename T>
+const T* OptimizerT<T>::getState(size_t slot, size_t layerIndex) const {
+    return state_[slot].at(layerIndex).data();
+}
+
+template <typename T>
+void OptimizerT<T>::setStepCount(size_t stepCount) {
+    stepCount_ = stepCount;
+}
+
+template <typename T>
+void OptimizerT<T>::save(std::ostream& out, const std::vector<LayerT<T>>& layers) const {
+    if (getLayerCount() != layers.size()) {
+        throw std::runtime_error("Optimizer state does not match the network.");
+    }
+    const std::streamsize previousPrecision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << static_cast<int>(config_.type) << " " << config_.momentum << " " << config_.beta1 << " "
+        << config_.beta2 << " " << config_.decay << " " << config_.epsilon << " " << stepCount_ << "\n";
+    out.precision(std::numeric_limits<T>::max_digits10);
+    for (size_t slot = 0; slot < config_.getStateCount(); ++slot) {
+        for (size_t i = 0; i < layers.size(); ++i) {
+            const T* state = state_[slot][i].data();
+            const size_t stride = layers[i].getWeightStride();
+            for (size_t r = 0; r < layers[i].getOutputSize(); ++r) {
+                for (size_t j = 0; j < layers[i].getInputSize(); ++j) {
+                    out << state[r * stride + j] << " ";
+                }
+                out << "\n";
+            }
+            const T* biasState = state + layers[i].getOutputSize() * stride;
+            for (size_t r = 0; r < layers[i].getOutputSize(); ++r) {
+                out << biasState[r] << " ";
+            }
+            out << "\n";
+        }
+    }
+    out.precision(previousPrecision);
+}
+
+template <typename T>
+void OptimizerT<T>::load(std::istream& in, const std::vector<LayerT<T>>& layers) {
+    int type;
+    OptimizerConfig config;
+    size_t stepCount;
+    if (!(in >> type >> config.momentum >> config.beta1 >> config.beta2 >> config.decay >> config.epsilon >> stepCount) ||
+        type < 0 || type > static_cast<int>(OptimizerType::AdaGrad)) {
+        throw std::runtime_error("Invalid optimizer state.");
+    }
+    config.type = static_cast<OptimizerType>(type);
+    setConfig(config);
+    reserve(layers);
+    stepCount_ = stepCount;
+
+    // Parsed as double and rounded to T, like the parameters.
+    double value;
+    for (size_t slot = 0; slot < config_.getStateCount(); ++slot) {
+        for (size_t i = 0; i < layers.size(); ++i) {
+            T* state = state_[slot][i].data();
+            const size_t stride = layers[i].getWeightStride();
+            const size_t numOutputs = layers[i].getOutputSize();
+            for (size_t r = 0; r < numOutputs; ++r) {
+                for (size_t j = 0; j < layers[i].getInputSize(); ++j) {
+                    if (!(in >> value)) {
+                        throw std::runtime_error("Invalid optimizer state.");
+                    }
+                    state[r * stride + j] = static_cast<T>(value);
+                }
+            }
+            for (size_t r = 0; r < numOutputs; ++r) {
+                if (!(in >> value)) {
+                    throw std::runtime_error("Invalid optimizer state.");
+                }
+                state[numOutputs * stride + r] = static_cast<T>(value);
+            }
+        }
+    }
+}
+
+template class OptimizerT<float>;
+template class OptimizerT<double>;
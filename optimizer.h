@@ -0,0 +1,89 @@
+// optimizer.h
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include "aligned_allocator.h"
+#include "layer.h"
+
+enum class OptimizerType {
+    Momentum, // SGD with momentum
+    Adam,
+    RMSProp,
+    AdaGrad
+};
+
+struct OptimizerConfig {
+    OptimizerType type = OptimizerType::Momentum;
+    double momentum = 0.9;  // Momentum
+    double beta1 = 0.9;     // Adam
+    double beta2 = 0.999;   // Adam
+    double decay = 0.9;     // RMSProp
+    double epsilon = 1e-8;  // Adam, RMSProp, AdaGrad
+
+    void validate() const; // throws std::invalid_argument
+    size_t getStateCount() const; // per-parameter state buffers: 2 for Adam, 1 otherwise
+};
+
+// Update rule applied by NeuralNetworkT::train. Its state mirrors the parameter blocks of the layers:
+// state buffer s of layer i has the layout of LayerT::getWeightData() (padded weight rows, then the
+// biases), so an update is one fused pass over parameters, gradient and state (kernels::*Step).
+template <typename T>
+class OptimizerT {
+public:
+    // Scalars shared by every update of one step.
+    struct Step {
+        T rate;      // step size; for Adam with the bias correction of this step folded in
+        T gradScale; // applied to the raw gradient: 1 / samples it was summed over
+        T momentum;  // Momentum only
+    };
+
+    explicit OptimizerT(const OptimizerConfig& config = OptimizerConfig());
+
+    const OptimizerConfig& getConfig() const;
+    // Switches the update rule and clears the state.
+    void setConfig(const OptimizerConfig& config);
+
+    // Sizes the state for layers. A layer keeps its state if its parameter block has the same size;
+    // other state starts at zero.
+    void reserve(const std::vector<LayerT<T>>& layers);
+    // Forgets all state and the step count.
+    void clear();
+    bool hasState() const;
+
+    // Advances the step count and returns the scalars for a step with gradients summed over batchSize samples.
+    Step beginStep(double learningRate, size_t batchSize);
+    // The scalars of step number step (1-based) without advancing, for updates that run concurrently.
+    Step getStep(size_t step, double learningRate, size_t batchSize) const;
+    void advance(size_t steps);
+    size_t getStepCount() const;
+
+    // Updates count parameters of layers[layerIndex] from offset on (an offset into its parameter
+    // block, see LayerT::getWeightData) with gradient[0 .. count).
+    void update(size_t layerIndex, LayerT<T>& layer, size_t offset, size_t count, const T* gradient, const Step& step);
+
+    // Raw state access for model files: reserve() first. getStateSize() is the layer's parameter block size.
+    size_t getLayerCount() const;
+    size_t getStateSize(size_t layerIndex) const;
+    T* getState(size_t slot, size_t layerIndex);
+    const T* getState(size_t slot, size_t layerIndex) const;
+    void setStepCount(size_t stepCount);
+
+    // Text form: config, step count and the state values of each layer without the row padding, with
+    // enough digits to round-trip. load() sizes the state for layers and replaces config and state.
+    void save(std::ostream& out, const std::vector<LayerT<T>>& layers) const;
+    void load(std::istream& in, const std::vector<LayerT<T>>& layers);
+
+private:
+    OptimizerConfig config_;
+    size_t stepCount_ = 0;
+    std::vector<AlignedVector<T>> state_[2]; // [slot][layer]
+};
+
+using Optimizer = OptimizerT<double>;
+using OptimizerF = OptimizerT<float>;
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,65 @@
+// parameter_buffer.h
+#ifndef PARAMETER_BUFFER_H
+#define PARAMETER_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include "aligned_allocator.h"
+
+// Contiguous parameter storage that either owns a 64-byte aligned buffer or views memory owned
+// elsewhere, such as a memory-mapped model file kept alive by `backing`. A view is used in place;
+// copying any buffer yields an owning deep copy, so copies never alias each other.
+template <typename T>
+class ParameterBuffer {
+public:
+    ParameterBuffer() = default;
+
+    explicit ParameterBuffer(size_t size, T value = T(0)) :
+        owned_(size, value), data_(owned_.data()), size_(size) {}
+
+    // data must be 64-byte aligned and stay valid as long as backing is alive.
+    ParameterBuffer(T* data, size_t size, std::shared_ptr<const void> backing) :
+        data_(data), size_(size), backing_(std::move(backing)) {}
+
+    ParameterBuffer(const ParameterBuffer& other) :
+        owned_(other.data_, other.data_ + other.size_), data_(owned_.data()), size_(other.size_) {}
+
+    ParameterBuffer(ParameterBuffer&& other) noexcept :
+        owned_(std::move(other.owned_)), data_(other.data_), size_(other.size_), backing_(std::move(other.backing_))
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    ParameterBuffer& operator=(ParameterBuffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(ParameterBuffer& other) noexcept {
+        // Swapping vectors keeps their heap blocks, so owning data_ pointers stay valid.
+        owned_.swap(other.owned_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        backing_.swap(other.backing_);
+    }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    // True if the values live in external memory rather than in this buffer.
+    bool isView() const { return backing_ != nullptr; }
+
+private:
+    AlignedVector<T> owned_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<const void> backing_;
+};
+
+#endif // PARAMETER_BUFFER_H
@@ -0,0 +1,195 @@
+// quantized_network.cpp
+#include "quantized_network.h"
+#include "instrumentation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    constexpr float kInt8Range = 127.0f;
+
+    inline std::int8_t quantize(float value, float inverseScale) {
+        if (!std::isfinite(value)) {
+            return 0; // NaN passes the clamp unchanged, and casting it to an integer is undefined
+        }
+        const float scaled = std::min(std::max(value * inverseScale, -kInt8Range), kInt8Range);
+        // Round half away from zero; a plain cast keeps this inline, unlike std::lrint.
+        return static_cast<std::int8_t>(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+    }
+
+    // Step size that maps [-maxAbs, maxAbs] onto [-127, 127]; an all-zero range keeps a unit step.
+    inline float scaleFor(double maxAbs) {
+        return maxAbs > 0.0 ? static_cast<float>(maxAbs / kInt8Range) : 1.0f;
+    }
+
+    template <typename T>
+    double maxAbs(const T* values, size_t count) {
+        double result = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            result = std::max(result, std::fabs(static_cast<double>(values[i])));
+        }
+        return result;
+    }
+}
+
+template <typename T>
+QuantizedNetwork::QuantizedNetwork(const NeuralNetworkT<T>& network, const std::vector<T>& calibrationInputs, size_t numSamples) :
+    numInputs_(network.getNumInputs()), numOutputs_(network.getNumOutputs())
+{
+    const auto& sourceLayers = network.getLayers();
+    if (sourceLayers.empty()) {
+        throw std::runtime_error("Neural network is empty. Add layers before quantizing.");
+    }
+    if (numSamples == 0) {
+        throw std::invalid_argument("Quantization needs at least one calibration sample.");
+    }
+    if (calibrationInputs.size() != numSamples * numInputs_) {
+        throw std::invalid_argument("Calibration input size mismatch.");
+    }
+
+    // Run the original network over the calibration sample layer by layer; the range seen
+    // at each layer input fixes that layer's input scale.
+    std::vector<T> layerInput = calibrationInputs;
+    std::vector<T> layerOutput;
+    layers_.reserve(sourceLayers.size());
+    for (const auto& source : sourceLayers) {
+        QuantizedLayer layer;
+        layer.numInputs = source.getInputSize();
+        layer.numOutputs = source.getOutputSize();
+        layer.stride = kernels::paddedStride<std::int8_t>(layer.numInputs);
+        layer.activation = source.getKernelActivation();
+        layer.activationMode = source.getActivationMode();
+
+        const float inputScale = scaleFor(maxAbs(layerInput.data(), layerInput.size()));
+        layer.inverseInputScale = 1.0f / inputScale;
+
+        layer.weights.assign(layer.numOutputs * layer.stride, 0);
+        layer.outputScales.resize(layer.numOutputs);
+        layer.biases.resize(layer.numOutputs);
+        for (size_t r = 0; r < layer.numOutputs; ++r) {
+            const T* row = source.getWeightData() + r * source.getWeightStride();
+            const float weightScale = scaleFor(maxAbs(row, layer.numInputs));
+            for (size_t j = 0; j < layer.numInputs; ++j) {
+                layer.weights[r * layer.stride + j] = quantize(static_cast<float>(row[j]), 1.0f / weightScale);
+            }
+            layer.outputScales[r] = weightScale * inputScale;
+            layer.biases[r] = static_cast<float>(source.getBiasData()[r]);
+        }
+
+        maxStride_ = std::max(maxStride_, layer.stride);
+        maxWidth_ = std::max(maxWidth_, layer.numOutputs);
+        layers_.push_back(std::move(layer));
+
+        layerOutput.resize(numSamples * source.getOutputSize());
+        source.forwardBatch(layerInput.data(), numSamples, layerOutput.data());
+        layerInput.swap(layerOutput);
+    }
+
+    // layerInput now holds the original network's outputs.
+    const std::vector<T> quantizedOutputs = predictBatch(calibrationInputs, numSamples);
+    report_.numSamples = numSamples;
+    for (size_t i = 0; i < quantizedOutputs.size(); ++i) {
+        const double error = std::fabs(static_cast<double>(quantizedOutputs[i]) - static_cast<double>(layerInput[i]));
+        report_.maxAbsError = std::max(report_.maxAbsError, error);
+        report_.meanAbsError += error;
+        report_.referenceMeanAbs += std::fabs(static_cast<double>(layerInput[i]));
+    }
+    report_.meanAbsError /= static_cast<double>(quantizedOutputs.size());
+    report_.referenceMeanAbs /= static_cast<double>(quantizedOutputs.size());
+}
+
+template <typename T>
+std::vector<T> QuantizedNetwork::predictBatch(const std::vector<T>& inputs, size_t numSamples) const {
+    if (inputs.size() != numSamples * numInputs_) {
+        throw std::invalid_argument("Input size mismatch.");
+    }
+
+    std::vector<T> outputs(numSamples * numOutputs_);
+    for (size_t i = 0; i < numSamples; ++i) {
+        predictInto(inputs.data() + i * numInputs_, outputs.data() + i * numOutputs_);
+    }
+    return outputs;
+}
+
+template <typename T>
+void QuantizedNetwork::predictInto(const T* input, T* output) const {
+    thread_local Scratch scratch;
+    if (scratch.quantized.size() < maxStride_) {
+        scratch.quantized.resize(maxStride_);
+    }
+    if (scratch.accumulators.size() < maxWidth_) {
+        scratch.accumulators.resize(maxWidth_);
+    }
+    if (scratch.values.size() < maxWidth_) {
+        scratch.values.resize(maxWidth_);
+    }
+    forward(input, output, scratch);
+}
+
+template <typename T>
+void QuantizedNetwork::forward(const T* input, T* output, Scratch& scratch) const {
+    std::int8_t* quantized = scratch.quantized.data();
+    std::int32_t* accumulators = scratch.accumulators.data();
+    float* values = scratch.values.data();
+
+    NN_PROFILE_LAYERS();
+    const QuantizedLayer& first = layers_.front();
+    for (size_t j = 0; j < first.numInputs; ++j) {
+        quantized[j] = quantize(static_cast<float>(input[j]), first.inverseInputScale);
+    }
+    std::fill(quantized + first.numInputs, quantized + first.stride, std::int8_t(0));
+
+    for (size_t l = 0; l < layers_.size(); ++l) {
+        const QuantizedLayer& layer = layers_[l];
+        kernels::gemvInt8(layer.weights.data(), layer.stride, quantized, layer.numOutputs, accumulators);
+
+        // Dequantize, activate and either requantize for the next layer or write the output.
+        for (size_t r = 0; r < layer.numOutputs; ++r) {
+            values[r] = accumulators[r] * layer.outputScales[r] + layer.biases[r];
+        }
+        kernels::applyActivation(values, layer.numOutputs, layer.activation, layer.activationMode);
+        if (l + 1 == layers_.size()) {
+            for (size_t r = 0; r < layer.numOutputs; ++r) {
+                output[r] = static_cast<T>(values[r]);
+            }
+        } else {
+            const QuantizedLayer& next = layers_[l + 1];
+            for (size_t r = 0; r < layer.numOutputs; ++r) {
+                quantized[r] = quantize(values[r], next.inverseInputScale);
+            }
+            std::fill(quantized + layer.numOutputs, quantized + next.stride, std::int8_t(0));
+        }
+        NN_PROFILE_LAYER_DONE(l);
+    }
+}
+
+const QuantizedNetwork::CalibrationReport& QuantizedNetwork::getCalibrationReport() const {
+    return report_;
+}
+
+size_t QuantizedNetwork::getNumInputs() const {
+    return numInputs_;
+}
+
+size_t QuantizedNetwork::getNumOutputs() const {
+    return numOutputs_;
+}
+
+size_t QuantizedNetwork::getParameterBytes() const {
+    size_t bytes = 0;
+    for (const auto& layer : layers_) {
+        bytes += layer.weights.size() * sizeof(std::int8_t);
+        bytes += (layer.outputScales.size() + layer.biases.size()) * sizeof(float);
+    }
+    return bytes;
+}
+
+#define NN_INSTANTIATE_QUANTIZED(T)                                                                      \
+    template QuantizedNetwork::QuantizedNetwork(const NeuralNetworkT<T>&, const std::vector<T>&, size_t); \
+    template std::vector<T> QuantizedNetwork::predictBatch<T>(const std::vector<T>&, size_t) const;      \
+    template void QuantizedNetwork::predictInto<T>(const T*, T*) const;
+
+NN_INSTANTIATE_QUANTIZED(float)
+NN_INSTANTIATE_QUANTIZED(double)
+
+#undef NN_INSTANTIATE_QUANTIZED
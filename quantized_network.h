@@ -0,0 +1,73 @@
+// quantized_network.h
+#ifndef QUANTIZED_NETWORK_H
+#define QUANTIZED_NETWORK_H
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "aligned_allocator.h"
+#include "math_kernels.h"
+#include "neural_network.h"
+
+// Inference-only int8 copy of a trained network (post-training quantization).
+// Weights are stored as int8 with one scale per output row. The input of each layer is quantized
+// with a fixed scale calibrated from the values the original network produces on a sample of
+// normalized inputs; values outside the calibrated range are clamped, and NaN or infinite values
+// become 0. Biases, activations and outputs stay in float. Prediction is const and may run on several threads at once.
+class QuantizedNetwork {
+public:
+    // Accuracy of the quantized network against the original one on the calibration sample.
+    struct CalibrationReport {
+        size_t numSamples = 0;
+        double maxAbsError = 0.0;
+        double meanAbsError = 0.0;
+        double referenceMeanAbs = 0.0; // mean |output| of the original network, to put the errors in scale
+    };
+
+    // calibrationInputs is a row-major numSamples x network.getNumInputs() matrix of normalized inputs.
+    template <typename T>
+    QuantizedNetwork(const NeuralNetworkT<T>& network, const std::vector<T>& calibrationInputs, size_t numSamples);
+
+    // Same layout as NeuralNetwork::predictBatch and predictInto.
+    template <typename T>
+    std::vector<T> predictBatch(const std::vector<T>& inputs, size_t numSamples) const;
+    template <typename T>
+    void predictInto(const T* input, T* output) const;
+
+    const CalibrationReport& getCalibrationReport() const;
+    size_t getNumInputs() const;
+    size_t getNumOutputs() const;
+    size_t getParameterBytes() const; // int8 weights plus float scales and biases
+
+private:
+    struct QuantizedLayer {
+        size_t numInputs = 0;
+        size_t numOutputs = 0;
+        size_t stride = 0; // numInputs rounded up to a paddedStride<std::int8_t>() value
+        float inverseInputScale = 1.0f; // quantized input = round(input * inverseInputScale)
+        AlignedVector<std::int8_t> weights; // [numOutputs x stride], padding is zero
+        std::vector<float> outputScales; // per row: weight scale * input scale
+        std::vector<float> biases;
+        kernels::Activation activation = kernels::Activation::Identity;
+        kernels::ActivationMode activationMode = kernels::ActivationMode::Exact;
+    };
+
+    // Per-thread scratch buffers, grown to the largest network used on the thread.
+    struct Scratch {
+        AlignedVector<std::int8_t> quantized;
+        std::vector<std::int32_t> accumulators;
+        std::vector<float> values; // dequantized layer outputs
+    };
+
+    std::vector<QuantizedLayer> layers_;
+    size_t numInputs_ = 0;
+    size_t numOutputs_ = 0;
+    size_t maxStride_ = 0;
+    size_t maxWidth_ = 0;
+    CalibrationReport report_;
+
+    template <typename T>
+    void forward(const T* input, T* output, Scratch& scratch) const;
+};
+
+#endif // QUANTIZED_NETWORK_H
@@ -0,0 +1,259 @@
+// running_stats.cpp
+#include "running_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // Sums over a full window: the current block up to the newest value (deviations from its first
+    // value) plus the previous block from the window start on (count deviations from its last value,
+    // larger by shift than from the current reference): S + count * shift and
+    // Q + 2 * shift * S + count * shift^2.
+    inline void combineBlocks(double prefix, double prefixSquares, double suffix, double suffixSquares,
+                              double count, double shift, double& sum, double& squares) {
+        sum = prefix + suffix + count * shift;
+        squares = prefixSquares + suffixSquares + 2.0 * shift * suffix + count * shift * shift;
+    }
+
+    inline void momentsFromSums(double reference, double sum, double squares, double inverseCount,
+                                double& mean, double& variance) {
+        const double m = sum * inverseCount;
+        mean = reference + m;
+        variance = std::max(squares * inverseCount - m * m, 0.0);
+    }
+
+    // Sums of block[j..size) as deviations from block[size - 1], for j from size - 1 down to first.
+    void suffixSums(const double* block, size_t size, size_t first, double* suffix, double* squares) {
+        const double reference = block[size - 1];
+        double sum = 0.0, sumSquares = 0.0;
+        for (size_t j = size; j-- > first;) {
+            const double d = block[j] - reference;
+            sum += d;
+            sumSquares += d * d;
+            suffix[j] = sum;
+            squares[j] = sumSquares;
+        }
+    }
+}
+
+RunningStats::RunningStats(Mode mode, double alpha, size_t window) :
+    mode_(mode), alpha_(alpha), window_(window)
+{
+    if (mode_ == Mode::Exponential && !(alpha_ > 0.0 && alpha_ <= 1.0)) {
+        throw std::invalid_argument("Exponential statistics need 0 < alpha <= 1.");
+    }
+    if (mode_ == Mode::Window) {
+        if (window_ == 0) {
+            throw std::invalid_argument("Window statistics need a window of at least one value.");
+        }
+        ring_.reserve(window_);
+        inverseWindow_ = 1.0 / static_cast<double>(window_);
+    }
+}
+
+void RunningStats::update(double value) {
+    switch (mode_) {
+        case Mode::Cumulative: {
+            ++count_;
+            const double delta = value - mean_;
+            mean_ += delta / static_cast<double>(count_);
+            m2_ += delta * (value - mean_);
+            break;
+        }
+        case Mode::Exponential: {
+            if (count_ == 0) {
+                mean_ = value;
+                m2_ = 0.0;
+                count_ = 1;
+                break;
+            }
+            const double delta = value - mean_;
+            const double increment = alpha_ * delta;
+            mean_ += increment;
+            m2_ = (1.0 - alpha_) * (m2_ + delta * increment);
+            ++count_;
+            break;
+        }
+        case Mode::Window: {
+            if (ring_.size() < window_) {
+                ring_.push_back(value);
+                count_ = ring_.size();
+                addToBlock(value, count_ - 1);
+                break;
+            }
+            // Full window: replace the oldest value; a new block starts every window_ values.
+            if (head_ == 0) {
+                startBlock(value);
+            }
+            ring_[head_] = value;
+            addToBlock(value, head_);
+            head_ = (head_ + 1) % window_;
+            break;
+        }
+    }
+}
+
+void RunningStats::startBlock(double first) {
+    // ring_ holds the block just completed, in order.
+    if (suffix_.empty()) {
+        suffix_.resize(window_);
+        suffixSquares_.resize(window_);
+    }
+    suffixSums(ring_.data(), window_, 1, suffix_.data(), suffixSquares_.data());
+    shift_ = ring_[window_ - 1] - first;
+}
+
+void RunningStats::addToBlock(double value, size_t position) {
+    if (position == 0) {
+        blockSum_ = 0.0;
+        blockSquares_ = 0.0;
+    }
+    const double reference = ring_[0];
+    const double d = value - reference;
+    blockSum_ += d;
+    blockSquares_ += d * d;
+    if (suffix_.empty()) {
+        // First block: the values so far.
+        momentsFromSums(reference, blockSum_, blockSquares_, 1.0 / static_cast<double>(position + 1), mean_, m2_);
+        return;
+    }
+    const bool spans = position + 1 < window_; // the last window of a block is the block itself
+    double sum, squares;
+    combineBlocks(blockSum_, blockSquares_, spans ? suffix_[position + 1] : 0.0, spans ? suffixSquares_[position + 1] : 0.0,
+                  spans ? static_cast<double>(window_ - 1 - position) : 0.0, shift_, sum, squares);
+    momentsFromSums(reference, sum, squares, inverseWindow_, mean_, m2_);
+}
+
+void RunningStats::restoreWindow() {
+    // The block sums follow from the ring: the current block is ring_[0..head_) and what the window
+    // still needs of the previous one is ring_[head_..window_).
+    count_ = ring_.size();
+    mean_ = 0.0;
+    m2_ = 0.0;
+    suffix_.clear();
+    suffixSquares_.clear();
+    size_t blockSize = ring_.size();
+    if (ring_.size() == window_ && head_ > 0) {
+        suffix_.resize(window_);
+        suffixSquares_.resize(window_);
+        suffixSums(ring_.data(), window_, head_, suffix_.data(), suffixSquares_.data());
+        shift_ = ring_[window_ - 1] - ring_[0];
+        blockSize = head_;
+    }
+    for (size_t j = 0; j < blockSize; ++j) {
+        addToBlock(ring_[j], j);
+    }
+}
+
+void RunningStats::windowBands(const double* x, size_t n, size_t window, double numStd, double* out) {
+    if (window == 0) {
+        throw std::invalid_argument("Window statistics need a window of at least one value.");
+    }
+    // The same sums in the same order as update(), a block at a time.
+    std::vector<double> suffix(window), suffixSquares(window);
+    const double inverseWindow = 1.0 / static_cast<double>(window);
+    for (size_t begin = 0; begin < n; begin += window) {
+        const size_t size = std::min(window, n - begin);
+        const double* block = x + begin;
+        const double reference = block[0];
+        double shift = 0.0;
+        if (begin > 0) {
+            suffixSums(block - window, window, 1, suffix.data(), suffixSquares.data());
+            shift = block[-1] - reference;
+        }
+        double blockSum = 0.0, blockSquares = 0.0;
+        for (size_t j = 0; j < size; ++j) {
+            const double d = block[j] - reference;
+            blockSum += d;
+            blockSquares += d * d;
+            double mean, variance;
+            if (begin == 0) {
+                momentsFromSums(reference, blockSum, blockSquares, 1.0 / static_cast<double>(j + 1), mean, variance);
+            } else {
+                const bool spans = j + 1 < window;
+                double sum, squares;
+                combineBlocks(blockSum, blockSquares, spans ? suffix[j + 1] : 0.0, spans ? suffixSquares[j + 1] : 0.0,
+                              spans ? static_cast<double>(window - 1 - j) : 0.0, shift, sum, squares);
+                momentsFromSums(reference, sum, squares, inverseWindow, mean, variance);
+            }
+            out[begin + j] = numStd != 0.0 ? mean + numStd * std::sqrt(variance) : mean;
+        }
+    }
+}
+
+void RunningStats::reset() {
+    count_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    ring_.clear();
+    head_ = 0;
+    blockSum_ = 0.0;
+    blockSquares_ = 0.0;
+    suffix_.clear();
+    suffixSquares_.clear();
+    shift_ = 0.0;
+}
+
+RunningStats::Mode RunningStats::getMode() const {
+    return mode_;
+}
+
+size_t RunningStats::getCount() const {
+    return count_;
+}
+
+double RunningStats::getMean() const {
+    return mean_;
+}
+
+double RunningStats::getVariance() const {
+    if (count_ == 0) {
+        return 0.0;
+    }
+    return mode_ == Mode::Cumulative ? m2_ / static_cast<double>(count_) : m2_;
+}
+
+double RunningStats::getStd() const {
+    return std::sqrt(getVariance());
+}
+
+void RunningStats::save(std::ostream& out) const {
+    const std::streamsize previousPrecision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << static_cast<int>(mode_) << " " << alpha_ << " " << window_ << " "
+        << count_ << " " << mean_ << " " << m2_ << " " << head_ << " " << ring_.size();
+    for (double value : ring_) {
+        out << " " << value;
+    }
+    out << "\n";
+    out.precision(previousPrecision);
+}
+
+void RunningStats::load(std::istream& in) {
+    int mode;
+    double alpha;
+    size_t window, count, head, ringSize;
+    double mean, m2;
+    if (!(in >> mode >> alpha >> window >> count >> mean >> m2 >> head >> ringSize) ||
+        mode < 0 || mode > static_cast<int>(Mode::Window)) {
+        throw std::runtime_error("Could not read normalization statistics.");
+    }
+
+    RunningStats loaded(static_cast<Mode>(mode), alpha, window);
+    if (ringSize > loaded.window_ || (ringSize > 0 && head >= ringSize)) {
+        throw std::runtime_error("Could not read normalization statistics.");
+    }
+    loaded.count_ = count;
+    loaded.mean_ = mean;
+    loaded.m2_ = m2;
+    loaded.head_ = head;
+    loaded.ring_.resize(ringSize);
+    for (double& value : loaded.ring_) {
+        if (!(in >> value)) {
+            throw std::runtime_error("Could not read normalization statistics.");
+        }
+    }
+    if (loaded.mode_ == Mode::Window) {
+        loaded.restoreWindow(); // the stored mean and variance are derived; older files kept a sum of squares
+    }
+    *this = std::move(loaded);
+}
@@ -0,0 +1,72 @@
+// running_stats.h
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+// Incremental mean/variance of one feature, updated in O(1) per value:
+//  - Cumulative: Welford's algorithm over every value seen so far.
+//  - Exponential: exponentially weighted mean/variance; each update moves the estimate by alpha.
+//  - Window: mean/variance of the last `window` values, kept in a ring buffer. The values are taken in
+//    blocks of `window`; sums over the current block so far and over the tail of the previous one
+//    add up to the sums of the window, so no running sum covers more than one block and rounding
+//    does not build up however long the stream (see windowBands).
+class RunningStats {
+public:
+    enum class Mode {
+        Cumulative,
+        Exponential,
+        Window
+    };
+
+    explicit RunningStats(Mode mode = Mode::Cumulative, double alpha = 0.05, size_t window = 0);
+
+    void update(double value);
+    void reset();
+
+    Mode getMode() const;
+    size_t getCount() const; // values currently contributing (at most the window size in Window mode)
+    double getMean() const;
+    double getVariance() const; // population variance
+    double getStd() const;
+
+    // Text form that round-trips exactly; used by the model files.
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // mean + numStd * std of every window of `window` values of x (over x[0..i] while i < window - 1),
+    // bit for bit what getMean() + numStd * getStd() gives after each update of a Window-mode
+    // instance fed x from its start. numStd = 0 gives the means. O(n), with O(window) scratch.
+    static void windowBands(const double* x, size_t n, size_t window, double numStd, double* out);
+
+private:
+    Mode mode_;
+    double alpha_;
+    size_t window_;
+
+    size_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0; // sum of squared deviations (Cumulative) or the variance itself (Exponential, Window)
+
+    std::vector<double> ring_; // Window: the last window_ values, oldest at head_ once full
+    size_t head_ = 0;          // Window: also the position in the current block, which starts at ring_[0]
+
+    // Window, all derived from ring_: sums of deviations from ring_[0] over the current block, and of
+    // deviations from the last value of the previous block over its suffixes, with that value's
+    // offset from ring_[0].
+    double blockSum_ = 0.0;
+    double blockSquares_ = 0.0;
+    std::vector<double> suffix_;
+    std::vector<double> suffixSquares_;
+    double shift_ = 0.0;
+    double inverseWindow_ = 0.0;
+
+    void startBlock(double first);
+    void addToBlock(double value, size_t position);
+    void restoreWindow();
+};
+
+#endif // RUNNING_STATS_H
@@ -0,0 +1,102 @@
+// snapshot_cell.h
+#ifndef SNAPSHOT_CELL_H
+#define SNAPSHOT_CELL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+// The current version of an immutable object, replaced by writers while readers keep using it
+// (read-copy-update). Readers never lock or wait: pin() counts the reader in one of two slots chosen
+// by an epoch and loads the current version, which stays valid until the pin is released. publish()
+// swaps in a new version, advances the epoch so later readers count in the other slot, and waits
+// until the slot of the previous epoch is empty; after that no reader can reach the old version and
+// the cell drops its reference. Copies taken with acquire() or Pin::shared() keep a version alive
+// beyond that, e.g. for state that spans calls.
+//
+// Publishing is for one writer at a time; callers serialize writers themselves. Readers must not
+// outlive the cell.
+template <typename T>
+class SnapshotCell {
+public:
+    using Pointer = std::shared_ptr<const T>;
+
+    // Read-side critical section; keep it short, since publish() waits for pins of the old epoch.
+    class Pin {
+    public:
+        explicit Pin(const SnapshotCell& cell) : cell_(cell) {
+            for (;;) {
+                const std::uint64_t epoch = cell.epoch_.load();
+                slot_ = static_cast<size_t>(epoch & 1);
+                cell.readers_[slot_].count.fetch_add(1);
+                if (cell.epoch_.load() == epoch) {
+                    break;
+                }
+                // A writer advanced the epoch in between and may not have seen this reader; retry
+                // in the new slot.
+                cell.readers_[slot_].count.fetch_sub(1, std::memory_order_release);
+            }
+            holder_ = cell.current_.load();
+        }
+
+        ~Pin() {
+            cell_.readers_[slot_].count.fetch_sub(1, std::memory_order_release);
+        }
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+
+        const T* get() const { return holder_->get(); }
+        const T* operator->() const { return get(); }
+        const T& operator*() const { return *get(); }
+        explicit operator bool() const { return get() != nullptr; }
+        // A reference that outlives the pin.
+        const Pointer& shared() const { return *holder_; }
+
+    private:
+        const SnapshotCell& cell_;
+        size_t slot_ = 0;
+        const Pointer* holder_ = nullptr;
+    };
+
+    explicit SnapshotCell(Pointer initial = nullptr) : current_(new Pointer(std::move(initial))) {}
+
+    ~SnapshotCell() {
+        delete current_.load();
+    }
+
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    Pin pin() const {
+        return Pin(*this);
+    }
+
+    Pointer acquire() const {
+        Pin pin(*this);
+        return pin.shared();
+    }
+
+    // Makes next the current version and returns once no pin can still reach the previous one.
+    void publish(Pointer next) {
+        const Pointer* previous = current_.exchange(new Pointer(std::move(next)));
+        const std::uint64_t epoch = epoch_.fetch_add(1);
+        // Readers that pinned before the epoch advanced are counted in its slot; later ones see next.
+        while (readers_[epoch & 1].count.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        delete previous;
+    }
+
+private:
+    struct alignas(64) ReaderCount {
+        std::atomic<std::int64_t> count{0};
+    };
+
+    std::atomic<const Pointer*> current_;
+    std::atomic<std::uint64_t> epoch_{0};
+    mutable ReaderCount readers_[2]; // on separate cache lines
+};
+
+#endif // SNAPSHOT_CELL_H
@@ -0,0 +1,32 @@
+// span.h
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <type_traits>
+
+// Non-owning view over contiguous elements, modelled on C++20 std::span for this C++17 code base.
+// A view does not keep its storage alive and is invalidated when that storage reallocates.
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, size_t size) : data_(data), size_(size) {}
+
+    // Span<double> converts to Span<const double>.
+    template <typename U, typename = std::enable_if_t<std::is_convertible<U (*)[], T (*)[]>::value>>
+    Span(const Span<U>& other) : data_(other.data()), size_(other.size()) {}
+
+    T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) const { return data_[i]; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // SPAN_H
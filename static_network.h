@@ -0,0 +1,236 @@
+// static_network.h
+#ifndef STATIC_NETWORK_H
+#define STATIC_NETWORK_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "math_kernels.h"
+#include "neural_network.h"
+
+// Dense layer with compile-time dimensions and inline storage. Weights are kept input-major
+// (weights[j * NumOutputs + r] connects input j to output r), so the forward pass is a chain of
+// NumInputs fused multiply-adds over the whole output vector, which the compiler unrolls and
+// vectorizes without reordering any output's sum.
+template <typename T, size_t NumInputs, size_t NumOutputs>
+struct StaticLayerT {
+    static_assert(NumInputs > 0 && NumOutputs > 0, "Layer dimensions must be positive.");
+
+    static constexpr size_t kNumInputs = NumInputs;
+    static constexpr size_t kNumOutputs = NumOutputs;
+
+    alignas(64) std::array<T, NumInputs * NumOutputs> weights{};
+    alignas(64) std::array<T, NumOutputs> biases{};
+    kernels::Activation activation = kernels::Activation::Identity;
+
+    // Layers with at most this many weights are unrolled completely; larger ones loop over blocks of
+    // kPartials inputs, which keeps their code size and compile time in proportion to NumOutputs.
+    static constexpr size_t kUnrollLimit = 1024;
+    static constexpr size_t kOutputBytes = NumOutputs * sizeof(T);
+    static constexpr size_t kPartials = kOutputBytes <= 64 ? (NumInputs >= 4 ? 4 : NumInputs)
+                                      : kOutputBytes <= 128 && NumInputs >= 2 ? 2 : 1;
+
+    // Copies the parameters of a dynamic layer, rounded to T. Throws std::invalid_argument if its
+    // dimensions differ.
+    template <typename U>
+    void assign(const LayerT<U>& source) {
+        if (source.getInputSize() != NumInputs || source.getOutputSize() != NumOutputs) {
+            throw std::invalid_argument("Layer dimensions do not match the static network.");
+        }
+        for (size_t r = 0; r < NumOutputs; ++r) {
+            const U* row = source.getWeightData() + r * source.getWeightStride();
+            for (size_t j = 0; j < NumInputs; ++j) {
+                weights[j * NumOutputs + r] = static_cast<T>(row[j]);
+            }
+            biases[r] = static_cast<T>(source.getBiasData()[r]);
+        }
+        activation = source.getKernelActivation();
+    }
+
+    void forward(const T* input, T* output, kernels::ActivationMode mode) const {
+        // Each output's sum is a chain of dependent multiply-adds, so for narrow layers the inputs are
+        // split round-robin over kPartials independent sums (as many as fit in about eight 32-byte
+        // registers), combined at the end. The loops are unrolled through index sequences rather than
+        // left to the optimizer, so every sum is addressed by a constant and the compiler keeps them in
+        // vector registers even at -O2.
+        T partial[kPartials][NumOutputs];
+        initialize(partial, std::make_index_sequence<NumOutputs>());
+        accumulateInputs(partial, input);
+        combine(partial, std::make_index_sequence<NumOutputs>());
+        T* sums = partial[0];
+        switch (activation) {
+            case kernels::Activation::Identity:
+                break;
+            case kernels::Activation::ReLU:
+                relu(sums, std::make_index_sequence<NumOutputs>());
+                break;
+            default:
+                kernels::applyActivation(sums, NumOutputs, activation, mode);
+                break;
+        }
+        store(sums, output, std::make_index_sequence<NumOutputs>());
+    }
+
+private:
+    using Partials = T[kPartials][NumOutputs];
+
+    template <size_t... R>
+    void initialize(Partials& partial, std::index_sequence<R...>) const {
+        ((partial[0][R] = biases[R]), ...);
+        for (size_t p = 1; p < kPartials; ++p) {
+            ((partial[p][R] = T(0)), ...);
+        }
+    }
+
+    void accumulateInputs(Partials& partial, const T* input) const {
+        if constexpr (NumInputs * NumOutputs <= kUnrollLimit) {
+            accumulateAll(partial, input, std::make_index_sequence<NumInputs>());
+            return;
+        }
+        constexpr size_t blocked = NumInputs / kPartials * kPartials;
+        for (size_t j = 0; j < blocked; j += kPartials) {
+            accumulateBlock(partial, input + j, weights.data() + j * NumOutputs, std::make_index_sequence<kPartials>());
+        }
+        for (size_t j = blocked; j < NumInputs; ++j) {
+            accumulate(partial[0], input[j], weights.data() + j * NumOutputs, std::make_index_sequence<NumOutputs>());
+        }
+    }
+
+    template <size_t... J>
+    void accumulateAll(Partials& partial, const T* input, std::index_sequence<J...>) const {
+        (accumulate(partial[J % kPartials], input[J], weights.data() + J * NumOutputs, std::make_index_sequence<NumOutputs>()), ...);
+    }
+
+    // Input p of the block goes to partial sum p.
+    template <size_t... P>
+    static void accumulateBlock(Partials& partial, const T* input, const T* columns, std::index_sequence<P...>) {
+        (accumulate(partial[P], input[P], columns + P * NumOutputs, std::make_index_sequence<NumOutputs>()), ...);
+    }
+
+    template <size_t... R>
+    static void accumulate(T* sums, T x, const T* column, std::index_sequence<R...>) {
+        ((sums[R] += column[R] * x), ...);
+    }
+
+    template <size_t... R>
+    static void combine(Partials& partial, std::index_sequence<R...>) {
+        for (size_t p = 1; p < kPartials; ++p) {
+            ((partial[0][R] += partial[p][R]), ...);
+        }
+    }
+
+    template <size_t... R>
+    static void relu(T* sums, std::index_sequence<R...>) {
+        ((sums[R] = sums[R] > T(0) ? sums[R] : T(0)), ...);
+    }
+
+    template <size_t... R>
+    static void store(const T* sums, T* output, std::index_sequence<R...>) {
+        ((output[R] = sums[R]), ...);
+    }
+};
+
+namespace static_network_detail {
+
+    template <size_t I, size_t... Sizes>
+    constexpr size_t dimension() {
+        return std::get<I>(std::array<size_t, sizeof...(Sizes)>{{Sizes...}});
+    }
+
+    template <typename T, typename Indices, size_t... Sizes>
+    struct LayerTuple;
+
+    template <typename T, size_t... I, size_t... Sizes>
+    struct LayerTuple<T, std::index_sequence<I...>, Sizes...> {
+        using type = std::tuple<StaticLayerT<T, dimension<I, Sizes...>(), dimension<I + 1, Sizes...>()>...>;
+    };
+
+}
+
+// Feed-forward network whose topology is fixed at compile time: StaticNetworkT<T, 4, 16, 8, 1> has
+// 4 inputs, hidden layers of 16 and 8 and one output. All parameters live inside the object and the
+// intermediate activations on the stack, so a prediction does not allocate, check sizes or loop
+// over a runtime layer count. Meant for small production topologies; large ones belong in
+// NeuralNetworkT, whose blocked kernels scale better and whose parameters live on the heap.
+//
+// Built from a trained or loaded NeuralNetworkT of the same shape. Outputs agree with
+// NeuralNetworkT::predictInto up to rounding, as the sums are accumulated in a different order.
+template <typename T, size_t... Sizes>
+class StaticNetworkT {
+    static_assert(sizeof...(Sizes) >= 2, "A static network needs at least an input and an output size.");
+
+public:
+    using Scalar = T;
+
+    static constexpr size_t kNumLayers = sizeof...(Sizes) - 1;
+    static constexpr size_t kNumInputs = static_network_detail::dimension<0, Sizes...>();
+    static constexpr size_t kNumOutputs = static_network_detail::dimension<kNumLayers, Sizes...>();
+
+    StaticNetworkT() = default;
+
+    // Copies parameters, activations and activation mode. Throws std::invalid_argument unless network
+    // has exactly this topology.
+    template <typename U>
+    explicit StaticNetworkT(const NeuralNetworkT<U>& network) : mode_(network.getActivationMode()) {
+        if (network.getLayers().size() != kNumLayers) {
+            throw std::invalid_argument("Network topology does not match the static network.");
+        }
+        assignLayers(network.getLayers(), std::make_index_sequence<kNumLayers>());
+    }
+
+    // Reads kNumInputs values from input and writes kNumOutputs values to output.
+    void predictInto(const T* input, T* output) const {
+        forwardFrom<0>(input, output);
+    }
+
+    std::array<T, kNumOutputs> predict(const std::array<T, kNumInputs>& input) const {
+        std::array<T, kNumOutputs> output;
+        forwardFrom<0>(input.data(), output.data());
+        return output;
+    }
+
+    // Row-major numSamples x kNumInputs in, numSamples x kNumOutputs out.
+    void predictBatch(const T* inputs, size_t numSamples, T* outputs) const {
+        for (size_t i = 0; i < numSamples; ++i) {
+            forwardFrom<0>(inputs + i * kNumInputs, outputs + i * kNumOutputs);
+        }
+    }
+
+    void setActivationMode(kernels::ActivationMode mode) { mode_ = mode; }
+    kernels::ActivationMode getActivationMode() const { return mode_; }
+
+    template <size_t I>
+    auto& getLayer() { return std::get<I>(layers_); }
+    template <size_t I>
+    const auto& getLayer() const { return std::get<I>(layers_); }
+
+private:
+    typename static_network_detail::LayerTuple<T, std::make_index_sequence<kNumLayers>, Sizes...>::type layers_;
+    kernels::ActivationMode mode_ = kernels::ActivationMode::Exact;
+
+    template <typename U, size_t... I>
+    void assignLayers(const std::vector<LayerT<U>>& layers, std::index_sequence<I...>) {
+        (std::get<I>(layers_).assign(layers[I]), ...);
+    }
+
+    template <size_t I>
+    void forwardFrom(const T* input, T* output) const {
+        const auto& layer = std::get<I>(layers_);
+        if constexpr (I + 1 == kNumLayers) {
+            layer.forward(input, output, mode_);
+        } else {
+            alignas(64) T hidden[std::tuple_element_t<I, decltype(layers_)>::kNumOutputs];
+            layer.forward(input, hidden, mode_);
+            forwardFrom<I + 1>(hidden, output);
+        }
+    }
+};
+
+template <size_t... Sizes>
+using StaticNetwork = StaticNetworkT<double, Sizes...>;
+template <size_t... Sizes>
+using StaticNetworkF = StaticNetworkT<float, Sizes...>;
+
+#endif // STATIC_NETWORK_H
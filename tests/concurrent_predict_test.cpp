@@ -0,0 +1,141 @@
+// concurrent_predict_test.cpp
+//
+// Stress test for prediction from many threads on one shared network. Expected outputs are computed
+// on one thread first; then every thread runs a mix of predict, predictInto (per-thread and explicit
+// workspace) and predictBatch over the same samples in its own order, and each result must equal
+// the single-threaded one bit for bit. Covers double and float networks. Prints one line per case and
+// exits with 1 on any difference.
+//
+// Built on its own, like the benchmarks; from the repository root:
+//   g++ -std=c++17 -O2 -mavx2 -mfma -pthread -I. tests/concurrent_predict_test.cpp $(ls *.cpp | grep -v '^main.cpp$') -o nn_concurrent_predict_test
+//   cl /std:c++17 /O2 /arch:AVX2 /EHsc /I. tests\concurrent_predict_test.cpp <every .cpp except main.cpp>
+// or as the nn_concurrent_predict_test target of CMakeLists.txt, which also registers it with ctest.
+//
+// Usage: nn_concurrent_predict_test [--threads <count>] [--rounds <count>]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "neural_network.h"
+
+namespace {
+
+    const size_t kNumSamples = 256;
+    const size_t kBatchSize = 37; // not a multiple of any kernel block, so partial blocks are exercised
+
+    template <typename T>
+    NeuralNetworkT<T> makeNetwork() {
+        NeuralNetworkT<T> network(16, 3);
+        network.addLayer(64, ActivationType::ReLU);
+        network.addLayer(32, ActivationType::Tanh);
+        network.addLayer(16, ActivationType::Sigmoid);
+        network.addLayer(3, ActivationType::Linear);
+        return network;
+    }
+
+    template <typename T>
+    bool sameBits(const T* a, const T* b, size_t n) {
+        return std::memcmp(a, b, n * sizeof(T)) == 0;
+    }
+
+    // Mismatching results over all threads and rounds.
+    template <typename T>
+    size_t runCase(const std::string& name, size_t numThreads, size_t numRounds) {
+        const NeuralNetworkT<T> network = makeNetwork<T>();
+        const size_t numInputs = network.getNumInputs();
+        const size_t numOutputs = network.getNumOutputs();
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> value(-2.0, 2.0);
+        std::vector<T> inputs(kNumSamples * numInputs);
+        for (auto& x : inputs) {
+            x = static_cast<T>(value(rng));
+        }
+
+        // Reference: each path on its own, single-threaded.
+        std::vector<T> expected(kNumSamples * numOutputs);
+        for (size_t i = 0; i < kNumSamples; ++i) {
+            network.predictInto(inputs.data() + i * numInputs, expected.data() + i * numOutputs);
+        }
+        std::vector<T> expectedBatches(kNumSamples * numOutputs);
+        for (size_t start = 0; start < kNumSamples; start += kBatchSize) {
+            const size_t count = std::min(kBatchSize, kNumSamples - start);
+            const std::vector<T> outputs = network.predictBatch(inputs.data() + start * numInputs, count, numInputs);
+            std::copy(outputs.begin(), outputs.end(), expectedBatches.begin() + start * numOutputs);
+        }
+
+        std::atomic<size_t> mismatches{0};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t] {
+                InferenceWorkspaceT<T> workspace = network.createWorkspace();
+                std::vector<T> output(numOutputs);
+                std::mt19937 order(static_cast<unsigned>(t));
+                std::uniform_int_distribution<size_t> pick(0, kNumSamples - 1);
+                size_t local = 0;
+                for (size_t round = 0; round < numRounds; ++round) {
+                    for (size_t k = 0; k < kNumSamples; ++k) {
+                        const size_t i = pick(order);
+                        const T* input = inputs.data() + i * numInputs;
+                        const T* reference = expected.data() + i * numOutputs;
+                        switch ((k + t) % 4) {
+                            case 0: {
+                                const std::vector<T> result = network.predict(std::vector<T>(input, input + numInputs));
+                                local += sameBits(result.data(), reference, numOutputs) ? 0 : 1;
+                                break;
+                            }
+                            case 1:
+                                network.predictInto(input, output.data());
+                                local += sameBits(output.data(), reference, numOutputs) ? 0 : 1;
+                                break;
+                            case 2:
+                                network.predictInto(input, output.data(), workspace);
+                                local += sameBits(output.data(), reference, numOutputs) ? 0 : 1;
+                                break;
+                            default: {
+                                const size_t start = i / kBatchSize * kBatchSize;
+                                const size_t count = std::min(kBatchSize, kNumSamples - start);
+                                const std::vector<T> result = network.predictBatch(inputs.data() + start * numInputs, count, numInputs);
+                                local += sameBits(result.data(), expectedBatches.data() + start * numOutputs, count * numOutputs) ? 0 : 1;
+                                break;
+                            }
+                        }
+                    }
+                }
+                mismatches += local;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::printf("%s: %zu threads x %zu rounds, %zu mismatches\n", name.c_str(), numThreads, numRounds, mismatches.load());
+        return mismatches.load();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t numThreads = std::max(4u, std::thread::hardware_concurrency());
+    size_t numRounds = 20;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--threads") == 0) {
+            numThreads = std::max<size_t>(1, std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--rounds") == 0) {
+            numRounds = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    const size_t mismatches = runCase<double>("concurrent_predict", numThreads, numRounds) +
+                              runCase<float>("concurrent_predict_float", numThreads, numRounds);
+    if (mismatches > 0) {
+        std::fprintf(stderr, "%zu concurrent predictions differ from the single-threaded ones.\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
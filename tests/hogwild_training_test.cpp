@@ -0,0 +1,106 @@
+// hogwild_training_test.cpp
+//
+// Checks the optimizer step count after Hogwild epochs: each epoch must advance it by the thread
+// count times the batches in the largest slice of samples, and synchronous training by the batches
+// in the data. With one thread, Hogwild runs the same steps as synchronous training, so training the
+// same network both ways with Adam over several epochs must give the same weights bit for bit; a
+// step count that drifts changes Adam's bias correction from the second epoch on. Prints one line per
+// case and exits with 1 on any failure.
+//
+// Built on its own, like the benchmarks; from the repository root:
+//   g++ -std=c++17 -O2 -mavx2 -mfma -pthread -I. tests/hogwild_training_test.cpp $(ls *.cpp | grep -v '^main.cpp$') -o nn_hogwild_training_test
+//   cl /std:c++17 /O2 /arch:AVX2 /EHsc /I. tests\hogwild_training_test.cpp <every .cpp except main.cpp>
+// or as the nn_hogwild_training_test target of CMakeLists.txt, which also registers it with ctest.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "neural_network.h"
+
+namespace {
+
+    const size_t kEpochs = 3;
+
+    DataStorage makeBars(size_t numBars) {
+        std::mt19937 rng(11);
+        std::normal_distribution<double> step(0.0, 0.01);
+        DataStorage storage;
+        double price = 1.0;
+        for (size_t i = 0; i < numBars; ++i) {
+            const double open = price;
+            price += step(rng);
+            storage.addBarData(open, price, std::max(open, price) + std::fabs(step(rng)), std::min(open, price) - std::fabs(step(rng)));
+        }
+        return storage;
+    }
+
+    NeuralNetwork makeNetwork() {
+        NeuralNetwork network(4, 1);
+        network.addLayer(8, ActivationType::Tanh);
+        network.addLayer(1, ActivationType::Linear);
+        OptimizerConfig config;
+        config.type = OptimizerType::Adam;
+        network.setOptimizer(config);
+        return network;
+    }
+
+    // Trains kEpochs epochs and compares the step count with stepsPerEpoch per epoch.
+    bool checkSteps(size_t numSamples, size_t numThreads, size_t batchSize, bool hogwild, size_t stepsPerEpoch) {
+        const DataStorage bars = makeBars(numSamples);
+        NeuralNetwork network = makeNetwork();
+        network.setBatchSize(batchSize);
+        network.setTrainingThreads(numThreads);
+        network.setHogwild(hogwild);
+        network.train(bars, kEpochs, 0.001);
+
+        const size_t steps = network.getOptimizer().getStepCount();
+        const bool ok = steps == kEpochs * stepsPerEpoch;
+        std::printf("%s %zu samples, %zu threads, batch %zu: %zu steps after %zu epochs, expected %zu%s\n",
+                    hogwild ? "hogwild" : "synchronous", numSamples, numThreads, batchSize, steps, kEpochs,
+                    kEpochs * stepsPerEpoch, ok ? "" : "  FAILED");
+        return ok;
+    }
+
+    bool sameParameters(const NeuralNetwork& a, const NeuralNetwork& b) {
+        for (size_t i = 0; i < a.getLayers().size(); ++i) {
+            const Layer& x = a.getLayers()[i];
+            const Layer& y = b.getLayers()[i];
+            const size_t size = x.getOutputSize() * x.getWeightStride();
+            if (std::memcmp(x.getWeightData(), y.getWeightData(), size * sizeof(double)) != 0 ||
+                std::memcmp(x.getBiasData(), y.getBiasData(), x.getOutputSize() * sizeof(double)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool checkSingleThreadMatchesSynchronous() {
+        const DataStorage bars = makeBars(96); // 6 batches of 16
+        NeuralNetwork synchronous = makeNetwork();
+        NeuralNetwork hogwild = synchronous;
+        synchronous.setBatchSize(16);
+        hogwild.setBatchSize(16);
+        hogwild.setHogwild(true);
+        synchronous.train(bars, kEpochs, 0.001);
+        hogwild.train(bars, kEpochs, 0.001);
+
+        const bool ok = sameParameters(synchronous, hogwild);
+        std::printf("hogwild with 1 thread matches synchronous Adam over %zu epochs: %s\n", kEpochs, ok ? "yes" : "no  FAILED");
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    ok &= checkSteps(64, 1, 64, true, 1);
+    ok &= checkSteps(64, 2, 16, true, 4);   // slices of 32: 2 batches each
+    ok &= checkSteps(100, 3, 8, true, 15);  // largest slice 34: 5 batches
+    ok &= checkSteps(10, 4, 4, true, 4);    // slices of 2 or 3: 1 batch each
+    ok &= checkSteps(100, 1, 8, false, 13);
+    ok &= checkSteps(100, 3, 8, false, 13);
+    ok &= checkSingleThreadMatchesSynchronous();
+    return ok ? 0 : 1;
+}
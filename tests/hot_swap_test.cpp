@@ -0,0 +1,201 @@
+// hot_swap_test.cpp
+//
+// Prediction latency while the model is replaced over and over. Two models are saved to files
+// (one text, one binary); reader threads predict with processData and onBar while a writer loads the
+// files alternately, with load and loadAsync. Every prediction must come entirely from one of the two
+// models. Prints one JSON object per line:
+//   name, calls, swaps, p50_ns, p99_ns, p999_ns, max_ns
+// per call (on_bar, process_data), first for a phase without swaps, then for the phase with them,
+// and exits with 1 on a wrong prediction or a lost swap.
+//
+// Built on its own, like the benchmarks; from the repository root:
+//   g++ -std=c++17 -O2 -mavx2 -mfma -pthread -I. tests/hot_swap_test.cpp $(ls *.cpp | grep -v '^main.cpp$') -o nn_hot_swap_test
+//   cl /std:c++17 /O2 /arch:AVX2 /EHsc /I. tests\hot_swap_test.cpp <every .cpp except main.cpp>
+// or as the nn_hot_swap_test target of CMakeLists.txt, which also registers it with ctest.
+//
+// Usage: nn_hot_swap_test [--swaps <count>] [--readers <threads>]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "network_model.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    const char* const kTextModel = "hot_swap_a.model";
+    const char* const kBinaryModel = "hot_swap_b.nnb";
+
+    std::vector<BarData> makeBars(size_t numBars, std::mt19937& rng) {
+        std::normal_distribution<double> step(0.0, 1.0);
+        std::vector<BarData> bars;
+        bars.reserve(numBars);
+        double price = 1000.0;
+        for (size_t i = 0; i < numBars; ++i) {
+            const double open = price;
+            price += step(rng);
+            const double close = price;
+            bars.emplace_back(open, close, std::max(open, close) + std::fabs(step(rng)), std::min(open, close) - std::fabs(step(rng)));
+        }
+        return bars;
+    }
+
+    // Outputs of the model in filename for every bar, from a model of its own.
+    std::vector<double> expectedOutputs(const char* filename, const std::vector<BarData>& bars) {
+        NetworkModel model;
+        model.load(filename);
+        return model.processData(bars, {}, false, false);
+    }
+
+    struct Phase {
+        std::vector<std::int64_t> onBar; // ns per call, from all readers
+        std::vector<std::int64_t> processData;
+        size_t failures = 0;
+    };
+
+    void report(const std::string& name, std::vector<std::int64_t>& latencies, size_t swaps) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+        };
+        std::printf("{\"name\": \"%s\", \"calls\": %zu, \"swaps\": %zu, \"p50_ns\": %lld, \"p99_ns\": %lld, "
+                    "\"p999_ns\": %lld, \"max_ns\": %lld}\n",
+                    name.c_str(), latencies.size(), swaps, static_cast<long long>(percentile(0.5)),
+                    static_cast<long long>(percentile(0.99)), static_cast<long long>(percentile(0.999)),
+                    static_cast<long long>(latencies.empty() ? 0 : latencies.back()));
+        std::fflush(stdout);
+    }
+
+    // Runs readers until stop is set: the first streams bars through onBar, the others predict the
+    // whole history with processData. Each result must match model A or model B exactly.
+    Phase runReaders(NetworkModel& model, size_t numReaders, const std::vector<BarData>& bars,
+                     const std::vector<double>& expectedA, const std::vector<double>& expectedB,
+                     const std::atomic<bool>& stop) {
+        std::vector<Phase> perReader(numReaders);
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < numReaders; ++r) {
+            readers.emplace_back([&, r] {
+                Phase& phase = perReader[r];
+                size_t bar = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto start = Clock::now();
+                    bool matches;
+                    if (r == 0) {
+                        const double prediction = model.onBar(bars[bar], nullptr);
+                        matches = prediction == expectedA[bar] || prediction == expectedB[bar];
+                        bar = (bar + 1) % bars.size();
+                    } else {
+                        const std::vector<double> predictions = model.processData(bars, {}, false, false);
+                        matches = predictions == expectedA || predictions == expectedB;
+                    }
+                    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                    (r == 0 ? phase.onBar : phase.processData).push_back(ns);
+                    phase.failures += matches ? 0 : 1;
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        Phase total;
+        for (auto& phase : perReader) {
+            total.onBar.insert(total.onBar.end(), phase.onBar.begin(), phase.onBar.end());
+            total.processData.insert(total.processData.end(), phase.processData.begin(), phase.processData.end());
+            total.failures += phase.failures;
+        }
+        return total;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t numSwaps = 200;
+    size_t numReaders = 3;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--swaps") == 0) {
+            numSwaps = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--readers") == 0) {
+            numReaders = std::max<size_t>(1, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::mt19937 rng(42);
+    const std::vector<BarData> bars = makeBars(64, rng);
+
+    // Two models of the same shape; their weights come from std::random_device and differ.
+    for (const char* filename : {kTextModel, kBinaryModel}) {
+        NetworkModel source;
+        source.initialize(4, 1, DataNormalization::NormalizationType::MinMax, "1.0");
+        source.addLayer(32, ActivationType::ReLU);
+        source.addLayer(32, ActivationType::ReLU);
+        source.addLayer(1, ActivationType::Linear);
+        if (filename == kTextModel) {
+            source.save(filename);
+        } else {
+            source.saveBinary(filename);
+        }
+    }
+    const std::vector<double> expectedA = expectedOutputs(kTextModel, bars);
+    const std::vector<double> expectedB = expectedOutputs(kBinaryModel, bars);
+    if (expectedA == expectedB) {
+        std::fprintf(stderr, "The two models predict the same; cannot tell them apart.\n");
+        return 1;
+    }
+
+    NetworkModel model;
+    model.load(kTextModel);
+
+    std::atomic<bool> stop{false};
+    std::thread timer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        stop = true;
+    });
+    Phase steady = runReaders(model, numReaders, bars, expectedA, expectedB, stop);
+    timer.join();
+    report("on_bar_steady", steady.onBar, 0);
+    report("process_data_steady", steady.processData, 0);
+
+    const std::uint64_t versionBefore = model.getVersion();
+    stop = false;
+    std::thread writer([&] {
+        for (size_t i = 0; i < numSwaps; ++i) {
+            const char* filename = i % 2 == 0 ? kBinaryModel : kTextModel;
+            if (i % 4 == 3) {
+                model.loadAsync(filename);
+                model.waitForLoad();
+            } else {
+                model.load(filename);
+            }
+        }
+        stop = true;
+    });
+    Phase swapping = runReaders(model, numReaders, bars, expectedA, expectedB, stop);
+    writer.join();
+    report("on_bar_during_swaps", swapping.onBar, numSwaps);
+    report("process_data_during_swaps", swapping.processData, numSwaps);
+
+    std::remove(kTextModel);
+    std::remove(kBinaryModel);
+
+    bool ok = true;
+    if (steady.failures + swapping.failures > 0) {
+        std::fprintf(stderr, "%zu predictions matched neither model.\n", steady.failures + swapping.failures);
+        ok = false;
+    }
+    if (model.getVersion() != versionBefore + numSwaps) {
+        std::fprintf(stderr, "Expected %zu new versions, found %llu.\n", numSwaps,
+                     static_cast<unsigned long long>(model.getVersion() - versionBefore));
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
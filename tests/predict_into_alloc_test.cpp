@@ -0,0 +1,85 @@
+// predict_into_alloc_test.cpp
+//
+// Checks that predictInto does not allocate once warmed up. Every global operator new in the
+// process is counted; after one warm-up call per path, a run of predictInto calls with the
+// per-thread workspace and with an explicit one must not add to the count. Covers double and float
+// networks. Prints one line per case and exits with 1 if any of them allocated.
+//
+// Built on its own, like the benchmarks; from the repository root:
+//   g++ -std=c++17 -O2 -mavx2 -mfma -pthread -I. tests/predict_into_alloc_test.cpp $(ls *.cpp | grep -v '^main.cpp$') -o nn_predict_into_alloc_test
+//   cl /std:c++17 /O2 /arch:AVX2 /EHsc /I. tests\predict_into_alloc_test.cpp <every .cpp except main.cpp>
+// or as the nn_predict_into_alloc_test target of CMakeLists.txt, which also registers it with ctest.
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "counted_allocation.h"
+#include "neural_network.h"
+
+namespace {
+    std::atomic<std::size_t> g_allocations{0};
+
+    void countAllocation(std::size_t) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+NN_DEFINE_COUNTED_NEW(countAllocation)
+
+namespace {
+
+    const size_t kCalls = 1000;
+
+    // Allocations made by kCalls calls of predict after one warm-up call; prints the case.
+    template <typename Predict>
+    size_t countAllocations(const std::string& name, Predict predict) {
+        predict();
+        const size_t before = g_allocations.load();
+        for (size_t i = 0; i < kCalls; ++i) {
+            predict();
+        }
+        const size_t allocations = g_allocations.load() - before;
+        std::printf("%s: %zu allocations in %zu calls\n", name.c_str(), allocations, kCalls);
+        return allocations;
+    }
+
+    template <typename T>
+    size_t checkNetwork(const std::string& suffix) {
+        NeuralNetworkT<T> network(8, 2);
+        network.addLayer(32, ActivationType::ReLU);
+        network.addLayer(16, ActivationType::Tanh);
+        network.addLayer(2, ActivationType::Linear);
+
+        std::vector<T> input(network.getNumInputs(), T(0.5));
+        std::vector<T> output(network.getNumOutputs());
+        InferenceWorkspaceT<T> workspace = network.createWorkspace();
+
+        size_t allocations = countAllocations("predict_into" + suffix, [&] {
+            network.predictInto(input.data(), output.data());
+        });
+        allocations += countAllocations("predict_into_workspace" + suffix, [&] {
+            network.predictInto(input.data(), output.data(), workspace);
+        });
+        return allocations;
+    }
+}
+
+int main() {
+    // predict returns a new vector; if that is not counted the check below proves nothing.
+    NeuralNetwork probe(4, 1);
+    probe.addLayer(1, ActivationType::Linear);
+    const size_t probeBefore = g_allocations.load();
+    const std::vector<double> probeOutput = probe.predict(std::vector<double>(4, 0.0));
+    if (g_allocations.load() == probeBefore) {
+        std::fprintf(stderr, "Allocations are not being counted.\n");
+        return 1;
+    }
+
+    const size_t allocations = checkNetwork<double>("") + checkNetwork<float>("_float");
+    if (allocations > 0) {
+        std::fprintf(stderr, "predictInto allocated %zu times after warm-up.\n", allocations);
+        return 1;
+    }
+    return 0;
+}
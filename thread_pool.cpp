@@ -0,0 +1,86 @@
+// thread_pool.cpp
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    if (numThreads == 0) {
+        throw std::invalid_argument("Thread count must be greater than zero.");
+    }
+    workers_.reserve(numThreads - 1);
+    for (size_t i = 1; i < numThreads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    startCondition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::getThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::run(const std::function<void(size_t)>& task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    startCondition_.notify_all();
+
+    try {
+        task(0);
+    } catch (...) {
+        recordError();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCondition_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    size_t seenGeneration = 0;
+    for (;;) {
+        const std::function<void(size_t)>* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            startCondition_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+            if (stopping_) {
+                return;
+            }
+            seenGeneration = generation_;
+            task = task_;
+        }
+
+        try {
+            (*task)(index);
+        } catch (...) {
+            recordError();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_;
+        }
+        doneCondition_.notify_one();
+    }
+}
+
+void ThreadPool::recordError() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+        error_ = std::current_exception();
+    }
+}
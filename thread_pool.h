@@ -0,0 +1,44 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool for fork-join loops. run() hands every thread the same task with its
+// own index and blocks until all of them return; index 0 runs on the calling thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getThreadCount() const;
+
+    // Calls task(t) for every t in [0, getThreadCount()). The first exception thrown by a task
+    // is rethrown here after all threads have finished.
+    void run(const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable startCondition_;
+    std::condition_variable doneCondition_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t generation_ = 0;
+    size_t pending_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+
+    void workerLoop(size_t index);
+    void recordError();
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,82 @@
+// training_workspace.cpp
+#include "training_workspace.h"
+#include <algorithm>
+
+template <typename T>
+void TrainingWorkspaceT<T>::reserve(const std::vector<LayerT<T>>& layers, size_t batchSize) {
+    batchCapacity_ = std::max(batchCapacity_, batchSize);
+
+    activations_.resize(layers.size());
+    deltas_.resize(layers.size());
+    gradients_.resize(layers.size());
+    biasOffsets_.resize(layers.size());
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const size_t width = layers[i].getOutputSize();
+        if (activations_[i].size() < batchCapacity_ * width) {
+            activations_[i].resize(batchCapacity_ * width);
+            deltas_[i].resize(batchCapacity_ * width);
+        }
+
+        const size_t biasOffset = width * layers[i].getWeightStride();
+        if (biasOffsets_[i] != biasOffset || gradients_[i].size() != biasOffset + width) {
+            biasOffsets_[i] = biasOffset;
+            gradients_[i].assign(biasOffset + width, T(0));
+        }
+    }
+}
+
+template <typename T>
+void TrainingWorkspaceT<T>::clearGradients() {
+    for (auto& gradient : gradients_) {
+        std::fill(gradient.begin(), gradient.end(), T(0));
+    }
+}
+
+template <typename T>
+size_t TrainingWorkspaceT<T>::getBatchCapacity() const {
+    return batchCapacity_;
+}
+
+template <typename T>
+T* TrainingWorkspaceT<T>::getActivations(size_t layerIndex) {
+    return activations_[layerIndex].data();
+}
+
+template <typename T>
+const T* TrainingWorkspaceT<T>::getActivations(size_t layerIndex) const {
+    return activations_[layerIndex].data();
+}
+
+template <typename T>
+T* TrainingWorkspaceT<T>::getDeltas(size_t layerIndex) {
+    return deltas_[layerIndex].data();
+}
+
+template <typename T>
+T* TrainingWorkspaceT<T>::getWeightGradient(size_t layerIndex) {
+    return gradients_[layerIndex].data();
+}
+
+template <typename T>
+const T* TrainingWorkspaceT<T>::getWeightGradient(size_t layerIndex) const {
+    return gradients_[layerIndex].data();
+}
+
+template <typename T>
+T* TrainingWorkspaceT<T>::getBiasGradient(size_t layerIndex) {
+    return gradients_[layerIndex].data() + biasOffsets_[layerIndex];
+}
+
+template <typename T>
+const T* TrainingWorkspaceT<T>::getBiasGradient(size_t layerIndex) const {
+    return gradients_[layerIndex].data() + biasOffsets_[layerIndex];
+}
+
+template <typename T>
+size_t TrainingWorkspaceT<T>::getGradientSize(size_t layerIndex) const {
+    return gradients_[layerIndex].size();
+}
+
+template class TrainingWorkspaceT<float>;
+template class TrainingWorkspaceT<double>;
@@ -0,0 +1,46 @@
+// training_workspace.h
+#ifndef TRAINING_WORKSPACE_H
+#define TRAINING_WORKSPACE_H
+
+#include <vector>
+#include "aligned_allocator.h"
+#include "layer.h"
+
+// Per-batch scratch state for mini-batch training: the activations and deltas of every
+// layer for up to getBatchCapacity() samples, and gradient accumulators that mirror the
+// parameter layout of each Layer (row i of the weight gradient starts at i * getWeightStride()).
+template <typename T>
+class TrainingWorkspaceT {
+public:
+    TrainingWorkspaceT() = default;
+
+    // Sizes all buffers for the given topology and batch size; reallocates only when they grow.
+    void reserve(const std::vector<LayerT<T>>& layers, size_t batchSize);
+    void clearGradients();
+
+    size_t getBatchCapacity() const;
+
+    T* getActivations(size_t layerIndex); // batch x layer output width, row-major
+    const T* getActivations(size_t layerIndex) const;
+    T* getDeltas(size_t layerIndex);      // batch x layer output width, row-major
+
+    T* getWeightGradient(size_t layerIndex);
+    const T* getWeightGradient(size_t layerIndex) const;
+    T* getBiasGradient(size_t layerIndex);
+    const T* getBiasGradient(size_t layerIndex) const;
+    // Weight and bias gradients of a layer are one contiguous block of this many values
+    // starting at getWeightGradient(layerIndex).
+    size_t getGradientSize(size_t layerIndex) const;
+
+private:
+    size_t batchCapacity_ = 0;
+    std::vector<std::vector<T>> activations_;
+    std::vector<std::vector<T>> deltas_;
+    std::vector<AlignedVector<T>> gradients_; // [outputs x stride] weights, then outputs biases
+    std::vector<size_t> biasOffsets_;
+};
+
+using TrainingWorkspace = TrainingWorkspaceT<double>;
+using TrainingWorkspaceF = TrainingWorkspaceT<float>;
+
+#endif // TRAINING_WORKSPACE_H